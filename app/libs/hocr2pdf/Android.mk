@@ -16,9 +16,11 @@ LOCAL_SRC_FILES += \
   hocr2pdf/src/lib/rotate.cc \
   hocr2pdf/src/lib/Colorspace.cc \
   hocr2pdf/src/lib/hocr.cc \
+  hocr2pdf/src/lib/textlayer.cc \
   hocr2pdf/src/lib/entities.cc \
   hocr2pdf/src/codecs/Codecs.cc \
   hocr2pdf/src/codecs/pdf.cc \
+  hocr2pdf/src/codecs/ccitt.cc \
   hocr2pdf/src/codecs/png.cc \
   hocr2pdf/src/codecs/jpeg.cc \
   hocr2pdf/src/codecs/transupp.c
@@ -37,4 +39,9 @@ LOCAL_LDLIBS := \
 LOCAL_SHARED_LIBRARIES:=libpngo libjpeg
 LOCAL_DISABLE_FORMAT_STRING_CHECKS:=true
 
+# NEON kernels in src/lib are selected at compile time via __ARM_NEON.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+
 include $(BUILD_SHARED_LIBRARY)
\ No newline at end of file
@@ -23,10 +23,18 @@
 #include <cmath>
 #include <cctype>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
 
 #include "Codecs.hh"
+#include "Colorspace.hh"
+#include "scale.hh"
 #include "pdf.hh"
 #include "hocr.hh"
+#include "textlayer.hh"
 #include "jpeg.hh"
 #include "common.h"
 
@@ -34,17 +42,166 @@
 extern "C" {
 #endif
 
-int hocr2pdf(const char* imageFileName, const char* hocrText, PDFCodec* pdfContext, bool sloppy, bool overlayImage) {
-	  LOGI("hocr2pdf %s",hocrText);
+/**
+ * One page of the document. The image is loaded and encoded by a worker,
+ * the page itself is written by the thread that owns the PDFCodec.
+ */
+struct PdfPage {
+	std::string imageFileName;
+	std::string hocrText;
+	bool overlayImage;
+	// overlay the image as a text mask over a low resolution background
+	bool mrc;
 
-	// load the image, if specified and possible
+	// filled in by loadPage()
+	unsigned int w, h, res;
+	PDFCodec::EncodedImage image;
+	// only used for mrc pages, the image is the background then
+	PDFCodec::EncodedImage mask;
+	bool loaded;
+};
 
-	  Image image; image.w = image.h = 0;
-	  std::string fileName(imageFileName);
-	  if (!ImageCodec::Read(fileName, image)) {
-		  LOGI("Error reading input file.");
-          overlayImage = false;
-        std::string hocrString(hocrText);
+// the anti-aliased edges of glyphs may reach a little beyond their word box
+static const int MRC_WORD_PADDING = 2;
+// words with less difference between the gray of text and background stay in the background
+static const double MRC_MIN_CONTRAST = 48;
+// words with more colourful text (max - min of r, g and b) stay in the background
+static const double MRC_MAX_TEXT_CHROMA = 64;
+// the background of a 300 dpi page is kept at 100 dpi
+static const double MRC_BACKGROUND_SCALE = 1. / 3;
+static const int MRC_BACKGROUND_QUALITY = 50;
+
+/**
+ * Returns the Otsu threshold of a gray histogram: gray values at or below it
+ * are text. darkMean and lightMean are the mean gray of both classes, they
+ * are equal if the histogram has only one gray value.
+ */
+static int otsuThreshold(const unsigned int histogram[256], double& darkMean, double& lightMean) {
+	  double count = 0, sum = 0;
+	  for (int i = 0; i < 256; i++) {
+	    count += histogram[i];
+	    sum += (double) i * histogram[i];
+	  }
+	  darkMean = lightMean = count > 0 ? sum / count : 0;
+	  int threshold = -1;
+	  double darkCount = 0, darkSum = 0, best = 0;
+	  for (int t = 0; t < 255; t++) {
+	    darkCount += histogram[t];
+	    darkSum += (double) t * histogram[t];
+	    double lightCount = count - darkCount;
+	    if (darkCount == 0 || lightCount == 0) {
+	      continue;
+	    }
+	    double dark = darkSum / darkCount;
+	    double light = (sum - darkSum) / lightCount;
+	    double between = darkCount * lightCount * (light - dark) * (light - dark);
+	    if (between > best) {
+	      best = between;
+	      threshold = t;
+	      darkMean = dark;
+	      lightMean = light;
+	    }
+	  }
+	  return threshold;
+}
+
+/**
+ * Splits the image into a 1 bit mask of the text and a background. Only the
+ * word boxes of the hOCR are looked at, each one with its own Otsu threshold,
+ * so photos, shadows and light backgrounds stay in the background. Words with
+ * little contrast or coloured text are left in the background as well.
+ * The masked pixels are whitened in the background, so that the text does not
+ * bleed through, and the background is scaled down by MRC_BACKGROUND_SCALE.
+ * Returns false for images that are not 8 bit gray or RGB.
+ */
+static bool splitMixedRaster(Image& image, Image& mask, const std::vector<BBox>& words) {
+	  if (image.bps != 8 || (image.spp != 1 && image.spp != 3)) {
+	    return false;
+	  }
+	  Image gray;
+	  gray = image;
+	  if (gray.spp == 3) {
+	    colorspace_rgb8_to_gray8(gray);
+	  }
+	  // all white, text pixels are cleared
+	  mask.copyMeta(gray);
+	  mask.setBitsPerSample(1);
+	  mask.resize(gray.w, gray.h);
+	  memset(mask.getRawData(), 0xff, mask.stride() * mask.h);
+
+	  const int spp = image.spp;
+	  for (size_t i = 0; i < words.size(); i++) {
+	    const int x1 = std::max(0, (int) words[i].x1 - MRC_WORD_PADDING);
+	    const int y1 = std::max(0, (int) words[i].y1 - MRC_WORD_PADDING);
+	    const int x2 = std::min(image.w, (int) words[i].x2 + MRC_WORD_PADDING);
+	    const int y2 = std::min(image.h, (int) words[i].y2 + MRC_WORD_PADDING);
+	    if (x1 >= x2 || y1 >= y2) {
+	      continue;
+	    }
+
+	    unsigned int histogram[256] = { 0 };
+	    for (int y = y1; y < y2; y++) {
+	      const uint8_t* grayRow = gray.getRawData() + y * gray.stride();
+	      for (int x = x1; x < x2; x++) {
+	        histogram[grayRow[x]]++;
+	      }
+	    }
+	    double darkMean, lightMean;
+	    const int threshold = otsuThreshold(histogram, darkMean, lightMean);
+	    if (threshold < 0 || lightMean - darkMean < MRC_MIN_CONTRAST) {
+	      continue;
+	    }
+
+	    if (spp == 3) {
+	      double chroma = 0, textPixels = 0;
+	      for (int y = y1; y < y2; y++) {
+	        const uint8_t* grayRow = gray.getRawData() + y * gray.stride();
+	        const uint8_t* row = image.getRawData() + y * image.stride();
+	        for (int x = x1; x < x2; x++) {
+	          if (grayRow[x] <= threshold) {
+	            const uint8_t* rgb = row + 3 * x;
+	            chroma += std::max(rgb[0], std::max(rgb[1], rgb[2]))
+	              - std::min(rgb[0], std::min(rgb[1], rgb[2]));
+	            textPixels++;
+	          }
+	        }
+	      }
+	      if (chroma > MRC_MAX_TEXT_CHROMA * textPixels) {
+	        continue;
+	      }
+	    }
+
+	    for (int y = y1; y < y2; y++) {
+	      const uint8_t* grayRow = gray.getRawData() + y * gray.stride();
+	      uint8_t* maskRow = mask.getRawData() + y * mask.stride();
+	      uint8_t* row = image.getRawData() + y * image.stride();
+	      for (int x = x1; x < x2; x++) {
+	        if (grayRow[x] <= threshold) {
+	          maskRow[x / 8] &= ~(0x80 >> (x % 8));
+	          memset(row + x * spp, 0xff, spp);
+	        }
+	      }
+	    }
+	  }
+	  mask.setRawData();
+	  image.setRawData();
+
+	  scale(image, MRC_BACKGROUND_SCALE, MRC_BACKGROUND_SCALE);
+	  return true;
+}
+
+/**
+ * Sets up a page without image. Its size is taken from the bbox of the hOCR
+ * page and it is laid out at 300 dpi.
+ */
+static void loadTextOnlyPage(PdfPage& page) {
+	  page.overlayImage = false;
+	  page.image = PDFCodec::EncodedImage();
+	  page.mask = PDFCodec::EncodedImage();
+	  page.w = page.h = 0;
+	  page.res = 300;
+
+        std::string hocrString(page.hocrText);
         std::size_t startPos = hocrString.find("bbox", 0);
         if (startPos!=std::string::npos) {
             std::size_t endPos = hocrString.find(";", startPos);
@@ -58,13 +215,25 @@ int hocr2pdf(const char* imageFileName, const char* hocrText, PDFCodec* pdfConte
                 while (ss >> buf) {
                     tokens.push_back(buf);
                 }
-                std::stringstream(tokens[3]) >> image.w;
-                std::stringstream(tokens[4]) >> image.h;
+                if (tokens.size() >= 5) {
+                    std::stringstream(tokens[3]) >> page.w;
+                    std::stringstream(tokens[4]) >> page.h;
+                }
 
-                LOGI("image size = %i, %i, ", image.w, image.h);
+                LOGI("image size = %i, %i, ", page.w, page.h);
 
             }
         }
+}
+
+static void loadPage(PdfPage& page) {
+	// load the image, if specified and possible
+
+	  Image image; image.w = image.h = 0;
+	  if (!ImageCodec::Read(page.imageFileName, image)) {
+		  LOGI("Error reading input file.");
+		  loadTextOnlyPage(page);
+		  return;
 	  }
 
 	  if (image.resolutionX() <= 0 || image.resolutionY() <= 0) {
@@ -72,25 +241,160 @@ int hocr2pdf(const char* imageFileName, const char* hocrText, PDFCodec* pdfConte
 	    image.setResolution(300, 300);
 	  }
 
-	  unsigned int res = image.resolutionX();
+	  page.w = image.w;
+	  page.h = image.h;
+	  page.res = image.resolutionX();
+
+	  // this is the expensive part, so it happens here and not in writePage()
+	  if (page.overlayImage) {
+	    Image mask;
+	    std::vector<BBox> words;
+	    if (page.mrc) {
+	      hocrWordBoxes(page.hocrText.data(), page.hocrText.size(), words);
+	    }
+	    if (page.mrc && splitMixedRaster(image, mask, words)) {
+	      PDFCodec::encodeImageMask(mask, page.mask);
+	      PDFCodec::encodeImage(image, page.image, MRC_BACKGROUND_QUALITY);
+	    } else {
+	      PDFCodec::encodeImage(image, page.image);
+	    }
+	  }
+}
+
+static void writePage(PdfPage& page, PDFCodec* pdfContext, bool sloppy) {
+	  LOGI("hocr2pdf %s",page.hocrText.c_str());
+
+	  unsigned int res = page.res;
 
-	  std::stringstream hocr(hocrText);
-    
-      LOGI("paged dimensions %.2f, %.2f", 72. * image.w / res, 72. * image.h / res);
+      LOGI("paged dimensions %.2f, %.2f", 72. * page.w / res, 72. * page.h / res);
 
 
-	  pdfContext->beginPage(72. * image.w / res, 72. * image.h / res);
+	  pdfContext->beginPage(72. * page.w / res, 72. * page.h / res);
 	  pdfContext->setFillColor(0, 0, 0);
-	  hocr2pdf(hocr, pdfContext, res, sloppy,!overlayImage);
+	  hocr2pdf(page.hocrText.data(), page.hocrText.size(), pdfContext, res, sloppy,!page.overlayImage);
 
-	  if (overlayImage) {
+	  if (page.overlayImage) {
         LOGI("Overlaying image");
-	    pdfContext->showImage(image, 0, 0, 72. * image.w / res, 72. * image.h / res);
+	    pdfContext->showImage(page.image, 0, 0, 72. * page.w / res, 72. * page.h / res);
+	    if (!page.mask.data.empty()) {
+	      // painted in the fill color
+	      pdfContext->showImage(page.mask, 0, 0, 72. * page.w / res, 72. * page.h / res);
+	    }
 	  }
+}
 
+int hocr2pdf(const char* imageFileName, const char* hocrText, PDFCodec* pdfContext, bool sloppy, bool overlayImage, bool mrc) {
+	  PdfPage page;
+	  page.imageFileName = imageFileName;
+	  page.hocrText = hocrText;
+	  page.overlayImage = overlayImage;
+	  page.mrc = mrc;
+	  loadPage(page);
+	  writePage(page, pdfContext, sloppy);
 	  return 0;
 }
 
+/**
+ * Runs loadPage() for queued pages on worker threads. The thread that waits for
+ * a page helps with the queued pages, so this also works without any workers.
+ */
+class PageLoader {
+public:
+	explicit PageLoader(unsigned int threadCount) : stop(false) {
+		for (unsigned int i = 0; i < threadCount; i++) {
+			threads.push_back(std::thread(&PageLoader::workerLoop, this));
+		}
+	}
+
+	~PageLoader() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		queued.notify_all();
+		for (size_t i = 0; i < threads.size(); i++) {
+			threads[i].join();
+		}
+	}
+
+	void add(PdfPage* page) {
+		std::lock_guard<std::mutex> lock(mutex);
+		page->loaded = false;
+		queue.push_back(page);
+		queued.notify_one();
+	}
+
+	void waitFor(PdfPage* page) {
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!page->loaded) {
+			if (queue.empty()) {
+				loaded.wait(lock);
+			} else {
+				loadNext(lock);
+			}
+		}
+	}
+
+private:
+	void workerLoop() {
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;) {
+			while (!stop && queue.empty()) {
+				queued.wait(lock);
+			}
+			if (stop) {
+				return;
+			}
+			loadNext(lock);
+		}
+	}
+
+	// called with the lock held, releases it while the page is loaded
+	void loadNext(std::unique_lock<std::mutex>& lock) {
+		PdfPage* page = queue.front();
+		queue.pop_front();
+		lock.unlock();
+		try {
+			loadPage(*page);
+		} catch (...) {
+			LOGE("Failed to load %s", page->imageFileName.c_str());
+			loadTextOnlyPage(*page);
+		}
+		lock.lock();
+		page->loaded = true;
+		loaded.notify_all();
+	}
+
+	std::vector<std::thread> threads;
+	std::deque<PdfPage*> queue;
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable loaded;
+	bool stop;
+};
+
+static PdfPage* readPage(JNIEnv* env, jobjectArray imageStrings, jobjectArray hocrBytes, int i, bool overlayImage, bool mrc) {
+	  jstring image = (jstring) env->GetObjectArrayElement( imageStrings, i );
+	  jbyteArray hocr = (jbyteArray)env->GetObjectArrayElement( hocrBytes, i );
+
+	  PdfPage* page = new PdfPage();
+	  const char *c_image = env->GetStringUTFChars(image, NULL);
+	  page->imageFileName = c_image;
+	  env->ReleaseStringUTFChars(image, c_image);
+
+	  jbyte* javaStringByte = env->GetByteArrayElements(hocr,0);
+	  jsize javaStringlen = env->GetArrayLength(hocr);
+	  page->hocrText.assign((char*)javaStringByte, javaStringlen);
+	  env->ReleaseByteArrayElements(hocr,javaStringByte,JNI_ABORT);
+	  LOGI("size of string = %i",page->hocrText.length());
+
+	  page->overlayImage = overlayImage;
+	  page->mrc = mrc;
+	  env->DeleteLocalRef(hocr);
+	  env->DeleteLocalRef(image);
+	  return page;
+}
+
 jint JNI_OnLoad(JavaVM* vm, void* reserved) {
   JNIEnv *env;
 
@@ -103,12 +407,13 @@ jint JNI_OnLoad(JavaVM* vm, void* reserved) {
 }
 
 
-void Java_com_renard_ocr_pdf_Hocr2Pdf_nativeHocr2pdf( JNIEnv* env, jobject thiz, jobjectArray imageStrings, jobjectArray hocrBytes, jstring out, jboolean sloppy, jboolean overlayImage)
+void Java_com_renard_ocr_pdf_Hocr2Pdf_nativeHocr2pdf( JNIEnv* env, jobject thiz, jobjectArray imageStrings, jobjectArray hocrBytes, jstring out, jboolean sloppy, jboolean overlayImage, jboolean mrc)
 {
   LOGI("Java_com_renard_pdf_Hocr2Pdf_nativeHocr2pdf");
 
   bool c_sloppy = (sloppy == JNI_TRUE);
   bool c_overlay = (overlayImage==JNI_TRUE);
+  bool c_mrc = (mrc == JNI_TRUE);
   const char *pdfFileName = env->GetStringUTFChars(out, NULL);
   bool useCallbacks = true;
 
@@ -118,31 +423,50 @@ void Java_com_renard_ocr_pdf_Hocr2Pdf_nativeHocr2pdf( JNIEnv* env, jobject thiz,
 	  useCallbacks = false;
   }
 
-  std::ofstream pdfOutStream(pdfFileName);
-  PDFCodec* pdfContext = new PDFCodec(&pdfOutStream);
+  std::ofstream pdfOutStream(pdfFileName, std::ios::out | std::ios::binary);
+  PDFCodec* pdfContext = new PDFCodec(&pdfOutStream, true);
 
-  unsigned int numImages = env->GetArrayLength( imageStrings );
-  for (int i = 0; i< numImages; i++) {
-	  jstring image = (jstring) env->GetObjectArrayElement( imageStrings, i );
-	  jbyteArray hocr = (jbyteArray)env->GetObjectArrayElement( hocrBytes, i );
+  // pages are loaded and encoded in parallel, but only a few pages ahead of
+  // the one that is written next, to keep the memory use independent of the page count
+  unsigned int cores = std::thread::hardware_concurrency();
+  unsigned int workers = cores > 1 ? cores - 1 : 0;
+  unsigned int window = 2 * (workers + 1);
+  std::deque<PdfPage*> pages;
+  {
+	  PageLoader loader(workers);
+	  unsigned int numImages = env->GetArrayLength( imageStrings );
+	  unsigned int next = 0;
+	  try {
+		  for (unsigned int i = 0; i< numImages; i++) {
+			  // JNI is only used on this thread
+			  for (; next < numImages && next < i + window; next++) {
+				  pages.push_back(readPage(env, imageStrings, hocrBytes, next, c_overlay, c_mrc));
+				  loader.add(pages.back());
+			  }
 
-	  const char *c_image = env->GetStringUTFChars(image, NULL);
-	  jbyte* javaStringByte = env->GetByteArrayElements(hocr,0);
-	  jsize javaStringlen = env->GetArrayLength(hocr);
-	  std::string cString((char*)javaStringByte, javaStringlen);
-
-	  //const char *c_hocr = env->GetStringUTFChars(hocr, NULL);
+			  if (useCallbacks) {
+				  env->CallVoidMethod(thiz, mid, i);
+				  if (env->ExceptionCheck()) {
+					  // no more JNI calls, the exception is thrown once we return
+					  break;
+				  }
+			  }
 
-	  LOGI("size of string = %i",cString.length());
-	  if (useCallbacks) {
-		  env->CallVoidMethod(thiz, mid, i);
+			  // the page stays in pages until it is written, so that it is freed below if writing fails
+			  PdfPage* page = pages.front();
+			  loader.waitFor(page);
+			  writePage(*page, pdfContext, c_sloppy);
+			  pages.pop_front();
+			  delete page;
+		  }
+	  } catch (...) {
+		  LOGE("Failed to write %s", pdfFileName);
 	  }
-
-	  int r = hocr2pdf(c_image, cString.c_str(), pdfContext, c_sloppy,c_overlay);
-	  env->ReleaseStringUTFChars(image, c_image);
-	  env->ReleaseByteArrayElements(hocr,javaStringByte,JNI_ABORT);
-	  env->DeleteLocalRef(hocr);
-	  env->DeleteLocalRef(image);
+	  // the loader stops its workers when it goes out of scope, queued pages are not loaded any more
+  }
+  // pages that were read ahead when the loop ended early
+  for (size_t i = 0; i < pages.size(); i++) {
+	  delete pages[i];
   }
   delete pdfContext;
 
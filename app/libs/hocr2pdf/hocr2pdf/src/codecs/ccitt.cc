@@ -0,0 +1,247 @@
+/*
+ * CCITT Group 4 (ITU-T T.6) encoding of bilevel images.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2. A copy of the GNU General
+ * Public License can be found in the file LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+ * ABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ */
+
+#include <vector>
+
+#include "ccitt.hh"
+
+namespace {
+
+struct Code
+{
+  uint8_t length;
+  uint16_t bits;
+};
+
+// white runs 0 - 63, then the make-up codes for 64 - 1728
+static const Code whiteCodes[] = {
+  { 8, 0x35 }, { 6, 0x7 }, { 4, 0x7 }, { 4, 0x8 },
+  { 4, 0xb }, { 4, 0xc }, { 4, 0xe }, { 4, 0xf },
+  { 5, 0x13 }, { 5, 0x14 }, { 5, 0x7 }, { 5, 0x8 },
+  { 6, 0x8 }, { 6, 0x3 }, { 6, 0x34 }, { 6, 0x35 },
+  { 6, 0x2a }, { 6, 0x2b }, { 7, 0x27 }, { 7, 0xc },
+  { 7, 0x8 }, { 7, 0x17 }, { 7, 0x3 }, { 7, 0x4 },
+  { 7, 0x28 }, { 7, 0x2b }, { 7, 0x13 }, { 7, 0x24 },
+  { 7, 0x18 }, { 8, 0x2 }, { 8, 0x3 }, { 8, 0x1a },
+  { 8, 0x1b }, { 8, 0x12 }, { 8, 0x13 }, { 8, 0x14 },
+  { 8, 0x15 }, { 8, 0x16 }, { 8, 0x17 }, { 8, 0x28 },
+  { 8, 0x29 }, { 8, 0x2a }, { 8, 0x2b }, { 8, 0x2c },
+  { 8, 0x2d }, { 8, 0x4 }, { 8, 0x5 }, { 8, 0xa },
+  { 8, 0xb }, { 8, 0x52 }, { 8, 0x53 }, { 8, 0x54 },
+  { 8, 0x55 }, { 8, 0x24 }, { 8, 0x25 }, { 8, 0x58 },
+  { 8, 0x59 }, { 8, 0x5a }, { 8, 0x5b }, { 8, 0x4a },
+  { 8, 0x4b }, { 8, 0x32 }, { 8, 0x33 }, { 8, 0x34 },
+  { 5, 0x1b }, { 5, 0x12 }, { 6, 0x17 }, { 7, 0x37 },
+  { 8, 0x36 }, { 8, 0x37 }, { 8, 0x64 }, { 8, 0x65 },
+  { 8, 0x68 }, { 8, 0x67 }, { 9, 0xcc }, { 9, 0xcd },
+  { 9, 0xd2 }, { 9, 0xd3 }, { 9, 0xd4 }, { 9, 0xd5 },
+  { 9, 0xd6 }, { 9, 0xd7 }, { 9, 0xd8 }, { 9, 0xd9 },
+  { 9, 0xda }, { 9, 0xdb }, { 9, 0x98 }, { 9, 0x99 },
+  { 9, 0x9a }, { 6, 0x18 }, { 9, 0x9b }
+};
+
+// black runs 0 - 63, then the make-up codes for 64 - 1728
+static const Code blackCodes[] = {
+  { 10, 0x37 }, { 3, 0x2 }, { 2, 0x3 }, { 2, 0x2 },
+  { 3, 0x3 }, { 4, 0x3 }, { 4, 0x2 }, { 5, 0x3 },
+  { 6, 0x5 }, { 6, 0x4 }, { 7, 0x4 }, { 7, 0x5 },
+  { 7, 0x7 }, { 8, 0x4 }, { 8, 0x7 }, { 9, 0x18 },
+  { 10, 0x17 }, { 10, 0x18 }, { 10, 0x8 }, { 11, 0x67 },
+  { 11, 0x68 }, { 11, 0x6c }, { 11, 0x37 }, { 11, 0x28 },
+  { 11, 0x17 }, { 11, 0x18 }, { 12, 0xca }, { 12, 0xcb },
+  { 12, 0xcc }, { 12, 0xcd }, { 12, 0x68 }, { 12, 0x69 },
+  { 12, 0x6a }, { 12, 0x6b }, { 12, 0xd2 }, { 12, 0xd3 },
+  { 12, 0xd4 }, { 12, 0xd5 }, { 12, 0xd6 }, { 12, 0xd7 },
+  { 12, 0x6c }, { 12, 0x6d }, { 12, 0xda }, { 12, 0xdb },
+  { 12, 0x54 }, { 12, 0x55 }, { 12, 0x56 }, { 12, 0x57 },
+  { 12, 0x64 }, { 12, 0x65 }, { 12, 0x52 }, { 12, 0x53 },
+  { 12, 0x24 }, { 12, 0x37 }, { 12, 0x38 }, { 12, 0x27 },
+  { 12, 0x28 }, { 12, 0x58 }, { 12, 0x59 }, { 12, 0x2b },
+  { 12, 0x2c }, { 12, 0x5a }, { 12, 0x66 }, { 12, 0x67 },
+  { 10, 0xf }, { 12, 0xc8 }, { 12, 0xc9 }, { 12, 0x5b },
+  { 12, 0x33 }, { 12, 0x34 }, { 12, 0x35 }, { 13, 0x6c },
+  { 13, 0x6d }, { 13, 0x4a }, { 13, 0x4b }, { 13, 0x4c },
+  { 13, 0x4d }, { 13, 0x72 }, { 13, 0x73 }, { 13, 0x74 },
+  { 13, 0x75 }, { 13, 0x76 }, { 13, 0x77 }, { 13, 0x52 },
+  { 13, 0x53 }, { 13, 0x54 }, { 13, 0x55 }, { 13, 0x5a },
+  { 13, 0x5b }, { 13, 0x64 }, { 13, 0x65 }
+};
+
+// make-up codes for 1792 - 2560, shared by both colors
+static const Code extendedCodes[] = {
+  { 11, 0x8 }, { 11, 0xc }, { 11, 0xd }, { 12, 0x12 },
+  { 12, 0x13 }, { 12, 0x14 }, { 12, 0x15 }, { 12, 0x16 },
+  { 12, 0x17 }, { 12, 0x1c }, { 12, 0x1d }, { 12, 0x1e },
+  { 12, 0x1f }
+};
+
+const Code passCode = { 4, 0x1 }; // 0001
+const Code horizontalCode = { 3, 0x1 }; // 001
+const Code eolCode = { 12, 0x1 }; // 0000 0000 0001
+
+// vertical mode, indexed by b1 - a1 + 3
+const Code verticalCodes[] = {
+  { 7, 0x3 }, // VR3 0000 011
+  { 6, 0x3 }, // VR2 0000 11
+  { 3, 0x3 }, // VR1 011
+  { 1, 0x1 }, // V0  1
+  { 3, 0x2 }, // VL1 010
+  { 6, 0x2 }, // VL2 0000 10
+  { 7, 0x2 }  // VL3 0000 010
+};
+
+class BitWriter
+{
+public:
+  BitWriter(std::ostream& _stream)
+    : stream(_stream), buffer(0), count(0)
+  {
+    out.reserve(64 * 1024);
+  }
+  
+  void put(const Code& code)
+  {
+    buffer = (buffer << code.length) | code.bits;
+    count += code.length;
+    while (count >= 8) {
+      count -= 8;
+      out.push_back((char)(buffer >> count));
+    }
+    if (out.size() >= 64 * 1024)
+      flush();
+  }
+  
+  // run of one color, make-up codes first
+  void putRun(int run, const Code* codes)
+  {
+    while (run >= 2560) {
+      put(extendedCodes[12]);
+      run -= 2560;
+    }
+    if (run >= 1792) {
+      put(extendedCodes[(run - 1792) / 64]);
+      run %= 64;
+    } else if (run >= 64) {
+      put(codes[63 + run / 64]);
+      run %= 64;
+    }
+    put(codes[run]);
+  }
+  
+  // pads the last byte with zeros
+  void finish()
+  {
+    if (count > 0) {
+      out.push_back((char)(buffer << (8 - count)));
+      count = 0;
+    }
+    flush();
+  }
+  
+private:
+  void flush()
+  {
+    stream.write(out.data(), out.size());
+    out.clear();
+  }
+  
+  std::ostream& stream;
+  std::vector<char> out;
+  uint32_t buffer;
+  int count;
+};
+
+// 1 for a black pixel, the image data has 0 for black
+inline int black(const uint8_t* row, int x)
+{
+  return !((row[x >> 3] >> (7 - (x & 7))) & 1);
+}
+
+// returns the first position in [x, w) whose color is not the given
+// one, or w
+int findChange(const uint8_t* row, int x, int w, int color)
+{
+  const uint8_t same = color ? 0x00 : 0xff;
+  while (x < w) {
+    if ((x & 7) == 0) {
+      // whole bytes of the same color
+      while (x + 8 <= w && row[x >> 3] == same)
+	x += 8;
+      if (x >= w)
+	break;
+    }
+    if (black(row, x) != color)
+      return x;
+    ++x;
+  }
+  return w;
+}
+
+// the next change on the reference line after b1, if any
+inline int findChangeAfter(const uint8_t* row, int x, int w)
+{
+  return x < w ? findChange(row, x, w, black(row, x)) : w;
+}
+
+} // namespace
+
+void EncodeCCITTG4(std::ostream& stream, const uint8_t* data,
+		   int w, int h, int stride)
+{
+  BitWriter writer(stream);
+  // the imaginary white line above the first one
+  std::vector<uint8_t> whiteLine(stride, 0xff);
+  const uint8_t* ref = &whiteLine[0];
+  
+  for (int y = 0; y < h; ++y, ref = data, data += stride) {
+    // a0 starts on an imaginary white pixel in front of the line
+    int a0 = 0;
+    int a1 = black(data, 0) ? 0 : findChange(data, 0, w, 0);
+    int b1 = black(ref, 0) ? 0 : findChange(ref, 0, w, 0);
+    for (;;) {
+      const int b2 = findChangeAfter(ref, b1, w);
+      if (b2 < a1) {
+	writer.put(passCode);
+	a0 = b2;
+      } else if (b1 - a1 >= -3 && b1 - a1 <= 3) {
+	writer.put(verticalCodes[b1 - a1 + 3]);
+	a0 = a1;
+      } else {
+	const int a2 = findChangeAfter(data, a1, w);
+	writer.put(horizontalCode);
+	if (a0 + a1 == 0 || !black(data, a0)) {
+	  writer.putRun(a1 - a0, whiteCodes);
+	  writer.putRun(a2 - a1, blackCodes);
+	} else {
+	  writer.putRun(a1 - a0, blackCodes);
+	  writer.putRun(a2 - a1, whiteCodes);
+	}
+	a0 = a2;
+      }
+      if (a0 >= w)
+	break;
+      
+      const int color = black(data, a0);
+      a1 = findChange(data, a0, w, color);
+      // the first change to the opposite color right of a0
+      b1 = findChange(ref, a0, w, !color);
+      b1 = findChange(ref, b1, w, color);
+    }
+  }
+  
+  // EOFB
+  writer.put(eolCode);
+  writer.put(eolCode);
+  writer.finish();
+}
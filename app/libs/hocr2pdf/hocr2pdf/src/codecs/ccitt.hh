@@ -0,0 +1,28 @@
+/*
+ * CCITT Group 4 (ITU-T T.6) encoding of bilevel images.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2. A copy of the GNU General
+ * Public License can be found in the file LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+ * ABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ */
+
+#ifndef CCITT_HH
+#define CCITT_HH
+
+#include <inttypes.h>
+#include <iostream>
+
+// Encodes h rows of w pixels, packed 8 per byte with the first pixel in
+// the most significant bit and 0 for black, as for a 1 bit /DeviceGray
+// image. The result is what /CCITTFaxDecode with /K -1 and the default
+// /BlackIs1 false expects, terminated by an EOFB.
+void EncodeCCITTG4(std::ostream& stream, const uint8_t* data,
+		   int w, int h, int stride);
+
+#endif
@@ -499,6 +499,15 @@ void JPEGCodec::parseExif (Image& image)
 }
 
 // on-demand decoding
+bool JPEGCodec::writeDCT (std::ostream* stream)
+{
+  // stream the buffer, private_copy.str() would copy the whole file
+  private_copy.clear ();
+  private_copy.seekg (0);
+  *stream << private_copy.rdbuf ();
+  return stream->good ();
+}
+
 /*bool*/ void JPEGCodec::decodeNow (Image* image)
 {
   // std::cerr << "JPEGCodec::decodeNow" << std::endl;
@@ -46,6 +46,10 @@ public:
   // on-demand decoding
   virtual /*bool*/ void decodeNow (Image* image);
   
+  // pass-through of the unmodified compressed stream, e.g. for
+  // embedding into PDF, only valid for the instance attached to an image
+  bool writeDCT (std::ostream* stream);
+  
   // optional optimizing and/or lossless implementations
   virtual bool flipX (Image& image);
   virtual bool flipY (Image& image);
@@ -24,11 +24,13 @@
 #include "../utility/Encodings.hh"
 
 #include "jpeg.hh"
+#include "ccitt.hh"
 
 #if WITHJASPER == 1
 #include "jpeg2000.hh"
 #endif
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 
@@ -44,6 +46,8 @@
   * write out images, fonts, and other objects / streams immediately
   * write out bufferd page content at "endPage"
   * keep track of object id's and positions to write out at the end
+  * free page, content and image objects once the page is written,
+    so the memory use does not grow with the number of pages
   
   In theory we could use any resource name (some PDF writers use R*).
   However, for the prettification of it we use /F for Fonts and /I
@@ -71,6 +75,7 @@
 */
 
 struct PDFObject; // fwd
+struct PDFObjectStream; // fwd
 struct PDFPage; // fwd
 std::ostream& operator<< (std::ostream& s, PDFObject& obj); // fwd
 
@@ -78,16 +83,35 @@ std::ostream& operator<< (std::ostream& s, PDFObject& obj); // fwd
 struct PDFXref
 {
   PDFXref()
-    : imageCount(0), fontCount(0)
+    : imageCount(0), fontCount(0), compact(false), objectStream(0)
   {}
   
   void write(std::ostream& s);
+  // PDF 1.5 cross-reference stream, carrying the trailer dictionary
+  void writeStream(std::ostream& s, const std::string& trailer);
+  void flushObjectStream(std::ostream& s);
   
-  std::vector<PDFObject*> objects;
+  // where each object was written, either at offset in the file or
+  // as index-th object of the object stream with id container
+  struct Entry
+  {
+    Entry() : offset(0), container(0), index(0) {}
+    uint64_t offset;
+    uint32_t container, index;
+  };
+  
+  // indexed by id - 1; the objects themselves may already be freed
+  // when the table is written
+  std::vector<Entry> entries;
   uint64_t streamPos;
   
   // UUID of font and image references
   uint32_t imageCount, fontCount;
+  
+  // collect all objects but streams in compressed object streams and
+  // write a cross-reference stream instead of the table
+  bool compact;
+  PDFObjectStream* objectStream; // the one that is currently filled
 };
 
 std::ostream& operator<< (std::ostream& s, PDFXref& obj)
@@ -100,11 +124,11 @@ std::ostream& operator<< (std::ostream& s, PDFXref& obj)
 // any PDF object, storing ID, generation and position in stream
 struct PDFObject
 {
-  PDFObject(PDFXref& xref)
-    : generation(0), streamPos(0)
+  PDFObject(PDFXref& _xref)
+    : xref(_xref), generation(0), streamPos(0)
   {
-    xref.objects.push_back(this);
-    id = xref.objects.size(); // after adding, 1-based
+    xref.entries.push_back(PDFXref::Entry());
+    id = xref.entries.size(); // after adding, 1-based
   }
 
   virtual ~PDFObject()
@@ -112,12 +136,17 @@ struct PDFObject
 
   void write(std::ostream& s)
   {
-    // save position in stream for further reference
-    s << "\n";
-    streamPos = s.tellp();
-    s << id << " " << generation << " obj\n";
-    writeImpl(s);
-    s << "endobj\n";
+    if (xref.compact && !isStream()) {
+      writeCompressed(s);
+    } else {
+      // save position in stream for further reference
+      s << "\n";
+      streamPos = s.tellp();
+      xref.entries[id - 1].offset = streamPos;
+      s << id << " " << generation << " obj\n";
+      writeImpl(s);
+      s << "endobj\n";
+    }
     
     while (!pendingObjWriteout.empty()) {
       PDFObject* obj = pendingObjWriteout.front();
@@ -128,6 +157,14 @@ struct PDFObject
   
   virtual void writeImpl(std::ostream& s) = 0;
   
+  // streams can not be placed in an object stream
+  virtual bool isStream() const {
+    return false;
+  }
+  
+  // adds the object to the current object stream instead of s
+  void writeCompressed(std::ostream& s);
+  
   // generate in-file indirect reference spec
   std::string indirectRef() const
   {
@@ -150,6 +187,7 @@ struct PDFObject
     return streamPos;
   }
   
+  PDFXref& xref;
   uint32_t id, generation;
   uint64_t streamPos;
   
@@ -181,6 +219,10 @@ struct PDFStream : public PDFObject
     : PDFObject(xref), number(xref)
   {}
   
+  virtual bool isStream() const {
+    return true;
+  }
+  
   virtual void writeStreamTagsImpl(std::ostream& s) {
   }
   
@@ -209,6 +251,75 @@ struct PDFStream : public PDFObject
   PDFNumber number;
 };
 
+// PDF 1.5 object stream, the objects are buffered and written out
+// Flate compressed together once enough of them are collected
+struct PDFObjectStream : public PDFObject
+{
+  PDFObjectStream (PDFXref& xref)
+    : PDFObject(xref), count(0)
+  {}
+  
+  virtual bool isStream() const {
+    return true;
+  }
+  
+  void add(PDFObject& obj)
+  {
+    PDFXref::Entry& entry = xref.entries[obj.id - 1];
+    entry.container = id;
+    entry.index = count++;
+    
+    header << obj.id << " " << (uint64_t)objects.tellp() << " ";
+    obj.writeImpl(objects);
+  }
+  
+  virtual void writeImpl(std::ostream& s)
+  {
+    std::string data = header.str();
+    const size_t first = data.size();
+    data += objects.str();
+    
+    std::stringstream compressed;
+    EncodeZlib(compressed, data.c_str(), data.size());
+    const std::string& z = compressed.str();
+    
+    s << "<<\n"
+      "/Type /ObjStm\n"
+      "/N " << count << "\n"
+      "/First " << first << "\n"
+      "/Filter /FlateDecode\n"
+      "/Length " << z.size() << "\n"
+      ">>\n"
+      "stream\n";
+    s.write(z.data(), z.size());
+    s << "\nendstream\n";
+  }
+  
+  static const uint32_t maxObjects = 100;
+  
+  std::stringstream header; // pairs of object id and offset
+  std::stringstream objects;
+  uint32_t count;
+};
+
+void PDFObject::writeCompressed(std::ostream& s)
+{
+  if (!xref.objectStream)
+    xref.objectStream = new PDFObjectStream(xref);
+  xref.objectStream->add(*this);
+  if (xref.objectStream->count >= PDFObjectStream::maxObjects)
+    xref.flushObjectStream(s);
+}
+
+void PDFXref::flushObjectStream(std::ostream& s)
+{
+  if (!objectStream)
+    return;
+  s << *objectStream;
+  delete objectStream;
+  objectStream = 0;
+}
+
 // TODO: optional and obsolete, hardcode somewhere
 struct PDFDocumentInfo : public PDFObject
 {
@@ -246,15 +357,16 @@ struct PDFPages : public PDFObject
       "/Kids [";
     bool first = true;
     for (page_iterator it = pages.begin(); it != pages.end(); ++it) {
-      s << (first ? "" : " ") << (*it)->indirectRef();
+      s << (first ? "" : " ") << *it;
       first = false;
     }
     s << "]\n"
       ">>\n";
   }
   
-  std::vector<PDFObject*> pages;
-  typedef std::vector<PDFObject*>::iterator page_iterator;
+  // indirect references of the kids, the page objects are gone by now
+  std::vector<std::string> pages;
+  typedef std::vector<std::string>::iterator page_iterator;
 };
 
 struct PDFCatalog : public PDFObject
@@ -371,7 +483,15 @@ struct PDFXObject : public PDFStream
 {
   PDFXObject (PDFXref& _xref, Image& _image,
 	      const std::string& _compress = "", int _quality = 80)
-    : PDFStream(_xref), image(_image), compress(_compress), quality(_quality)
+    : PDFStream(_xref), image(&_image), encoded(0),
+      compress(_compress), quality(_quality)
+  {
+    imageID = ++_xref.imageCount;
+  }
+  
+  // image stream that was encoded ahead of time
+  PDFXObject (PDFXref& _xref, const PDFCodec::EncodedImage& _encoded)
+    : PDFStream(_xref), image(0), encoded(&_encoded), quality(0)
   {
     imageID = ++_xref.imageCount;
   }
@@ -387,9 +507,40 @@ struct PDFXObject : public PDFStream
   }
   
   virtual void writeStreamTagsImpl(std::ostream& s)
+  {
+    if (encoded) {
+      encoding = encoded->filter;
+      writeTags(s, encoded->w, encoded->h, encoded->spp, encoded->bps,
+		encoded->imageMask);
+    } else {
+      selectEncoding();
+      writeTags(s, image->w, image->h, image->spp, image->bps);
+    }
+  }
+  
+  void writeTags(std::ostream& s, int w, int h, int spp, int bps,
+		 bool imageMask = false)
+  {
+    s << "/Type /XObject\n"
+      "/Subtype /Image\n"
+      "/Width " << w << " /Height " << h << "\n";
+    // a stencil mask paints its 0 samples in the fill color
+    if (imageMask)
+      s << "/ImageMask true\n";
+    else
+      s << "/ColorSpace " << (spp == 1 ? "/DeviceGray" : "/DeviceRGB") << "\n";
+    s << "/BitsPerComponent " << bps << "\n"
+      "/Filter " << encoding << "\n";
+    if (encoding == "/CCITTFaxDecode")
+      s << "/DecodeParms << /K -1 /Columns " << w << " /Rows " << h << " >>\n";
+  }
+  
+  void selectEncoding()
   {
     // default based on image type
-    if (image.bps < 8) encoding = "/FlateDecode";
+    const bool bilevel = image->bps == 1 && image->spp == 1;
+    if (bilevel) encoding = "/CCITTFaxDecode";
+    else if (image->bps < 8) encoding = "/FlateDecode";
     else encoding = "/DCTDecode";
     
     // TODO: move transform to Args class
@@ -409,33 +560,44 @@ struct PDFXObject : public PDFStream
     else if (args.containsAndRemove("jpeg2000"))
       encoding = "/JPXDecode";
 #endif
+    else if (args.containsAndRemove("g4") && bilevel)
+      encoding = "/CCITTFaxDecode";
     if (args.containsAndRemove("flate"))
       encoding = "/FlateDecode";
     compress = args.str();
-    
-    s << "/Type /XObject\n"
-      "/Subtype /Image\n"
-      "/Width " << image.w << " /Height " << image.h << "\n"
-      "/ColorSpace " << (image.spp == 1 ? "/DeviceGray" : "/DeviceRGB") << "\n"
-      "/BitsPerComponent " << image.bps << "\n"
-      "/Filter " << encoding << "\n";
   }
   
   virtual void writeStreamImpl(std::ostream& s)
   {
+    if (encoded) {
+      s.write(encoded->data.data(), encoded->data.size());
+      return;
+    }
+    
+    Image& image = *this->image;
     const int bytes = image.stride() * image.h;
     uint8_t* data = image.getRawData();
     
     if (encoding == "/FlateDecode")
       EncodeZlib(s, (const char*)data, bytes);
-    if (encoding == "/ASCII85Decode")
+    else if (encoding == "/CCITTFaxDecode")
+      EncodeCCITTG4(s, data, image.w, image.h, image.stride());
+    else if (encoding == "/ASCII85Decode")
       EncodeASCII85(s, data, bytes);
     else if (encoding == "/ASCIIHexDecode")
       EncodeHex(s, data, bytes);
     
 #if WITHLIBJPEG == 1
     else if (encoding == "/DCTDecode") {
-      ImageCodec::Write(&s, image, "jpeg", "jpg", quality, compress);
+      // embed JPEG data as read if the pixels were not touched, without
+      // decoding it or re-encoding the coefficients for a new resolution,
+      // the JFIF density is not used inside the PDF anyway
+      ImageCodec* codec = image.getCodec();
+      if (codec && !image.isModified() && compress.empty() &&
+	  codec->getID() == "JPEG")
+	static_cast<JPEGCodec*>(codec)->writeDCT(&s);
+      else
+	ImageCodec::Write(&s, image, "jpeg", "jpg", quality, compress);
     }
 #endif
 #if WITHJASPER == 1
@@ -454,7 +616,8 @@ struct PDFXObject : public PDFStream
   
   uint32_t imageID;
   
-  Image& image;
+  Image* image;
+  const PDFCodec::EncodedImage* encoded;
   std::string compress;
   std::string encoding;
   int quality;
@@ -468,7 +631,8 @@ struct PDFContentStream : public PDFStream
     encoding = "/FlateDecode";
     c.setf(std::ios::fixed, std::ios::floatfield);
     c.setf(std::ios::showpoint);
-    c.precision(8);
+    // 1/100 pt is well below what any device resolves
+    c.precision(_xref.compact ? 2 : 8);
   }
   
   virtual void writeStreamTagsImpl(std::ostream& s)
@@ -486,7 +650,7 @@ struct PDFContentStream : public PDFStream
       s << c.rdbuf();
     }
     
-    c.str().clear(); // just release memory after writing
+    c.str(std::string()); // just release memory after writing
   }
   
   // for the beginning we translate the coordinates manually
@@ -591,7 +755,7 @@ struct PDFPage : public PDFObject
   PDFPage(PDFXref& xref, PDFPages& _parent, double _w, double _h)
     : PDFObject(xref), parent(_parent), w(_w), h(_h), content(xref, *this)
   {
-    parent.pages.push_back(this);
+    parent.pages.push_back(indirectRef());
   }
   
   void addResource(const PDFObject* res)
@@ -659,15 +823,23 @@ struct PDFTrailer
   
   void write(std::ostream& s)
   {
-    s << "\ntrailer\n"
-      "<<\n"
-      "/Size " << xref.objects.size() + 1 << "\n" // total number of entries
-      "/Root " << root.indirectRef() << "\n";
+    std::stringstream dict;
+    dict << "/Root " << root.indirectRef() << "\n";
     if (info)
-      s << "/Info " << info->indirectRef() << "\n";
+      dict << "/Info " << info->indirectRef() << "\n";
     
-    s << ">>\n"
-      "\nstartxref\n"
+    if (xref.compact) {
+      xref.writeStream(s, dict.str());
+    } else {
+      s << xref;
+      s << "\ntrailer\n"
+	"<<\n"
+	"/Size " << xref.entries.size() + 1 << "\n" // total number of entries
+	<< dict.str() <<
+	">>\n";
+    }
+    
+    s << "\nstartxref\n"
       << xref.streamPos << "\n"
       "%%EOF" << std::endl; // final flush, just in case
   }
@@ -784,15 +956,15 @@ void PDFXref::write(std::ostream& s)
   streamPos = s.tellp();
   
   s << "xref\n"
-    "0 " << objects.size() + 1 << "\n";
+    "0 " << entries.size() + 1 << "\n";
   
-  for (unsigned int i = 0; i < objects.size() + 1; ++i)
+  for (unsigned int i = 0; i < entries.size() + 1; ++i)
     {
       uint32_t offset = 0;
       uint16_t generation = 0xFFFF;
       char state = 'f';
       if (i >0) {
-	offset = objects[i-1]->getStreamPos();
+	offset = entries[i-1].offset;
 	generation = 0;
 	state = 'n';
       }
@@ -804,6 +976,64 @@ void PDFXref::write(std::ostream& s)
     }
 }
 
+void PDFXref::writeStream(std::ostream& s, const std::string& trailer)
+{
+  flushObjectStream(s);
+  
+  // the stream is an object itself, and the last one
+  entries.push_back(Entry());
+  const uint32_t id = entries.size();
+  s << "\n";
+  streamPos = s.tellp();
+  entries.back().offset = streamPos;
+  
+  // fields: type, offset or object stream, generation or index
+  uint64_t maxValue = 0;
+  for (unsigned int i = 0; i < entries.size(); ++i)
+    maxValue = std::max(maxValue, entries[i].container ?
+			(uint64_t)entries[i].container : entries[i].offset);
+  int width = 1;
+  while (width < 8 && (maxValue >> (8 * width)))
+    ++width;
+  
+  std::string data;
+  for (unsigned int i = 0; i < entries.size() + 1; ++i)
+    {
+      uint8_t type = 0;
+      uint64_t field2 = 0;
+      uint16_t field3 = 0xFFFF;
+      if (i > 0) {
+	const Entry& entry = entries[i-1];
+	type = entry.container ? 2 : 1;
+	field2 = entry.container ? entry.container : entry.offset;
+	field3 = entry.container ? entry.index : 0;
+      }
+      data += (char)type;
+      for (int b = width - 1; b >= 0; --b)
+	data += (char)(field2 >> (8 * b));
+      data += (char)(field3 >> 8);
+      data += (char)field3;
+    }
+  
+  std::stringstream compressed;
+  EncodeZlib(compressed, data.c_str(), data.size());
+  const std::string& z = compressed.str();
+  
+  s << id << " 0 obj\n"
+    "<<\n"
+    "/Type /XRef\n"
+    "/Size " << entries.size() + 1 << "\n"
+    "/W [1 " << width << " 2]\n"
+    << trailer <<
+    "/Filter /FlateDecode\n"
+    "/Length " << z.size() << "\n"
+    ">>\n"
+    "stream\n";
+  s.write(z.data(), z.size());
+  s << "\nendstream\n"
+    "endobj\n";
+}
+
 struct PDFContext
 {
   std::ostream* s;
@@ -816,58 +1046,65 @@ struct PDFContext
   PDFCatalog catalog;
   PDFTrailer trailer;
   
-  std::list<PDFPage*> pageList;
   PDFPage* currentPage;
   
   std::map<std::string, PDFFont*> fontMap;
   typedef std::map<std::string, PDFFont*>::iterator fontMapIterator;
+  // images of the current page, only needed until the page is written
   std::list<PDFXObject*> images;
   typedef std::list<PDFXObject*>::iterator imageIterator;
   
-  PDFContext(std::ostream* _s)
+  PDFContext(std::ostream* _s, bool compact = false)
     : s(_s), info(xref), pages(xref), catalog(xref, pages),
       trailer(xref, catalog, &info), currentPage(0)
   {
+    xref.compact = compact;
     // TODO: dynamic version depending on features used
     // TODO: place in some object?
-    *s << "%PDF-1.4\n%\xc9\xcc\n"; // early 8-bit indicator cookie
+    *s << (compact ? "%PDF-1.5" : "%PDF-1.4")
+       << "\n%\xc9\xcc\n"; // early 8-bit indicator cookie
     *s << info;
   }
   
   ~PDFContext()
   {
     // write out last page
-    if (currentPage)
-      *s << *currentPage;
+    endPage();
     
     /* PDF stream finalizing */
     *s << pages;
     *s << catalog;
-    *s << xref;
-    *s << trailer;
+    *s << trailer; // with the xref table or stream
     
     /* free dynamically allocated objects */
-    while (!pageList.empty()) {
-      PDFPage* p = pageList.front();
-      delete (p);
-      pageList.pop_front();
-    }
-    
     for (fontMapIterator it = fontMap.begin(); it != fontMap.end(); ++it)
       delete it->second;
+  }
+  
+  // write out the current page and its content, and free it together
+  // with its images, only the xref offsets are kept
+  void endPage()
+  {
+    if (!currentPage)
+      return;
+    
+    *s << *currentPage;
+    s->flush();
+    
+    delete currentPage;
+    currentPage = 0;
     
     for (imageIterator it = images.begin(); it != images.end(); ++it)
       delete *it;
+    images.clear();
   }
   
   void beginPage(double w, double h)
   {
-    // write out last page, also frees some memory
-    if (currentPage)
-      *s << *currentPage;
+    // write out last page, also frees its memory
+    endPage();
     
     currentPage = new PDFPage(xref, pages, w, h);
-    pageList.push_back(currentPage);
   }
   
   PDFFont* getFont(const std::string& f)
@@ -905,9 +1142,9 @@ bool PDFCodec::writeImage (std::ostream* stream, Image& image, int quality,
 
 // TODO: assert on each context ref
 
-PDFCodec::PDFCodec(std::ostream* s)
+PDFCodec::PDFCodec(std::ostream* s, bool compact)
 {
-  context = new PDFContext(s);
+  context = new PDFContext(s, compact);
 }
 
 PDFCodec::~PDFCodec()
@@ -990,6 +1227,39 @@ void PDFCodec::showText(const std::string& font, const std::string& text,
   context->currentPage->content.showText(*f, text, height);
 }
 
+void PDFCodec::encodeImage(Image& image, EncodedImage& encoded,
+			   int quality, const std::string& compress)
+{
+  PDFXref xref; // not written, just for the object id
+  PDFXObject i(xref, image, compress, quality);
+  i.selectEncoding();
+  
+  std::stringstream s;
+  i.writeStreamImpl(s);
+  
+  encoded.w = image.w;
+  encoded.h = image.h;
+  encoded.spp = image.spp;
+  encoded.bps = image.bps;
+  encoded.filter = i.encoding;
+  encoded.data = s.str();
+}
+
+void PDFCodec::encodeImageMask(Image& image, EncodedImage& encoded)
+{
+  encodeImage(image, encoded, 0, "g4");
+  encoded.imageMask = true;
+}
+
+void PDFCodec::showImage(const EncodedImage& image, double x, double y,
+			 double width, double height)
+{
+  PDFXObject* i = new PDFXObject(context->xref, image);
+  *context->s << *i;
+  context->currentPage->content.showImage(*i, x, y, width, height);
+  context->images.push_back(i);
+}
+
 void PDFCodec::showImage(Image& image, double x, double y,
 			 double width, double height, int quality,
 			 const std::string& compress)
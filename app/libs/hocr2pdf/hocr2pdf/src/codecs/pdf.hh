@@ -31,8 +31,9 @@ public:
 
   ~PDFCodec ();
   
-  // freestanding
-  PDFCodec (std::ostream* s);
+  // freestanding, compact writes a PDF 1.5 file with the objects other
+  // than streams in compressed object streams and a cross-reference stream
+  PDFCodec (std::ostream* s, bool compact = false);
   
   virtual std::string getID () { return "PDF"; };
   
@@ -75,6 +76,27 @@ public:
   void showImage(Image& image, double x, double y,
 		 double width, double height, int quality = 80,
 		 const std::string& compress = "");
+  
+  // image stream encoded ahead of time, e.g. on a worker thread while
+  // other pages are written, so that showImage only has to copy it
+  struct EncodedImage
+  {
+    EncodedImage() : w(0), h(0), spp(0), bps(0), imageMask(false) {}
+    int w, h, spp, bps;
+    bool imageMask;
+    std::string filter;
+    std::string data;
+  };
+  
+  // thread-safe, does not touch the document
+  static void encodeImage(Image& image, EncodedImage& encoded,
+			  int quality = 80, const std::string& compress = "");
+  // a 1 bit image as stencil mask, showImage() paints its black pixels
+  // in the fill color and leaves the others transparent
+  static void encodeImageMask(Image& image, EncodedImage& encoded);
+  // writes the image object right away, encoded may be freed afterwards
+  void showImage(const EncodedImage& image, double x, double y,
+		 double width, double height);
   void endText();
   
 private:
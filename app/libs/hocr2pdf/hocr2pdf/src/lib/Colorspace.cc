@@ -20,6 +20,12 @@
 #include <iostream>
 #include <map>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #include "Image.hh"
 #include "ImageIterator2.hh"
 
@@ -113,10 +119,27 @@ void normalize (Image& image, uint8_t l, uint8_t h)
   codegen<normalize_template> (image, l, h);
 }
 
+// 8 bit rows have no padding, so the whole image is converted as one row,
+// the vector loops work in place as they never write ahead of what they read
+
 void colorspace_rgba8_to_rgb8 (Image& image)
 {
-  uint8_t* output = image.getRawData();
-  for (uint8_t* it = image.getRawData(); it < image.getRawData() + image.w*image.h*image.spp;)
+  const int n = image.w * image.h;
+  uint8_t* it = image.getRawData();
+  uint8_t* output = it;
+  int i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16x4_t rgba = vld4q_u8 (it + 4 * i);
+      uint8x16x3_t rgb;
+      rgb.val[0] = rgba.val[0];
+      rgb.val[1] = rgba.val[1];
+      rgb.val[2] = rgba.val[2];
+      vst3q_u8 (output + 3 * i, rgb);
+    }
+#endif
+  for (it += 4 * i, output += 3 * i; i < n; ++i)
     {
       *output++ = *it++;
       *output++ = *it++;
@@ -127,11 +150,43 @@ void colorspace_rgba8_to_rgb8 (Image& image)
   image.setRawData();
 }
 
+#if defined(__ARM_NEON)
+// R G B weighting as below, c / 100 == (c * 41944) >> 22 for all c <= 255 * 98
+static inline uint8x8_t rgb8_to_gray8_neon (uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+  uint16x8_t c = vmull_u8 (r, vdup_n_u8 (28));
+  c = vmlal_u8 (c, g, vdup_n_u8 (59));
+  c = vmlal_u8 (c, b, vdup_n_u8 (11));
+  const uint16x4_t f = vdup_n_u16 (41944);
+  uint16x8_t q = vcombine_u16 (vshrn_n_u32 (vmull_u16 (vget_low_u16 (c), f), 16),
+			       vshrn_n_u32 (vmull_u16 (vget_high_u16 (c), f), 16));
+  return vmovn_u16 (vshrq_n_u16 (q, 6));
+}
+#endif
 
 void colorspace_rgb8_to_gray8 (Image& image, const int bytes)
 {
-  uint8_t* output = image.getRawData();
-  for (uint8_t* it = image.getRawData(); it < image.getRawData() + image.stride() * image.h; it += bytes)
+  const int n = image.stride() * image.h / bytes;
+  uint8_t* it = image.getRawData();
+  uint8_t* output = it;
+  int i = 0;
+#if defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16)
+    {
+      uint8x16_t r, g, b;
+      if (bytes == 4) {
+	uint8x16x4_t v = vld4q_u8 (it + 4 * i);
+	r = v.val[0]; g = v.val[1]; b = v.val[2];
+      } else {
+	uint8x16x3_t v = vld3q_u8 (it + 3 * i);
+	r = v.val[0]; g = v.val[1]; b = v.val[2];
+      }
+      vst1q_u8 (output + i,
+		vcombine_u8 (rgb8_to_gray8_neon (vget_low_u8 (r), vget_low_u8 (g), vget_low_u8 (b)),
+			     rgb8_to_gray8_neon (vget_high_u8 (r), vget_high_u8 (g), vget_high_u8 (b))));
+    }
+#endif
+  for (it += bytes * i, output += i; i < n; ++i, it += bytes)
     {
       // R G B order and associated weighting
       int c = (int)it[0] * 28;
@@ -280,10 +335,44 @@ void colorspace_gray8_to_gray1 (Image& image, uint8_t threshold)
   uint8_t *output = image.getRawData();
   uint8_t *input = image.getRawData();
   
+#if defined(__SSE2__)
+  const __m128i t = _mm_set1_epi8 (threshold);
+  const __m128i zero = _mm_setzero_si128 ();
+#elif defined(__ARM_NEON)
+  const uint8x16_t t = vdupq_n_u8 (threshold);
+  static const uint8_t weights[16] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+				       0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+  const uint8x16_t w = vld1q_u8 (weights);
+#endif
+  
   for (int row = 0; row < image.h; row++)
     {
       uint8_t z = 0;
       int x = 0;
+      // 16 pixels at a time, the first pixel goes to the most significant bit
+#if defined(__SSE2__)
+      for (; x + 16 <= image.w; x += 16, input += 16)
+	{
+	  __m128i v = _mm_loadu_si128 ((const __m128i*) input);
+	  // above the threshold if the saturated difference is not zero
+	  __m128i white = _mm_andnot_si128 (_mm_cmpeq_epi8 (_mm_subs_epu8 (v, t), zero),
+					    _mm_set1_epi8 (-1));
+	  // reverse the bytes of each half, for the sign bits in msb first order
+	  white = _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (white, 0x1b), 0x1b);
+	  white = _mm_or_si128 (_mm_slli_epi16 (white, 8), _mm_srli_epi16 (white, 8));
+	  const int bits = _mm_movemask_epi8 (white);
+	  *output++ = bits;
+	  *output++ = bits >> 8;
+	}
+#elif defined(__ARM_NEON)
+      for (; x + 16 <= image.w; x += 16, input += 16)
+	{
+	  uint8x16_t white = vandq_u8 (vcgtq_u8 (vld1q_u8 (input), t), w);
+	  uint64x2_t bits = vpaddlq_u32 (vpaddlq_u16 (vpaddlq_u8 (white)));
+	  *output++ = vgetq_lane_u64 (bits, 0);
+	  *output++ = vgetq_lane_u64 (bits, 1);
+	}
+#endif
       for (; x < image.w; x++)
 	{
 	  z <<= 1;
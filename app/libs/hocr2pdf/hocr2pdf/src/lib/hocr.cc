@@ -22,6 +22,7 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
 #include <cmath>
 #include <cctype>
 #include <sstream>
@@ -31,21 +32,9 @@
 #include "../codecs/pdf.hh"
 
 #include "hocr.hh"
+#include "textlayer.hh"
 #include "entities.h"
 
-static int res = 300;
-static bool sloppy = false;
-static bool straightenTextLines = false;
-static PDFCodec* pdfContext = 0;
-static std::ostream* txtStream = 0;
-static std::string txtString;
-
-std::string lowercaseStr(const std::string& _s) {
-	std::string s(_s);
-	std::transform(s.begin(), s.end(), s.begin(), tolower);
-	return s;
-}
-
 // custom copy to trip newlines, likewise
 bool isMyBlank(char c) {
 	switch (c) {
@@ -60,22 +49,6 @@ bool isMyBlank(char c) {
 	}
 }
 
-std::string peelWhitespaceStr(const std::string& _s) {
-	std::string s(_s);
-	// trailing whitespace
-	for (int i = s.size() - 1; i >= 0 && isMyBlank(s[i]); --i)
-		s.erase(i, 1);
-	// leading whitespace
-	while (!s.empty() && isMyBlank(s[0]))
-		s.erase(0, 1);
-	return s;
-}
-
-// lower-case, and strip leading/trailing white-space
-std::string sanitizeStr(const std::string& _s) {
-	return peelWhitespaceStr(lowercaseStr(_s));
-}
-
 // HTML decode
 
 std::string htmlDecode(const std::string& _s) {
@@ -86,31 +59,88 @@ std::string htmlDecode(const std::string& _s) {
 	return s;
 }
 
-// state per char: bbox, bold, italic, boldItalic
-// state per line: bbox, align: left, right justified
+// a range of the hOCR buffer, the parser does not copy tags or attributes
+struct Token {
+	Token() : begin(0), end(0) {
+	}
+
+	Token(const char* _begin, const char* _end) : begin(_begin), end(_end) {
+	}
 
-struct BBox {
-	BBox() :
-		x1(0), y1(0), x2(0), y2(0) {
+	bool empty() const {
+		return begin == end;
 	}
 
-	bool operator==(const BBox& other) {
-		return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2
-				== other.y2;
+	size_t size() const {
+		return end - begin;
+	}
+
+	std::string str() const {
+		return std::string(begin, end);
+	}
+
+	const char* begin;
+	const char* end;
+};
+
+bool equalsIgnoreCase(const Token& t, const char* s) {
+	const char* p = t.begin;
+	for (; p != t.end && *s; ++p, ++s) {
+		if (tolower((unsigned char) *p) != *s)
+			return false;
+	}
+	return p == t.end && *s == 0;
+}
+
+bool operator==(const Token& a, const Token& b) {
+	return a.size() == b.size() && memcmp(a.begin, b.begin, a.size()) == 0;
+}
+
+// returns the position of the lower-case key in t, or 0
+const char* findIgnoreCase(const Token& t, const char* key) {
+	size_t n = strlen(key);
+	for (const char* p = t.begin; p + n <= t.end; ++p) {
+		size_t i = 0;
+		while (i < n && tolower((unsigned char) p[i]) == key[i])
+			++i;
+		if (i == n)
+			return p;
 	}
+	return 0;
+}
 
-	double x1, y1, x2, y2;
-} lastBBox;
+// parses a decimal number after optional white-space, returns the position
+// behind it or 0 if there is none
+const char* parseNumber(const char* p, const char* end, double& value) {
+	while (p != end && isMyBlank(*p))
+		++p;
+	bool negative = false;
+	if (p != end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		++p;
+	}
+	bool digits = false;
+	double v = 0;
+	for (; p != end && isdigit((unsigned char) *p); ++p, digits = true)
+		v = v * 10 + (*p - '0');
+	if (p != end && *p == '.') {
+		double scale = 0.1;
+		for (++p; p != end && isdigit((unsigned char) *p); ++p, digits = true) {
+			v += (*p - '0') * scale;
+			scale /= 10;
+		}
+	}
+	if (!digits)
+		return 0;
+	value = negative ? -v : v;
+	return p;
+}
 
 std::ostream& operator<<(std::ostream& s, const BBox& b) {
 	s << b.x1 << ", " << b.y1 << ", " << b.x2 << ", " << b.y2;
 	return s;
 }
 
-enum Style {
-	None = 0, Bold = 1, Italic = 2, BoldItalic = (Bold | Italic)
-} lastStyle;
-
 std::ostream& operator<<(std::ostream& s, const Style& st) {
 	switch (st) {
 	case Bold:
@@ -132,394 +162,283 @@ std::ostream& operator<<(std::ostream& s, const Style& st) {
 // TODO: implement parsing, if of any guidance for the PDF
 enum Align {
 	Left = 0, Right = 1, Justify = 2,
-} lastAlign;
-
-struct Span {
-	BBox bbox;
-	Style style;
-	std::string text;
 };
 
-struct Textline {
-	BBox bbox;
-	int size;
-	int descenders;
-	float baseline1;
-	float baseline2;
-
-	bool hasDescenders(std::string word){
-		//const char* descenders = "qpgjy";
-		if (word.find('q')!=std::string::npos ||
-			word.find('p')!=std::string::npos ||
-			word.find('g')!=std::string::npos ||
-			word.find('j')!=std::string::npos ||
-			word.find('y')!=std::string::npos){
-			return true;
-		}
-		return false;
+// appends text to the line, do not insert newline garbage (white-space only
+// text) at the beginning of a line
+void appendText(Textline& line, Token text, const BBox& bbox, Style style) {
+	std::vector<Span>& spans = line.spans;
+	if (spans.empty()) {
+		while (!text.empty() && isMyBlank(*text.begin))
+			++text.begin;
+		if (text.empty())
+			return;
 	}
 
-	std::vector<Span> spans;
-	typedef std::vector<Span>::iterator span_iterator;
-
-	void draw() {
-		int n = 0;
-
-		// remove trailing whitespace
-		for (span_iterator it = spans.end(); it != spans.begin(); --it) {
-			span_iterator it2 = it;
-			--it2;
-			for (int i = it2->text.size() - 1; i >= 0; --i) {
-				if (isMyBlank(it2->text[i]))
-					it2->text.erase(i);
-				else
-					goto whitespace_cleaned;
-			}
-		}
-
-		whitespace_cleaned:
-
-		/*
-		double x1 = 72. * bbox.x1 / res;
-		double x2 = 72. * bbox.x2 / res;
-		double y1 = 72. * bbox.y1 / res;
-		double y2 = 72. * bbox.y2 / res;
-		pdfContext->moveTo(x1, y2);
-		pdfContext->addLineTo(x2, y2);
-		pdfContext->addLineTo(x2, y1);
-		pdfContext->addLineTo(x1, y1);
-		pdfContext->addLineTo(x1, y2);
-		pdfContext->showPath();
-		*/
-
-		//the baseline params should be interpreted like this:
-		//float b = (bbox.x1 * baseline1 + baseline2);
-		//but we try to keep a perfect straight line to make some pdf readers happy
-		float b = (baseline2);
-		std::cout <<"baseline mod = "<<b<<"\n";
-
-
-		int height = 0;
-		if(size>0){
-			height = size *	72.0 / res;
-		} else {
-			double y1 = 72. * bbox.y1 / res;
-			double y2 = 72. * ((b/2) + bbox.y2) / res;
-			height = y2-y1;
-		}
-
-		for (span_iterator it = spans.begin(); it!= spans.end(); ++it, ++n) {
-			std::string text = htmlDecode(it->text);
-			BBox spanbbox = it->bbox;
-
-			const char* font = "Helvetica";
-			switch (it->style) {
-			case Bold:
-				font = "Helvetica-Bold";
-				break;
-			case Italic:
-				font = "Helvetica-Oblique";
-				break;
-			case BoldItalic:
-				font = "Helvetica-BoldOblique";
-				break;
-			default:
-				; // already initialized
-			}
-		double y;
-			if (::straightenTextLines==true){
-				y =  (72. * (b+bbox.y2) / res); //use y value from bounding box of the line
-			} else {
-				double t = spanbbox.y2;
-				if (hasDescenders(text)){
-					t-=descenders;
-				}
-				y = 72. * t / res;
-			}
-
-			std::cout <<text <<" "<< " x="<<(72. * spanbbox.x1  / res) <<"  y="<< y << " height="<<height<<"\n";
-			pdfContext->textTo(72. * spanbbox.x1 / res, y);
-			pdfContext->showText(font, text, height);
-			if (txtStream) {
-				txtString += text;
-			}
-		}
-		if (txtStream) {
-			txtString += "\n";
-		}
-
+	// unify inserted spans with same properties, for now to
+	// not draw them at the same position, but one text operator
+	if (!spans.empty() && (spans.back().bbox == bbox)
+			&& (spans.back().style == style)) {
+		spans.back().text.append(text.begin, text.size());
+	} else {
+		spans.push_back(Span());
+		Span& s = spans.back();
+		s.bbox = bbox;
+		s.style = style;
+		s.text.assign(text.begin, text.size());
 	}
+}
 
-
-	void flush() {
-		if (!spans.empty())
-			draw();
-		spans.clear();
+// all state of one hocr2pdf() call, so that several pages can be converted
+// at the same time
+struct HocrContext {
+	HocrContext() :
+		pdfContext(0), res(300), sloppy(false), straightenTextLines(false),
+		txtStream(0), lastStyle(None) {
 	}
 
-	void push_back(Span s) {
-		//std::cerr << "push_back (" << s.text << ") " << s.style << std::endl;
+	PDFCodec* pdfContext;
+	int res;
+	bool sloppy;
+	bool straightenTextLines;
+	std::ostream* txtStream;
+	std::string txtString;
 
-		// do not insert newline garbage (empty string after white-
-		// space peeling) at the beginning of a line
-		if (spans.empty()) {
-			s.text = peelWhitespaceStr(s.text);
-			if (s.text.empty())
-				return;
-		}
+	BBox lastBBox;
+	Style lastStyle;
+	Textline textline;
+};
 
-		// if the direction wrapps, assume new line
-//		if (!spans.empty() && s.bbox.x1 < spans.back().bbox.x1)
-//			flush();
-
-		// unify inserted spans with same properties, for now to
-		// not draw them at the same position, but one text operator
-		if (!spans.empty() && (spans.back().bbox == s.bbox)
-				&& (spans.back().style == s.style))
-			spans.back().text += s.text;
-		else
-			spans.push_back(s);
+void flushLine(HocrContext& context) {
+	Textline& textline = context.textline;
+	if (!textline.spans.empty()) {
+		for (Textline::span_iterator it = textline.spans.begin();
+				it != textline.spans.end(); ++it)
+			it->text = htmlDecode(it->text);
+		textline.draw(context.pdfContext, context.res,
+				context.straightenTextLines,
+				context.txtStream ? &context.txtString : 0);
 	}
+	textline.spans.clear();
+}
 
-} textline;
-
-bool isNewLine(std::string attr) {
-	const char* ocr_line = "ocr_line";
-	std::string::size_type i = attr.find(ocr_line);
-	if (i == std::string::npos) {
-		return false;
-	} else {
-		return true;
-	}
+bool isNewLine(const Token& attr) {
+	return findIgnoreCase(attr, "ocr_line") != 0;
 }
 
-void parseBaseline(std::string attr, Textline& line) {
+void parseBaseline(const Token& attr, Textline& line) {
 	const char* ocr_line = "baseline";
-	std::string::size_type i = attr.find(ocr_line);
-	if (i == std::string::npos) {
+	const char* i = findIgnoreCase(attr, ocr_line);
+	if (i == 0) {
 		return;
 	}
-	std::stringstream stream(attr.substr(i + strlen(ocr_line)));
-
-	stream >> line.baseline1>>line.baseline2;
+	double b1, b2;
+	i = parseNumber(i + strlen(ocr_line), attr.end, b1);
+	if (i == 0)
+		return;
+	line.baseline1 = b1;
+	if (parseNumber(i, attr.end, b2))
+		line.baseline2 = b2;
 }
 
-int parseDescenders(std::string s) {
-	const char* tS = "descenders='";
-	std::string::size_type i = s.find(tS);
-	if (i == std::string::npos)
+// returns the integer value of a key='value' attribute or 0
+int parseQuotedInt(const Token& s, const char* tS) {
+	const char* i = findIgnoreCase(s, tS);
+	if (i == 0)
 		return 0;
-
-	std::string::size_type i2 = s.find("'", i + strlen(tS));
-	if (i2 == std::string::npos)
+	Token value(i + strlen(tS), i + strlen(tS));
+	while (value.end != s.end && *value.end != '\'')
+		++value.end;
+	if (value.end == s.end)
 		return 0;
-	std::string sizeStr = s.substr(i + strlen(tS), i2 - i - strlen(tS));
-	std::istringstream converter(sizeStr);
-	int result;
-	converter >> result;
-	return result;
+	double result = 0;
+	parseNumber(value.begin, value.end, result);
+	return (int) result;
 }
-int parseSize(std::string s) {
-	std::cout <<"parseSize"<< " "<<s<<"\n";;
 
-	const char* tS = "size='";
-	std::string::size_type i = s.find(tS);
-	if (i == std::string::npos)
-		return 0;
-
-	std::string::size_type i2 = s.find("'", i + strlen(tS));
-	if (i2 == std::string::npos)
-		return 0;
-	std::string sizeStr = s.substr(i + strlen(tS), i2 - i - strlen(tS));
-	std::istringstream converter(sizeStr);
-	int result;
-	converter >> result;
-	std::cout <<"size = "<< result <<"\n";;
+int parseDescenders(const Token& s) {
+	return parseQuotedInt(s, "descenders='");
+}
 
-	return result;
+int parseSize(const Token& s) {
+	return parseQuotedInt(s, "size='");
 }
 
-BBox parseBBox(std::string s) {
+BBox parseBBox(const Token& s) {
 	BBox b; // self initialized to zero
-	//std::cout <<"parseBBox"<< " "<<s<<"\n";;
 	const char* tS = "bbox ";
 
-	std::string::size_type i = s.find(tS);
-	if (i == std::string::npos) {
+	const char* i = findIgnoreCase(s, tS);
+	if (i == 0) {
 		return b;
 	}
-//	std::cout <<"found box\n";
-
-	std::stringstream stream(s.substr(i + strlen(tS)));
-	stream >> b.x1 >> b.y1 >> b.x2 >> b.y2;
 
-	//std::cout <<"x1="<<b.x1<<"\n";
+	double* values[] = { &b.x1, &b.y1, &b.x2, &b.y2 };
+	i += strlen(tS);
+	for (int n = 0; n < 4 && i; ++n)
+		i = parseNumber(i, s.end, *values[n]);
 
 	return b;
 }
 
-void elementStart(const std::string& _name, const std::string& _attr = "") {
-	std::string name(sanitizeStr(_name)), attr(sanitizeStr(_attr));
-
-	//std::cerr << "elementStart: '" << name << "', attr: '" << attr << "'" << std::endl;
-
+void elementStart(HocrContext& context, const Token& name, const Token& attr) {
 	BBox bbox = parseBBox(attr);
 	if (bbox.x2 > 0 && bbox.y2 > 0) {
-		lastBBox = bbox;
+		context.lastBBox = bbox;
 	}
 
-	bool newLine = isNewLine(attr);
-	if (newLine==true) {
-		textline.flush();
+	if (isNewLine(attr)) {
+		flushLine(context);
+		Textline& textline = context.textline;
 		textline.size = parseSize(attr);
 		textline.descenders = parseDescenders(attr);
 		textline.bbox = bbox;
 		parseBaseline(attr, textline);
 	}
 
-	if (name == "b" || name == "strong")
-		lastStyle = Style(lastStyle | Bold);
-	else if (name == "i" || name == "em")
-		lastStyle = Style(lastStyle | Italic);
-
+	if (equalsIgnoreCase(name, "b") || equalsIgnoreCase(name, "strong"))
+		context.lastStyle = Style(context.lastStyle | Bold);
+	else if (equalsIgnoreCase(name, "i") || equalsIgnoreCase(name, "em"))
+		context.lastStyle = Style(context.lastStyle | Italic);
 }
 
-void elementText(const std::string& text) {
-	//std::cerr << "elementText: \"" << text << "\"" << std::endl;
-	Span s;
-	s.bbox = lastBBox;
-	s.style = lastStyle;
-	s.text += text;
-
-	textline.push_back(s);
+void elementText(HocrContext& context, const Token& text) {
+	appendText(context.textline, text, context.lastBBox, context.lastStyle);
 }
 
-void elementEnd(const std::string& _name) {
-	std::string name(sanitizeStr(_name));
-
-	//std::cerr << "elementEnd: " << name << std::endl;
-
-	if (name == "b" || name == "strong")
-		lastStyle = Style(lastStyle & ~Bold);
-	else if (name == "i" || name == "em")
-		lastStyle = Style(lastStyle & ~Italic);
+void elementEnd(HocrContext& context, const Token& name) {
+	if (equalsIgnoreCase(name, "b") || equalsIgnoreCase(name, "strong"))
+		context.lastStyle = Style(context.lastStyle & ~Bold);
+	else if (equalsIgnoreCase(name, "i") || equalsIgnoreCase(name, "em"))
+		context.lastStyle = Style(context.lastStyle & ~Italic);
 
 	// explicitly flush line of text on manual break or end of paragraph
 //	else if (name == "br" || name == "p")
 //		textline.flush();
 }
 
-// returns the string before the first whitespace
-std::string tagName(std::string t) {
-	std::string::size_type i = t.find(' ');
-	if (i != std::string::npos)
-		t.erase(i);
-	return t;
+// returns the part of the tag before the first whitespace
+Token tagName(const Token& t) {
+	Token name(t.begin, t.begin);
+	while (name.end != t.end && !isMyBlank(*name.end))
+		++name.end;
+	return name;
+}
+
+void hocrWordBoxes(const char* hocr, size_t size, std::vector<BBox>& boxes) {
+	const char* p = hocr;
+	const char* end = hocr + size;
+	while ((p = (const char*) memchr(p, '<', end - p)) != 0) {
+		const char* tagEnd = (const char*) memchr(p, '>', end - p);
+		if (!tagEnd)
+			break;
+		Token tag(p + 1, tagEnd);
+		// older Tesseract versions put the bbox on an ocr_word around the ocrx_word
+		if (findIgnoreCase(tag, "ocrx_word") || findIgnoreCase(tag, "ocr_word")) {
+			BBox bbox = parseBBox(tag);
+			if (bbox.x2 > bbox.x1 && bbox.y2 > bbox.y1)
+				boxes.push_back(bbox);
+		}
+		p = tagEnd + 1;
+	}
 }
 
 bool hocr2pdf(std::istream& hocrStream, PDFCodec* pdfContext, unsigned int res,
 		bool sloppy, bool straightenTextLines,std::ostream* txtStream ) {
+	std::string hocr((std::istreambuf_iterator<char>(hocrStream)),
+			std::istreambuf_iterator<char>());
+	return hocr2pdf(hocr.data(), hocr.size(), pdfContext, res, sloppy,
+			straightenTextLines, txtStream);
+}
+
+bool hocr2pdf(const char* hocr, size_t size, PDFCodec* pdfContext, unsigned int res,
+		bool sloppy, bool straightenTextLines,std::ostream* txtStream ) {
 	// TODO: soft hyphens
 	// TODO: better text placement, using one TJ with spacings
 	// TODO: more image compressions, jbig2, Fax
 
-	// TODO: do not use global vars, use a state container
-	::pdfContext = pdfContext;
-	::res = res;
-	::sloppy = sloppy;
-	::txtStream = txtStream;
-	::straightenTextLines = straightenTextLines;
+	HocrContext context;
+	context.pdfContext = pdfContext;
+	context.res = res;
+	context.sloppy = sloppy;
+	context.txtStream = txtStream;
+	context.straightenTextLines = straightenTextLines;
 
 	pdfContext->beginText();
 
-	// minimal, cuneiform HTML ouptut parser
-	char c;
-	std::vector<std::string> openTags;
-	std::string* curTag = 0;
-	std::string closingTag;
-	while (hocrStream.get(c), hocrStream.good()) {
-		// consume tag element text
-		if (curTag && c != '>') {
-			*curTag += c;
+	// minimal, cuneiform HTML ouptut parser: text between tags is passed on
+	// in one piece, tags are only looked at where they are in the buffer
+	std::vector<Token> openTags;
+	const char* p = hocr;
+	const char* end = hocr + size;
+	while (p != end) {
+		if (*p != '<') {
+			const char* text = p;
+			p = (const char*) memchr(p, '<', end - p);
+			if (!p)
+				p = end;
+			elementText(context, Token(text, p));
 			continue;
 		}
 
-		switch (c) {
-		case '<':
-			if (hocrStream.peek() != '/') {
-				openTags.push_back("");
-				curTag = &openTags.back();
-			} else {
-				closingTag.clear();
-				curTag = &closingTag;
-			}
+		const char* tagEnd = (const char*) memchr(p, '>', end - p);
+		if (!tagEnd) {
+			std::cerr << "Warning: unterminated tag at end of input" << std::endl;
 			break;
-		case '>':
-			if (curTag != &closingTag) {
-				bool closed = false;
-				if (!curTag->empty() && curTag->at(curTag->size() - 1) == '/') {
-					curTag->erase(curTag->size() - 1);
-					closed = true;
-				}
+		}
+		Token tag(p + 1, tagEnd);
+		p = tagEnd + 1;
+
+		if (tag.empty() || *tag.begin != '/') {
+			bool closed = false;
+			if (!tag.empty() && tag.end[-1] == '/') {
+				--tag.end;
+				closed = true;
+			}
 
-				// HTML asymetric tags, TODO: more of those (and !DOCTYPE)?
-				// TODO: maybe specially treat meta & co?
-				{
-					std::string lowTag = lowercaseStr(tagName(*curTag));
-					if (lowTag == "br" || lowTag == "img" || lowTag == "meta")
-						closed = true;
-				}
+			Token element = tagName(tag);
+			// skip special tags such as !DOCTYPE, comments and <?xml ...?>
+			if (!element.empty() && (*element.begin == '!' || *element.begin == '?'))
+				continue;
 
-				//std::cout << "tag start: " << openTags.back()
-				//          << (closed ? " immediately closed" : "") << std::endl;
-				{
-					std::string element = tagName(*curTag);
-					std::string attr = *curTag;
-					attr.erase(0, element.size());
-					elementStart(element, attr);
-				}
+			// HTML asymetric tags, TODO: more of those?
+			if (equalsIgnoreCase(element, "br") || equalsIgnoreCase(element, "img")
+					|| equalsIgnoreCase(element, "meta"))
+				closed = true;
 
-				if (closed) {
-					elementEnd(*curTag);
-					openTags.pop_back();
-				}
-			} else {
-				// garuanteed to begin with a /, remove it
-				curTag->erase(0, 1);
-				// get just the tag name from the stack
-				std::string lastOpenTag = (openTags.empty() ? ""
-						: openTags.back());
-				lastOpenTag = tagName(lastOpenTag);
-				if (lastOpenTag != *curTag) {
-					std::cout << "Warning: tag mismatch: '" << *curTag
-							<< "' can not close last open: '" << lastOpenTag
-							<< "'" << std::endl;
-				} else
-					openTags.pop_back();
-				elementEnd(*curTag);
-			}
-			curTag = 0;
-			break;
+			elementStart(context, element, Token(element.end, tag.end));
 
-		default:
-			elementText(std::string(1, c));
-			break;
+			if (closed)
+				elementEnd(context, element);
+			else
+				openTags.push_back(element);
+		} else {
+			// garuanteed to begin with a /, remove it
+			++tag.begin;
+			Token element = tagName(tag);
+			// get just the tag name from the stack
+			Token lastOpenTag = (openTags.empty() ? Token() : openTags.back());
+			if (!(lastOpenTag == element)) {
+				std::cout << "Warning: tag mismatch: '" << element.str()
+						<< "' can not close last open: '" << lastOpenTag.str()
+						<< "'" << std::endl;
+			} else
+				openTags.pop_back();
+			elementEnd(context, element);
 		}
 	}
 
 	while (!openTags.empty()) {
-		std::string tag = tagName(openTags.back());
+		std::cerr << "Warning: unclosed tag: '" << openTags.back().str() << "'" << std::endl;
 		openTags.pop_back();
-		// skip special tags such as !DOCTYPE
-		if (tag.empty() || tag[0] != '!')
-			std::cerr << "Warning: unclosed tag: '" << tag << "'" << std::endl;
 	}
 
-	textline.flush();
+	flushLine(context);
 
 	pdfContext->endText();
 
 	if (txtStream) {
+		std::string& txtString = context.txtString;
 		// for now hypenation compensator, later to be inserted to the
 		// generic code-flow to detect and write out soft-hypens on-the-go
 
@@ -546,7 +465,6 @@ bool hocr2pdf(std::istream& hocrStream, PDFCodec* pdfContext, unsigned int res,
 		}
 
 		*txtStream << txtString;
-		txtString.clear();
 	}
 
 	return true; // or error
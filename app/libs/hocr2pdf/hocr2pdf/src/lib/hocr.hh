@@ -20,3 +20,14 @@
 bool hocr2pdf(std::istream& hocrStream, PDFCodec* pdfContext,
 	      unsigned int res,  bool sloppy = false, bool straightenTextLines = false,
 	      std::ostream* txtStream = 0);
+
+// parses the hOCR in [hocr, hocr + size), keeps no state between calls
+bool hocr2pdf(const char* hocr, size_t size, PDFCodec* pdfContext,
+	      unsigned int res,  bool sloppy = false, bool straightenTextLines = false,
+	      std::ostream* txtStream = 0);
+
+struct BBox; // textlayer.hh
+
+// appends the bbox of every ocrx_word or ocr_word in [hocr, hocr + size), in
+// image pixels
+void hocrWordBoxes(const char* hocr, size_t size, std::vector<BBox>& boxes);
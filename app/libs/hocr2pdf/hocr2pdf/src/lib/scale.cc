@@ -21,6 +21,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <vector>
 
 #include "Image.hh"
 #include "ImageIterator2.hh"
@@ -30,6 +31,12 @@
 
 #include "scale.hh"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 void scale (Image& image, double scalex, double scaley)
 {
   if (scalex == 1.0 && scaley == 1.0)
@@ -156,7 +163,7 @@ struct box_scale_template
     // prepare boxes
     std::vector<typename T::accu> boxes(new_image.w);
     std::vector<int> count(new_image.w);
-    std::vector<int> bindex(new_image.w);
+    std::vector<int> bindex(image.w);
     for (int sx = 0; sx < image.w; ++sx)
       bindex[sx] = std::min ((int)(scalex * sx), new_image.w - 1);
     
@@ -192,10 +199,93 @@ struct box_scale_template
   }
 };
 
+// sums[i] += row[i] for the samples of a row
+static void box_scale_add_row (uint32_t* sums, const uint8_t* row, int n)
+{
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128 ();
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128 ((const __m128i*) (row + i));
+    __m128i lo = _mm_unpacklo_epi8 (v, zero);
+    __m128i hi = _mm_unpackhi_epi8 (v, zero);
+    __m128i* s = (__m128i*) (sums + i);
+    _mm_storeu_si128 (s, _mm_add_epi32 (_mm_loadu_si128 (s), _mm_unpacklo_epi16 (lo, zero)));
+    _mm_storeu_si128 (s + 1, _mm_add_epi32 (_mm_loadu_si128 (s + 1), _mm_unpackhi_epi16 (lo, zero)));
+    _mm_storeu_si128 (s + 2, _mm_add_epi32 (_mm_loadu_si128 (s + 2), _mm_unpacklo_epi16 (hi, zero)));
+    _mm_storeu_si128 (s + 3, _mm_add_epi32 (_mm_loadu_si128 (s + 3), _mm_unpackhi_epi16 (hi, zero)));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t v = vld1q_u8 (row + i);
+    uint16x8_t lo = vmovl_u8 (vget_low_u8 (v));
+    uint16x8_t hi = vmovl_u8 (vget_high_u8 (v));
+    uint32_t* s = sums + i;
+    vst1q_u32 (s, vaddw_u16 (vld1q_u32 (s), vget_low_u16 (lo)));
+    vst1q_u32 (s + 4, vaddw_u16 (vld1q_u32 (s + 4), vget_high_u16 (lo)));
+    vst1q_u32 (s + 8, vaddw_u16 (vld1q_u32 (s + 8), vget_low_u16 (hi)));
+    vst1q_u32 (s + 12, vaddw_u16 (vld1q_u32 (s + 12), vget_high_u16 (hi)));
+  }
+#endif
+  for (; i < n; ++i)
+    sums[i] += row[i];
+}
+
+// the box_scale_template for 8 bit gray, RGB and RGBA on the raw rows, the
+// source rows of a box are summed up first, and only then the columns
+static void box_scale_8 (Image& new_image, double scalex, double scaley)
+{
+  Image image;
+  image.copyTransferOwnership (new_image);
+  
+  new_image.resize ((int)(scalex * (double) image.w),
+		    (int)(scaley * (double) image.h));
+  new_image.setResolution (scalex * image.resolutionX(),
+			   scaley * image.resolutionY());
+  
+  const int spp = image.spp;
+  const int n = image.w * spp;
+  std::vector<uint32_t> sums(n);
+  std::vector<uint32_t> boxes(new_image.w * spp);
+  std::vector<int> count(new_image.w);
+  std::vector<int> bindex(image.w);
+  for (int sx = 0; sx < image.w; ++sx) {
+    bindex[sx] = std::min ((int)(scalex * sx), new_image.w - 1);
+    ++count[bindex[sx]];
+  }
+  
+  const uint8_t* src = image.getRawData();
+  uint8_t* dst = new_image.getRawData();
+  
+  int dy = 0;
+  for (int sy = 0; dy < new_image.h && sy < image.h; ++dy)
+    {
+      std::fill (sums.begin(), sums.end(), 0);
+      int rows = 0;
+      for (; sy < image.h && scaley * sy < dy + 1; ++sy, ++rows)
+	box_scale_add_row (&sums[0], src + sy * n, n);
+      
+      std::fill (boxes.begin(), boxes.end(), 0);
+      for (int sx = 0; sx < image.w; ++sx)
+	for (int c = 0; c < spp; ++c)
+	  boxes[bindex[sx] * spp + c] += sums[sx * spp + c];
+      
+      for (int dx = 0; dx < new_image.w; ++dx) {
+	const uint32_t pixels = count[dx] * rows;
+	for (int c = 0; c < spp; ++c)
+	  *dst++ = boxes[dx * spp + c] / pixels;
+      }
+    }
+}
+
 void box_scale (Image& image, double scalex, double scaley)
 {
   if (scalex == 1.0 && scaley == 1.0)
     return;
+  if (image.bps == 8 && image.spp != 2) {
+    box_scale_8 (image, scalex, scaley);
+    return;
+  }
   codegen<box_scale_template> (image, scalex, scaley);
 }
 
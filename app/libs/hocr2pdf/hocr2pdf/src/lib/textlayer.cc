@@ -0,0 +1,102 @@
+/*
+ * The ExactImage library's hOCR to PDF text layer
+ * Copyright (C) 2008-2009 René Rebe, ExactCODE GmbH Germany
+ * Copyright (C) 2008 Archivista
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2. A copy of the GNU General
+ * Public License can be found in the file LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+ * ABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * Alternatively, commercial licensing options are available from the
+ * copyright holder ExactCODE GmbH Germany.
+ */
+
+#include "../codecs/Codecs.hh"
+#include "../codecs/pdf.hh"
+
+#include "textlayer.hh"
+
+static bool isBlank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool Textline::hasDescenders(const std::string& word) {
+	//const char* descenders = "qpgjy";
+	return word.find_first_of("qpgjy") != std::string::npos;
+}
+
+void Textline::draw(PDFCodec* pdfContext, unsigned int res,
+		bool straightenTextLines, std::string* txtString) {
+	// remove trailing whitespace
+	for (span_iterator it = spans.end(); it != spans.begin(); --it) {
+		span_iterator it2 = it;
+		--it2;
+		for (int i = it2->text.size() - 1; i >= 0; --i) {
+			if (isBlank(it2->text[i]))
+				it2->text.erase(i);
+			else
+				goto whitespace_cleaned;
+		}
+	}
+
+	whitespace_cleaned:
+
+	//the baseline params should be interpreted like this:
+	//float b = (bbox.x1 * baseline1 + baseline2);
+	//but we try to keep a perfect straight line to make some pdf readers happy
+	float b = (baseline2);
+
+	int height = 0;
+	if(size>0){
+		height = size *	72.0 / res;
+	} else {
+		double y1 = 72. * bbox.y1 / res;
+		double y2 = 72. * ((b/2) + bbox.y2) / res;
+		height = y2-y1;
+	}
+
+	for (span_iterator it = spans.begin(); it!= spans.end(); ++it) {
+		const std::string& text = it->text;
+		const BBox& spanbbox = it->bbox;
+
+		const char* font = "Helvetica";
+		switch (it->style) {
+		case Bold:
+			font = "Helvetica-Bold";
+			break;
+		case Italic:
+			font = "Helvetica-Oblique";
+			break;
+		case BoldItalic:
+			font = "Helvetica-BoldOblique";
+			break;
+		default:
+			; // already initialized
+		}
+		double y;
+		if (straightenTextLines){
+			y =  (72. * (b+bbox.y2) / res); //use y value from bounding box of the line
+		} else {
+			double t = spanbbox.y2;
+			if (hasDescenders(text)){
+				t-=descenders;
+			}
+			y = 72. * t / res;
+		}
+
+		pdfContext->textTo(72. * spanbbox.x1 / res, y);
+		pdfContext->showText(font, text, height);
+		if (txtString) {
+			*txtString += text;
+		}
+	}
+	if (txtString) {
+		*txtString += "\n";
+	}
+}
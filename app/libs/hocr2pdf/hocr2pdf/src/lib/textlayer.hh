@@ -0,0 +1,77 @@
+/*
+ * The ExactImage library's hOCR to PDF text layer
+ * Copyright (C) 2008-2009 René Rebe, ExactCODE GmbH Germany
+ * Copyright (C) 2008 Archivista
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2. A copy of the GNU General
+ * Public License can be found in the file LICENSE.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANT-
+ * ABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * Alternatively, commercial licensing options are available from the
+ * copyright holder ExactCODE GmbH Germany.
+ */
+
+#ifndef TEXTLAYER_HH
+#define TEXTLAYER_HH
+
+#include <string>
+#include <vector>
+
+class PDFCodec; // fwd
+
+// state per char: bbox, bold, italic, boldItalic
+// state per line: bbox, align: left, right justified
+
+struct BBox {
+	BBox() :
+		x1(0), y1(0), x2(0), y2(0) {
+	}
+
+	bool operator==(const BBox& other) const {
+		return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2
+				== other.y2;
+	}
+
+	double x1, y1, x2, y2;
+};
+
+enum Style {
+	None = 0, Bold = 1, Italic = 2, BoldItalic = (Bold | Italic)
+};
+
+struct Span {
+	BBox bbox;
+	Style style;
+	std::string text;
+};
+
+// one line of text in image pixels, as described by an hOCR ocr_line
+struct Textline {
+	Textline() :
+		size(0), descenders(0), baseline1(0), baseline2(0) {
+	}
+
+	BBox bbox;
+	int size;
+	int descenders;
+	float baseline1;
+	float baseline2;
+
+	std::vector<Span> spans;
+	typedef std::vector<Span>::iterator span_iterator;
+
+	static bool hasDescenders(const std::string& word);
+
+	// draws the UTF-8 text of the spans, each at the position of its bounding
+	// box, must be called between beginText() and endText()
+	void draw(PDFCodec* pdfContext, unsigned int res, bool straightenTextLines,
+			std::string* txtString = 0);
+};
+
+#endif
@@ -235,6 +235,22 @@ extern "C" {
         return env->NewObject(cls, constructor, (jlong)pixBlended, (jdouble)blurValue, (jlong)maxBlurLoc);
     }
 
+    jobject Java_com_renard_ocr_cropimage_image_1processing_Blur_nativeBlurDetectPreview(JNIEnv *env, jobject thiz, jobject luma, jint width, jint height, jint rowStride) {
+        l_uint8* lumaData = (l_uint8*) env->GetDirectBufferAddress(luma);
+        PixBlurDetect blurDetector(false);
+        l_float32 blurValue;
+        Box* maxBlurLoc = NULL;
+        blurDetector.measurePreviewBlur(lumaData, width, height, rowStride, &blurValue, &maxBlurLoc);
+        l_int32 w = 0, h = 0, x = 0, y = 0;
+        if (maxBlurLoc != NULL) {
+            boxGetGeometry(maxBlurLoc, &x, &y, &w, &h);
+            boxDestroy(&maxBlurLoc);
+        }
+        jclass cls = env->FindClass("com/renard/ocr/cropimage/image_processing/PreviewBlurResult");
+        jmethodID constructor = env->GetMethodID(cls, "<init>", "(DIIII)V");
+        return env->NewObject(cls, constructor, (jdouble)blurValue, x, y, w, h);
+    }
+
     jlong Java_com_googlecode_tesseract_android_NativeBinding_nativeOCRBook(JNIEnv *env, jobject thiz, jlong nativePix) {
         LOGV(__FUNCTION__);
         Pix *pixOrg = (PIX *) nativePix;
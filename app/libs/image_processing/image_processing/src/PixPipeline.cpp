@@ -0,0 +1,149 @@
+//
+//  PixPipeline.cpp
+//  ImageProcessing
+//
+
+#include "PixPipeline.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <mutex>
+
+// Size of the source data of one band. Small enough for the band and the intermediate
+// results of all fused stages to stay in the L2 cache of a phone.
+static const l_int32 BAND_BYTES = 256 * 1024;
+static const l_int32 MIN_BAND_ROWS = 16;
+
+PixPipeline::PixPipeline(ProgressCallback* callback) : mCallback(callback) {
+}
+
+PixPipeline& PixPipeline::addWholePage(PIX_FUNC func) {
+    mStages.push_back({func, PIX_STAGE_WHOLE_PAGE, nullptr});
+    return *this;
+}
+
+PixPipeline& PixPipeline::addPixelLocal(PIX_FUNC func) {
+    mStages.push_back({func, PIX_STAGE_PIXEL_LOCAL, nullptr});
+    return *this;
+}
+
+PixPipeline& PixPipeline::addRowLocal(PIX_FUNC func, PIX_HALO_FUNC halo) {
+    mStages.push_back({func, PIX_STAGE_ROW_LOCAL, halo});
+    return *this;
+}
+
+Pix* PixPipeline::run(Pix* pix) const {
+    Pix* pixConverted = pixClone(pix);
+    size_t i = 0;
+    while (i < mStages.size()) {
+        std::vector<const Stage*> group;
+        group.push_back(&mStages[i++]);
+        if (group[0]->footprint != PIX_STAGE_WHOLE_PAGE) {
+            while (i < mStages.size() && mStages[i].footprint != PIX_STAGE_WHOLE_PAGE) {
+                group.push_back(&mStages[i++]);
+            }
+        }
+
+        Pix* newPix;
+        if (group[0]->footprint == PIX_STAGE_WHOLE_PAGE) {
+            newPix = runWholePage(pixConverted, group);
+        } else {
+            newPix = runBanded(pixConverted, group);
+        }
+
+        if (mCallback != nullptr) {
+            mCallback->sendPix(newPix);
+        }
+        pixDestroy(&pixConverted);
+        pixConverted = newPix;
+    }
+    return pixConverted;
+}
+
+Pix* PixPipeline::runStages(Pix* pix, const std::vector<const Stage*>& stages) const {
+    Pix* pixConverted = pixClone(pix);
+    for (auto stage : stages) {
+        Pix* newPix = stage->func(pixConverted);
+        pixDestroy(&pixConverted);
+        pixConverted = newPix;
+    }
+    return pixConverted;
+}
+
+Pix* PixPipeline::runWholePage(Pix* pix, const std::vector<const Stage*>& stages) const {
+    return runStages(pix, stages);
+}
+
+Pix* PixPipeline::runBanded(Pix* pix, const std::vector<const Stage*>& stages) const {
+    PROCNAME("PixPipeline::runBanded");
+    l_int32 w, h;
+    pixGetDimensions(pix, &w, &h, NULL);
+
+    // The halos of fused stages add up, as each one needs the context of the previous one.
+    l_int32 halo = 0;
+    for (auto stage : stages) {
+        if (stage->footprint == PIX_STAGE_ROW_LOCAL) {
+            halo += L_MAX(0, stage->halo(pix));
+        }
+    }
+
+    WorkerPool& pool = WorkerPool::shared();
+    l_int32 threads = pool.threadCount() + 1;
+    l_int32 minRows = L_MAX(MIN_BAND_ROWS, 4 * halo);
+    l_int32 bandRows = BAND_BYTES / (pixGetWpl(pix) * 4);
+    // give every thread a couple of bands to balance the load
+    bandRows = L_MIN(bandRows, (h + 2 * threads - 1) / (2 * threads));
+    bandRows = L_MAX(bandRows, minRows);
+    if (bandRows >= h) {
+        return runWholePage(pix, stages);
+    }
+    l_int32 bandCount = (h + bandRows - 1) / bandRows;
+
+    Pix* pixd = NULL;
+    std::mutex pixdMutex;
+    std::atomic<bool> failed(false);
+
+    pool.parallelFor(bandCount, [&](l_int32 band) {
+        if (failed) {
+            return;
+        }
+        l_int32 y = band * bandRows;
+        l_int32 rows = L_MIN(bandRows, h - y);
+        l_int32 top = L_MAX(0, y - halo);
+        l_int32 bottom = L_MIN(h, y + rows + halo);
+
+        Box* box = boxCreate(0, top, w, bottom - top);
+        Pix* pixBand = pixClipRectangle(pix, box, NULL);
+        boxDestroy(&box);
+        Pix* pixResult = runStages(pixBand, stages);
+        pixDestroy(&pixBand);
+
+        if (pixResult == NULL || pixGetWidth(pixResult) != w || pixGetHeight(pixResult) != bottom - top) {
+            failed = true;
+            pixDestroy(&pixResult);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(pixdMutex);
+            if (pixd == NULL) {
+                pixd = pixCreate(w, h, pixGetDepth(pixResult));
+                pixCopyResolution(pixd, pixResult);
+                pixCopyColormap(pixd, pixResult);
+            }
+            if (pixd == NULL || pixGetDepth(pixd) != pixGetDepth(pixResult)) {
+                failed = true;
+                pixDestroy(&pixResult);
+                return;
+            }
+        }
+        // bands only ever write their own rows of pixd
+        pixRasterop(pixd, 0, y, w, rows, PIX_SRC, pixResult, 0, y - top);
+        pixDestroy(&pixResult);
+    });
+
+    if (failed) {
+        L_WARNING("stage changed the size of a band, running on the whole page instead\n", procName);
+        pixDestroy(&pixd);
+        return runWholePage(pix, stages);
+    }
+    return pixd;
+}
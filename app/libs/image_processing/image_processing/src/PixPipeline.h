@@ -0,0 +1,73 @@
+//
+//  PixPipeline.h
+//  ImageProcessing
+//
+
+#ifndef PixPipeline_h
+#define PixPipeline_h
+
+#include "allheaders.h"
+#include "ProgressCallback.h"
+#include <functional>
+#include <vector>
+
+typedef std::function<Pix*(Pix* pix)> PIX_FUNC;
+
+/**
+ * Returns the number of rows above and below a row that a stage needs to see in order
+ * to compute that row. It is evaluated on the input of the fused group the stage belongs to.
+ */
+typedef std::function<l_int32(Pix* pix)> PIX_HALO_FUNC;
+
+/**
+ * Describes how much of the page a stage needs to look at to compute one output pixel.
+ */
+enum PixStageFootprint {
+    /** every output pixel only depends on the input pixel at the same position */
+    PIX_STAGE_PIXEL_LOCAL,
+    /** every output row only depends on the input rows within the halo of that row */
+    PIX_STAGE_ROW_LOCAL,
+    /** the stage analyses or transforms the page as a whole */
+    PIX_STAGE_WHOLE_PAGE
+};
+
+/**
+ * Runs a list of preprocessing stages on a page.
+ *
+ * Consecutive pixel and row local stages are fused: the page is cut into horizontal bands
+ * that are small enough to stay in cache, all fused stages are applied to one band after
+ * the other and the bands are processed on the shared WorkerPool. Only the result of a fused
+ * group is ever allocated at page size. Pixel and row local stages must return a Pix of the
+ * same size as their input.
+ * Whole page stages are run on the complete result of the previous stage.
+ */
+class PixPipeline {
+public:
+    explicit PixPipeline(ProgressCallback* callback = nullptr);
+
+    PixPipeline& addWholePage(PIX_FUNC func);
+    PixPipeline& addPixelLocal(PIX_FUNC func);
+    PixPipeline& addRowLocal(PIX_FUNC func, PIX_HALO_FUNC halo);
+
+    /**
+     * Runs all stages on pix. The callback (if any) receives the result of every whole page
+     * stage and of every fused group. The caller owns the returned Pix.
+     */
+    Pix* run(Pix* pix) const;
+
+private:
+    struct Stage {
+        PIX_FUNC func;
+        PixStageFootprint footprint;
+        PIX_HALO_FUNC halo;
+    };
+
+    Pix* runWholePage(Pix* pix, const std::vector<const Stage*>& stages) const;
+    Pix* runBanded(Pix* pix, const std::vector<const Stage*>& stages) const;
+    Pix* runStages(Pix* pix, const std::vector<const Stage*>& stages) const;
+
+    std::vector<Stage> mStages;
+    ProgressCallback* mCallback;
+};
+
+#endif /* PixPipeline_h */
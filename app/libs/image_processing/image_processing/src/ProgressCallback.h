@@ -17,6 +17,9 @@ static const int MESSAGE_OCR = 2;
 static const int MESSAGE_ASSEMBLE_PIX = 3;
 static const int MESSAGE_ANALYSE_LAYOUT = 4;
 
+/* Longest edge of pix which are only made to be shown as progress. */
+static const int PREVIEW_MAX_EDGE = 1280;
+
 class ProgressCallback {
 public:
     virtual void sendMessage(int) = 0;
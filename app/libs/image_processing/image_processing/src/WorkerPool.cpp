@@ -0,0 +1,124 @@
+//
+//  WorkerPool.cpp
+//  ImageProcessing
+//
+
+#include "WorkerPool.h"
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace {
+
+    /**
+     * State of one parallelFor call. It is shared with the queued runners, which may only
+     * start after parallelFor has already returned.
+     */
+    struct ParallelForState {
+        ParallelForState(l_int32 count, const std::function<void(l_int32)>& func)
+                : func(func), count(count), next(0), done(0) {}
+
+        // Claims and runs indexes until there are none left.
+        void run() {
+            for (l_int32 i = next++; i < count; i = next++) {
+                try {
+                    func(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                if (++done == count) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+
+        const std::function<void(l_int32)> func;
+        const l_int32 count;
+        std::atomic<l_int32> next;
+        std::atomic<l_int32> done;
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+
+}
+
+WorkerPool::WorkerPool(unsigned int threadCount) : mStop(false) {
+    for (unsigned int i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_all();
+    for (auto &thread : mThreads) {
+        thread.join();
+    }
+}
+
+WorkerPool& WorkerPool::shared() {
+    // the calling thread always works as well, so one thread less than there are cores
+    static WorkerPool pool(L_MAX(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+unsigned int WorkerPool::threadCount() const {
+    return (unsigned int) mThreads.size();
+}
+
+void WorkerPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this] { return mStop || !mTasks.empty(); });
+            if (mStop && mTasks.empty()) {
+                return;
+            }
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+        task();
+    }
+}
+
+void WorkerPool::parallelFor(l_int32 count, const std::function<void(l_int32)>& func) {
+    if (count <= 0) {
+        return;
+    }
+    if (count == 1 || mThreads.empty()) {
+        for (l_int32 i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>(count, func);
+    l_int32 runners = L_MIN(count - 1, (l_int32) mThreads.size());
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (l_int32 i = 0; i < runners; i++) {
+            mTasks.emplace_back([state] { state->run(); });
+        }
+    }
+    mCondition.notify_all();
+
+    // Runners which are still queued when we are done find no work left, so we only
+    // ever wait for indexes that are actively being processed.
+    state->run();
+    {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->finished.wait(lock, [&state] { return state->done == state->count; });
+    }
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
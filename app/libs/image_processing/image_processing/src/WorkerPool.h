@@ -0,0 +1,50 @@
+//
+//  WorkerPool.h
+//  ImageProcessing
+//
+
+#ifndef WorkerPool_h
+#define WorkerPool_h
+
+#include "allheaders.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads used to spread the rows/tiles of a page over all cores.
+ * The pool never calls back into java, so it can be used from any thread that is processing a page.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned int threadCount);
+    virtual ~WorkerPool();
+
+    /**
+     * Pool with one worker per core, shared by all image processing functions.
+     */
+    static WorkerPool& shared();
+
+    unsigned int threadCount() const;
+
+    /**
+     * Calls func(0) ... func(count-1) on the pool and returns once all calls are done.
+     * The calling thread takes part in the work, so parallelFor can safely be nested.
+     * The first exception thrown by func is rethrown on the calling thread.
+     */
+    void parallelFor(l_int32 count, const std::function<void(l_int32)>& func);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStop;
+};
+
+#endif /* WorkerPool_h */
@@ -18,42 +18,114 @@
 #include <iostream>
 #include <sstream>
 #include <cmath>
+#include <cstring>
+#include <vector>
+#include "WorkerPool.h"
 
 using namespace std;
 
-int determineThresholdForTile(Pix* pixt, bool debug) {
-	l_int32 start = 0, end = 255, i, error, closeSize = 0;
-	l_float32 sum, moment, var, y, variance, mean, meanY, countPixels;
+//rows per task when the thresholds are applied
+static const l_int32 BAND_ROWS = 64;
 
-	NUMA* norm;
-	NUMA* histo = pixGetGrayHistogram(pixt, 1);
-	numaSetValue(histo, 255, 0); //ignore white pixels
-	error = numaGetNonzeroRange(histo, 0, &start, &end);
-	if (end == start || error == 1) {
-		numaDestroy(&histo);
+/**
+ * gray value histogram of tile (i, j), taken directly from the raster of pixs.
+ * counts the same pixels as pixGetGrayHistogram() on the tile returned by
+ * pixTilingGetTile(), including the mirrored border that is added where the
+ * tile touches the border of the image
+ */
+static void getTileHistogram(Pix* pixs, PIXTILING* pt, l_int32 i, l_int32 j, l_int32* histo) {
+	l_int32 w, h, wpl, nx, ny, wt, ht;
+	pixGetDimensions(pixs, &w, &h, NULL);
+	pixTilingGetCount(pt, &nx, &ny);
+	pixTilingGetSize(pt, &wt, &ht);
+	const l_int32 ox = pt->xoverlap;
+	const l_int32 oy = pt->yoverlap;
+	const l_int32 left = L_MAX(0, j * wt - ox);
+	const l_int32 top = L_MAX(0, i * ht - oy);
+	const l_int32 right = (j == nx - 1) ? w : (j + 1) * wt + ox;
+	const l_int32 bottom = (i == ny - 1) ? h : (i + 1) * ht + oy;
+	const bool mirrored = ox > 0 || oy > 0;
+	const bool mirrorLeft = mirrored && j == 0;
+	const bool mirrorRight = mirrored && j == nx - 1;
+	const bool mirrorTop = mirrored && i == 0;
+	const bool mirrorBottom = mirrored && i == ny - 1;
+
+	memset(histo, 0, 256 * sizeof(l_int32));
+	l_uint32* data = pixGetData(pixs);
+	wpl = pixGetWpl(pixs);
+	for (l_int32 y = top; y < bottom; y++) {
+		const l_uint32* line = data + y * wpl;
+		l_int32 weight = 1;
+		if (mirrorTop && y < oy) {
+			weight++;
+		}
+		if (mirrorBottom && y >= h - oy) {
+			weight++;
+		}
+		for (l_int32 x = left; x < right; x++) {
+			histo[GET_DATA_BYTE(line, x)] += weight;
+		}
+		if (mirrorLeft) {
+			for (l_int32 x = 0; x < ox; x++) {
+				histo[GET_DATA_BYTE(line, x)] += weight;
+			}
+		}
+		if (mirrorRight) {
+			for (l_int32 x = w - ox; x < w; x++) {
+				histo[GET_DATA_BYTE(line, x)] += weight;
+			}
+		}
+	}
+}
+
+/**
+ * threshold for a tile from its gray value histogram.
+ * the float arithmetic follows the normalized Numa histogram that was used before,
+ * so the thresholds stay the same.
+ */
+static int determineThresholdForTile(const l_int32* counts, bool debug) {
+	l_int32 start = 0, end = 255, i, closeSize = 0;
+	l_float32 sum, moment, var, y, variance, mean, meanY, countPixels, total;
+	l_float32 histo[256];
+	l_float32 norm[256];
+
+	for (i = 0; i < 256; i++) {
+		histo[i] = counts[i];
+	}
+	histo[255] = 0; //ignore white pixels
+	while (start < 256 && histo[start] <= 0) {
+		start++;
+	}
+	if (start == 256) {
+		return 0;
+	}
+	while (histo[end] <= 0) {
+		end--;
+	}
+	if (end == start) {
 		return 0;
 	}
 	closeSize = end - start;
 	if (closeSize % 2 == 0) {
 		closeSize++;
 	}
-	norm = numaNormalizeHistogram(histo, 1);
-	/*
-	l_float32 median;
-	numaGetMedian(histo,&median);
-	printf("%2.1f\t", median);
-	*/
+	for (total = 0.0, i = 0; i < 256; i++) {
+		total += histo[i];
+	}
+	const l_float32 factor = (l_float32) 1.0 / total;
+	for (i = 0; i < 256; i++) {
+		norm[i] = histo[i] * factor;
+	}
 
 	l_float32 iMulty;
 	for (sum = 0.0, moment = 0.0, var = 0.0, countPixels = 0, i = start;
 			i < end; i++) {
-		numaGetFValue(norm, i, &y);
+		y = norm[i];
 		sum += y;
 		iMulty = i * y;
 		moment += iMulty;
 		var += i * iMulty;
-		numaGetFValue(histo, i, &y);
-		countPixels += y;
+		countPixels += histo[i];
 	}
 	variance = sqrt(var / sum - moment * moment / (sum * sum));
 	mean = moment / sum;
@@ -77,6 +149,7 @@ int determineThresholdForTile(Pix* pixt, bool debug) {
 		printf("mean = %f , variance = %f, meanY = %f \n", mean, variance,
 				meanY);
 		printf("%i ,%i\n", start, end);
+		NUMA* numaNorm = numaCreateFromFArray(norm, 256, L_COPY);
 		GPLOT *gplot;
 		ostringstream name;
 		name << mean;
@@ -85,13 +158,11 @@ int determineThresholdForTile(Pix* pixt, bool debug) {
 		ostringstream title;
 		title << "mean = " << mean << ", " << "variance = " << variance
 				<< ", thresh = " << result;
-		//gplotAddPlot(gplot, NULL, diff, GPLOT_LINES, "diff histogram");
-		gplotAddPlot(gplot, NULL, norm, GPLOT_LINES, title.str().c_str());
+		gplotAddPlot(gplot, NULL, numaNorm, GPLOT_LINES, title.str().c_str());
 		gplotMakeOutput(gplot);
 		gplotDestroy(&gplot);
+		numaDestroy(&numaNorm);
 	}
-	numaDestroy(&norm);
-	numaDestroy(&histo);
 
 	//TODO check std dev of y values. large value > foreground and background, low value > only background
 	//idea: narrow histogramm means a high likelyhood for bg
@@ -158,13 +229,51 @@ Pix* createEdgeMask(Pix* pixs, bool debug) {
 }
 
 /**
- * determines and applies a threshold for each tile separately
+ * sets the pixels of rows [y0, y1) of pixb that are darker than the threshold of their tile.
+ * the tiles are laid out like pixTilingCreate() without overlap, so the last tile of a row
+ * or column takes up the remaining pixels.
+ */
+static void thresholdRows(Pix* pixs, Pix* pixb, const l_uint8* thresholds, l_int32 nx, l_int32 ny,
+		l_int32 wt, l_int32 ht, l_int32 y0, l_int32 y1) {
+	const l_int32 w = pixGetWidth(pixs);
+	const l_int32 wpls = pixGetWpl(pixs);
+	const l_int32 wpld = pixGetWpl(pixb);
+	for (l_int32 y = y0; y < y1; y++) {
+		const l_uint32* lines = pixGetData(pixs) + y * wpls;
+		l_uint32* lined = pixGetData(pixb) + y * wpld;
+		const l_uint8* rowThresholds = thresholds + L_MIN(y / ht, ny - 1) * nx;
+		l_uint32 dword = 0;
+		for (l_int32 j = 0; j < nx; j++) {
+			const l_int32 thresh = rowThresholds[j];
+			const l_int32 xend = (j == nx - 1) ? w : (j + 1) * wt;
+			for (l_int32 x = j * wt; x < xend; x++) {
+				//same as pixThresholdToBinary(): set if val < thresh, without a branch
+				const l_int32 val = GET_DATA_BYTE(lines, x);
+				dword |= ((l_uint32) (val - thresh) >> 31) << (31 - (x & 31));
+				if ((x & 31) == 31) {
+					lined[x >> 5] = dword;
+					dword = 0;
+				}
+			}
+		}
+		if ((w & 31) != 0) {
+			lined[w >> 5] = dword;
+		}
+	}
+}
+
+/**
+ * determines and applies a threshold for each tile separately.
+ * the tiles are independent of each other and are processed on the WorkerPool.
  */
 Pix* binarizeTiled(Pix* pixs, const l_uint32 tileSize) {
     PROCNAME("binarizeTiled");
     
+	if (pixGetDepth(pixs) != 8 || pixGetColormap(pixs) != NULL) {
+		return (Pix *) ERROR_PTR("pixs not 8 bpp without colormap", procName, NULL);
+	}
 	L_TIMER timer = startTimerNested();
-	l_int32 thresh, w, h;
+	l_int32 w, h, wt, ht;
 	Pix* pixb;
 	ostringstream s;
 	pixGetDimensions(pixs, &w, &h, NULL);
@@ -172,43 +281,30 @@ Pix* binarizeTiled(Pix* pixs, const l_uint32 tileSize) {
 	l_int32 ny = L_MAX(1, h / tileSize);
 	l_int32 ox = L_MAX(1,nx/6);
 	l_int32 oy = L_MAX(1,ny/6);
+	//thresholds are kept as bytes, like the 8 bpp threshold pix that was used before
+	std::vector<l_uint8> thresholds(nx * ny, 0);
 	PIXTILING* pt = pixTilingCreate(pixs, nx, ny, 0, 0, ox, oy);
-	Pix* pixth = pixCreate(nx, ny, 8);
-	Pix* pixt;
-	bool debug = false;
-	for (int i = 0; i < ny; i++) {
-		for (int j = 0; j < nx; j++) {
-			pixt = pixTilingGetTile(pt, i, j);
-			if (i == 0 && j == 0) {
-				debug = false;
-			} else {
-				debug = false;
-			}
-			thresh = determineThresholdForTile(pixt, debug);
-			pixSetPixel(pixth, j, i, thresh);
-			pixDestroy(&pixt);
-		}
+	if (pt != NULL) {
+		WorkerPool::shared().parallelFor(nx * ny, [&](l_int32 index) {
+			l_int32 histo[256];
+			getTileHistogram(pixs, pt, index / nx, index % nx, histo);
+			thresholds[index] = (l_uint8) determineThresholdForTile(histo, false);
+		});
+		pixTilingDestroy(&pt);
 	}
-	pixTilingDestroy(&pt);
+	//tile size of the tiling without overlap that the thresholds are applied to
+	wt = w / nx;
+	ht = h / ny;
 	s << "local threshhold determination: " << stopTimerNested(timer)
 			<< std::endl;
 	timer = startTimerNested();
 
-	pt = pixTilingCreate(pixs, nx, ny, 0, 0, 0, 0);
 	pixb = pixCreate(w, h, 1);
-	l_uint32 val;
-	for (int i = 0; i < ny; i++) {
-		for (int j = 0; j < nx; j++) {
-			pixt = pixTilingGetTile(pt, i, j);
-			pixGetPixel(pixth, j, i, &val);
-			Pix* pixbTile = pixThresholdToBinary(pixt, val);
-			pixTilingPaintTile(pixb, i, j, pixbTile, pt);
-			pixDestroy(&pixt);
-			pixDestroy(&pixbTile);
-		}
-	}
-	pixTilingDestroy(&pt);
-	pixDestroy(&pixth);
+	const l_int32 bandCount = (h + BAND_ROWS - 1) / BAND_ROWS;
+	WorkerPool::shared().parallelFor(bandCount, [&](l_int32 band) {
+		const l_int32 y0 = band * BAND_ROWS;
+		thresholdRows(pixs, pixb, thresholds.data(), nx, ny, wt, ht, y0, L_MIN(h, y0 + BAND_ROWS));
+	});
 	s << "local threshhold application: " << stopTimerNested(timer)
 			<< std::endl;
 	L_INFO("%s", procName, s.str().c_str());
@@ -513,3 +513,139 @@ void PixBlurDetect::pixTintMasked(Pix* pixd, Pix* pixmask) {
 	}
 }
 
+
+l_int32 PixBlurDetect::downscaleLuma(const l_uint8* luma, l_int32 width, l_int32 height, l_int32 rowStride,
+		l_int32 maxEdgeLength, std::vector<l_uint8>& plane, l_int32* pw, l_int32* ph) {
+	l_int32 factor = (max(width, height) + maxEdgeLength - 1) / maxEdgeLength;
+	l_int32 w = width / factor;
+	l_int32 h = height / factor;
+	plane.resize(w * h);
+	std::vector<l_uint32> sums(w);
+	const l_uint32 area = factor * factor;
+	for (l_int32 y = 0; y < h; y++) {
+		std::fill(sums.begin(), sums.end(), 0);
+		for (l_int32 i = 0; i < factor; i++) {
+			const l_uint8* line = luma + (y * factor + i) * rowStride;
+			for (l_int32 x = 0; x < w; x++) {
+				const l_uint8* block = line + x * factor;
+				for (l_int32 j = 0; j < factor; j++) {
+					sums[x] += block[j];
+				}
+			}
+		}
+		l_uint8* lined = &plane[y * w];
+		for (l_int32 x = 0; x < w; x++) {
+			lined[x] = (l_uint8) (sums[x] / area);
+		}
+	}
+	*pw = w;
+	*ph = h;
+	return factor;
+}
+
+/**
+ * Maps the ratio of laplacian and gradient at edge pixels, which is roughly the inverse of
+ * the edge width, to 0 (sharp) - 1 (blurred).
+ */
+static double convertEdgeSharpnessToBlurIndicator(double sharpness) {
+	const double maxSharpness = 0.80;
+	const double minSharpness = 0.26;
+	double clamped = min(maxSharpness, sharpness);
+	clamped = max(minSharpness, clamped);
+	return 1 - (clamped - minSharpness) / (maxSharpness - minSharpness);
+}
+
+l_int32 PixBlurDetect::measurePreviewBlur(const l_uint8* luma, l_int32 width, l_int32 height, l_int32 rowStride,
+		l_float32* blurValue, Box** maxBlurBounds) {
+	PROCNAME("measurePreviewBlur");
+	if (!blurValue)
+		return ERROR_INT("&blurValue not defined", procName, 1);
+	*blurValue = 1;
+	if (!luma)
+		return ERROR_INT("luma not defined", procName, 1);
+	if (width < 16 || height < 16 || rowStride < width)
+		return ERROR_INT("invalid luma plane", procName, 1);
+
+	L_TIMER timer;
+	if (mDebug) {
+		timer = startTimerNested();
+	}
+
+	const l_int32 maxEdgeLength = 640;
+	const l_int32 tileSize = 32;
+	const l_int32 edgeThreshold = 12;
+	l_int32 w, h;
+	std::vector<l_uint8> plane;
+	l_int32 factor = downscaleLuma(luma, width, height, rowStride, maxEdgeLength, plane, &w, &h);
+
+	// One pass over the plane collects the statistics of the laplacian and the
+	// gradient magnitude of the edge pixels in each tile.
+	l_int32 nx = max(1, w / tileSize);
+	l_int32 ny = max(1, h / tileSize);
+	std::vector<RunningStats> laplacian(nx * ny);
+	std::vector<RunningStats> gradient(nx * ny);
+	for (l_int32 y = 1; y < h - 1; y++) {
+		const l_uint8* above = &plane[(y - 1) * w];
+		const l_uint8* line = &plane[y * w];
+		const l_uint8* below = &plane[(y + 1) * w];
+		const l_int32 tileRow = min(ny - 1, y / tileSize) * nx;
+		for (l_int32 x = 1; x < w - 1; x++) {
+			l_int32 gx = line[x + 1] - line[x - 1];
+			l_int32 gy = below[x] - above[x];
+			l_int32 grad = abs(gx) + abs(gy);
+			if (grad >= edgeThreshold) {
+				l_int32 lap = line[x - 1] + line[x + 1] + above[x] + below[x] - 4 * line[x];
+				l_int32 tile = tileRow + min(nx - 1, x / tileSize);
+				laplacian[tile].Push(lap);
+				gradient[tile].Push(grad);
+			}
+		}
+	}
+
+	// Rate the tiles that have enough edges and find the most blurred one.
+	const long long minEdgePixels = tileSize * tileSize / 50;
+	std::vector<l_float32> tileBlur;
+	l_float32 maxBlur = -1;
+	l_int32 maxTile = -1;
+	for (l_int32 i = 0; i < nx * ny; i++) {
+		if (laplacian[i].NumDataValues() < minEdgePixels) {
+			continue;
+		}
+		double lapMean = laplacian[i].Mean();
+		double lapRms = sqrt(laplacian[i].PopulationVariance() + lapMean * lapMean);
+		l_float32 blur = convertEdgeSharpnessToBlurIndicator(lapRms / gradient[i].Mean());
+		tileBlur.push_back(blur);
+		if (blur > maxBlur) {
+			maxBlur = blur;
+			maxTile = i;
+		}
+	}
+
+	//get the average of the top 20% of the blur regions like makeBlurIndicator
+	l_int32 n = tileBlur.size();
+	if (n > 0) {
+		std::sort(tileBlur.begin(), tileBlur.end());
+		l_int32 index = (l_int32) (0.8 * (n - 1) + 0.5);
+		l_float32 blur = 0;
+		for (l_int32 i = index; i < n; i++) {
+			blur += tileBlur[i];
+		}
+		*blurValue = blur / (n - index);
+	}
+
+	if (maxBlurBounds != NULL) {
+		if (maxTile >= 0) {
+			l_int32 tx = maxTile % nx;
+			l_int32 ty = maxTile / nx;
+			l_int32 tw = tx == nx - 1 ? w - tx * tileSize : tileSize;
+			l_int32 th = ty == ny - 1 ? h - ty * tileSize : tileSize;
+			*maxBlurBounds = boxCreate(tx * tileSize * factor, ty * tileSize * factor, tw * factor, th * factor);
+		} else {
+			*maxBlurBounds = boxCreate(0, 0, width, height);
+		}
+	}
+	if (mDebug) {
+		printf("%s: %i tiles rated, blur = %f, %f\n", __FUNCTION__, n, *blurValue, stopTimerNested(timer));
+	}
+	return 0;
+}
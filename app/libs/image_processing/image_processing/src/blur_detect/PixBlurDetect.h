@@ -24,12 +24,21 @@
 #define BLUR_DETTECT_H_
 
 #include "allheaders.h"
+#include <vector>
 
 
 class PixBlurDetect {
 public:
 	PixBlurDetect(bool debug);
 	Pix* makeBlurIndicator(Pix* pix, l_float32* blurValue, Box** maxBlurBounds);
+
+	/**
+	 * Fast blur estimate for camera preview frames which only needs their luma plane.
+	 * blurValue has the same range as the one of makeBlurIndicator (0 -> sharp, 1 -> very blurred)
+	 * and maxBlurBounds is set to the most blurred tile in coordinates of the luma plane.
+	 */
+	l_int32 measurePreviewBlur(const l_uint8* luma, l_int32 width, l_int32 height, l_int32 rowStride,
+			l_float32* blurValue, Box** maxBlurBounds);
 	virtual ~PixBlurDetect();
 
 private:
@@ -59,6 +68,12 @@ private:
 	void getCenterOfGravity(Pix* pixs, l_uint32* cx, l_uint32* cy );
 	Pix* blurTileTest(Pix* pixs, Pix* pixBlurMeasure);
 
+	/**
+	 * Box filters the luma plane down to at most maxEdgeLength pixels. Returns the scale factor.
+	 */
+	l_int32 downscaleLuma(const l_uint8* luma, l_int32 width, l_int32 height, l_int32 rowStride,
+			l_int32 maxEdgeLength, std::vector<l_uint8>& plane, l_int32* pw, l_int32* ph);
+
 
 
 
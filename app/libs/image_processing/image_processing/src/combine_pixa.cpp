@@ -30,6 +30,8 @@
 #include <cstdio>
 #include <string>
 #include "pixFunc.hpp"
+#include "WorkerPool.h"
+#include <vector>
 
 using namespace std;
 
@@ -118,22 +120,32 @@ void combineSelectedPixa(Pixa* pixaText, Pixa* pixaImage, l_int32* textindexes,
     
     /*dewarp text regions*/
     
+    //the columns are independent, so their models are built in parallel
+    std::vector<Pix*> columns(textCount);
+    std::vector<Pix*> dewarpedColumns(textCount, NULL);
     for (int i = 0; i < textCount; i++) {
-        int x, y, w, dw, dh, h, dx = 0, dy = 0;
-        Pix* pixtext = pixaGetPix(pixaSelectedColumns, i, L_CLONE);
-        pixaGetBoxGeometry(pixaSelectedColumns, i, &x, &y, &w, &h);
-        Box* b = pixaGetBox(pixaSelectedColumns, i, L_CLONE);
-        Pix* pixDewarped = NULL;
-        l_int32 dewarpResult = pixDewarp(pixtext, &pixDewarped);
-        if(!dewarpResult){
+        columns[i] = pixaGetPix(pixaSelectedColumns, i, L_CLONE);
+    }
+    WorkerPool::shared().parallelFor(textCount, [&](l_int32 i) {
+        if (pixDewarp(columns[i], &dewarpedColumns[i])) {
+            dewarpedColumns[i] = NULL;
+        }
+    });
+    
+    //the boxes of the later columns depend on the size of the earlier ones
+    for (int i = 0; i < textCount; i++) {
+        pixDestroy(&columns[i]);
+        Pix* pixDewarped = dewarpedColumns[i];
+        if (pixDewarped != NULL) {
+            int x, y, w, h;
             printf("dewarp success");
-            dw = pixGetWidth(pixDewarped);
-            dh = pixGetHeight(pixDewarped);
-            dx = dw - w;
-            dy = dh - h;
+            pixaGetBoxGeometry(pixaSelectedColumns, i, &x, &y, &w, &h);
+            int dw = pixGetWidth(pixDewarped);
+            int dh = pixGetHeight(pixDewarped);
+            Box* b = pixaGetBox(pixaSelectedColumns, i, L_CLONE);
             boxSetGeometry(b, x, y, dw, dh);
-            pixaReplacePix(pixaSelectedColumns, i,pixDewarped, b);
-            translateBoxa(pixaSelectedColumns, dx, dy, x, y);
+            pixaReplacePix(pixaSelectedColumns, i, pixDewarped, b);
+            translateBoxa(pixaSelectedColumns, dw - w, dh - h, x, y);
         }
     }
     
@@ -8,51 +8,266 @@
 
 #include "SavGolFilter.hpp"
 #include "SavGolKernel.hpp"
+#include "WorkerPool.h"
 #include <stdexcept>
 #include <climits>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-class Kernel : public SavGolKernel
-{
-public:
-    Kernel(Point const& size, Point const& origin, int hor_degree, int vert_degree)
-    : SavGolKernel(size, origin, hor_degree, vert_degree) {}
-    
-    void convolve(uint8_t* dst, uint8_t const* src_top_left, int src_bpl) const;
-};
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Size of the intermediate results of one band of the separable convolution.
+static const int BAND_BYTES = 256 * 1024;
+static const int MIN_BAND_ROWS = 16;
 
 int bound(int min, int value, int max){
     return std::max(min, std::min(value, max));
 }
 
-inline void
-Kernel::convolve(uint8_t* dst, uint8_t const* src_top_left, int src_bpl) const
+int calcNumTerms(int const hor_degree, int const vert_degree){
+    return (hor_degree + 1) * (vert_degree + 1);
+}
+
+/**
+ * Kernels for every possible origin within the window. The border pixels need the kernel
+ * for an origin that is moved away from the center, and recalculating it for every pixel
+ * is expensive, so they are computed once per window size and degree and then shared.
+ */
+class BorderKernels
 {
-    uint8_t const* p_src = src_top_left;
-    float const* p_kernel = data();
-    float sum = 0.5; // For rounding purposes.
+public:
+    BorderKernels(Point const& size, int hor_degree, int vert_degree)
+    : m_width(size.x), m_height(size.y), m_kernels(size.x * size.y * size.x * size.y) {
+        SavGolKernel kernel(size, Point(0, 0), hor_degree, vert_degree);
+        int const kernel_size = m_width * m_height;
+        for (int y = 0; y < m_height; ++y) {
+            for (int x = 0; x < m_width; ++x) {
+                kernel.recalcForOrigin(Point(x, y));
+                std::copy(kernel.data(), kernel.data() + kernel_size, &m_kernels[(y * m_width + x) * kernel_size]);
+            }
+        }
+    }
+    
+    float const* forOrigin(Point const& origin) const {
+        return &m_kernels[(origin.y * m_width + origin.x) * m_width * m_height];
+    }
     
-    int const w = width();
-    int const h = height();
+    static std::shared_ptr<BorderKernels const> get(Point const& size, int hor_degree, int vert_degree) {
+        static std::mutex mutex;
+        static std::map<std::vector<int>, std::shared_ptr<BorderKernels const>> cache;
+        std::vector<int> const key = {size.x, size.y, hor_degree, vert_degree};
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            return it->second;
+        }
+        auto kernels = std::make_shared<BorderKernels const>(size, hor_degree, vert_degree);
+        cache[key] = kernels;
+        return kernels;
+    }
     
-    for (int y = 0; y < h; ++y, p_src += src_bpl) {
+private:
+    int m_width;
+    int m_height;
+    std::vector<float> m_kernels;
+};
+
+/**
+ * Convolves the window with its top left corner at (left, top) with the kernel and
+ * returns the result for the kernel origin.
+ */
+static l_uint8 convolveWindow(Pix* src, int left, int top, float const* p_kernel, int w, int h)
+{
+    l_uint32 const* src_data = pixGetData(src);
+    l_int32 const src_wpl = pixGetWpl(src);
+    float sum = 0.5; // For rounding purposes.
+    for (int y = 0; y < h; ++y) {
+        l_uint32 const* line = src_data + (top + y) * src_wpl;
         for (int x = 0; x < w; ++x) {
-            sum += p_src[x] * *p_kernel;
+            sum += GET_DATA_BYTE(line, left + x) * *p_kernel;
             ++p_kernel;
         }
     }
     
     int const val = static_cast<int>(sum);
-    *dst = static_cast<uint8_t>(bound(0, val, 255));
+    return static_cast<l_uint8>(bound(0, val, 255));
+}
+
+/**
+ * Computes out[x] = sum(kernel[t] * srcs[t][x]) for x in [0, n).
+ * Every lane adds up the products in the order of t, so the result is the same as that of
+ * the scalar loop (apart from the compiler contracting the scalar loop into fused multiply-adds).
+ */
+static void weightedSum(float const* const* srcs, float const* kernel, int taps, float* out, int n)
+{
+    int x = 0;
+#if defined(__SSE2__)
+    for (; x + 8 <= n; x += 8) {
+        __m128 sum0 = _mm_setzero_ps();
+        __m128 sum1 = _mm_setzero_ps();
+        for (int t = 0; t < taps; ++t) {
+            __m128 const k = _mm_set1_ps(kernel[t]);
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(srcs[t] + x), k));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(srcs[t] + x + 4), k));
+        }
+        _mm_storeu_ps(out + x, sum0);
+        _mm_storeu_ps(out + x + 4, sum1);
+    }
+#elif defined(__ARM_NEON)
+    for (; x + 8 <= n; x += 8) {
+        float32x4_t sum0 = vdupq_n_f32(0.0f);
+        float32x4_t sum1 = vdupq_n_f32(0.0f);
+        for (int t = 0; t < taps; ++t) {
+            sum0 = vaddq_f32(sum0, vmulq_n_f32(vld1q_f32(srcs[t] + x), kernel[t]));
+            sum1 = vaddq_f32(sum1, vmulq_n_f32(vld1q_f32(srcs[t] + x + 4), kernel[t]));
+        }
+        vst1q_f32(out + x, sum0);
+        vst1q_f32(out + x + 4, sum1);
+    }
+#endif
+    for (; x < n; ++x) {
+        float sum = 0.0f;
+        for (int t = 0; t < taps; ++t) {
+            sum += srcs[t][x] * kernel[t];
+        }
+        out[x] = sum;
+    }
 }
 
+/**
+ * Rounding of the scan tailor implementation: floats in between the two passes,
+ * truncated and clamped at the end.
+ */
+struct TruncatingRounding
+{
+    static float intermediate(float sum) { return sum; }
+    static l_uint8 final(float sum) { return static_cast<l_uint8>(bound(0, static_cast<int>(sum), 255)); }
+};
 
-int calcNumTerms(int const hor_degree, int const vert_degree){
-    return (hor_degree + 1) * (vert_degree + 1);
+/**
+ * Rounding of pixConvolveSep(): absolute values rounded to integers after each pass.
+ */
+struct LeptonicaRounding
+{
+    static float intermediate(float sum) { return static_cast<float>(static_cast<l_uint32>(std::fabs(sum) + 0.5)); }
+    static l_uint8 final(float sum) { return static_cast<l_uint8>(L_MIN(255, static_cast<l_int32>(std::fabs(sum) + 0.5))); }
+};
+
+/**
+ * Order of the two passes of the separable convolution. It matters, as the
+ * intermediate result may be rounded.
+ */
+enum PassOrder {
+    HORIZONTAL_FIRST,
+    VERTICAL_FIRST
+};
+
+/**
+ * Convolves the 8 bpp src with the separable kernel hor x vert for every position at which the
+ * kernel fits completely into src, and writes the results to dst starting at (dst_x, dst_y).
+ * The output rows are split into bands which are processed on the WorkerPool. Each band
+ * only keeps the intermediate rows it needs, so they stay in cache.
+ */
+template <class Rounding>
+static void convolveSeparable(Pix* src, float const* hor, int kw, float const* vert, int kh,
+                              PassOrder order, Pix* dst, int dst_x, int dst_y)
+{
+    int const src_width = pixGetWidth(src);
+    int const out_width = src_width - kw + 1;
+    int const out_height = pixGetHeight(src) - kh + 1;
+    if (out_width <= 0 || out_height <= 0) {
+        return;
+    }
+    l_uint32 const* const src_data = pixGetData(src);
+    l_int32 const src_wpl = pixGetWpl(src);
+    l_uint32* const dst_data = pixGetData(dst);
+    l_int32 const dst_wpl = pixGetWpl(dst);
+    
+    int const band_rows = std::max(MIN_BAND_ROWS, BAND_BYTES / int(src_width * sizeof(float)) - (kh - 1));
+    int const band_count = (out_height + band_rows - 1) / band_rows;
+    
+    WorkerPool::shared().parallelFor(band_count, [&](l_int32 band) {
+        int const y0 = band * band_rows;
+        int const rows = std::min(band_rows, out_height - y0);
+        int const src_rows = rows + kh - 1;
+        std::vector<float> sums(out_width);
+        std::vector<float const*> srcs(std::max(kw, kh));
+        
+        if (order == HORIZONTAL_FIRST) {
+            std::vector<float> src_line(src_width);
+            std::vector<float> temp(src_rows * out_width);
+            
+            // Horizontal pass.
+            for (int i = 0; i < kw; ++i) {
+                srcs[i] = src_line.data() + i;
+            }
+            for (int y = 0; y < src_rows; ++y) {
+                l_uint32 const* line = src_data + (y0 + y) * src_wpl;
+                for (int x = 0; x < src_width; ++x) {
+                    src_line[x] = GET_DATA_BYTE(line, x);
+                }
+                float* temp_line = &temp[y * out_width];
+                weightedSum(srcs.data(), hor, kw, temp_line, out_width);
+                for (int x = 0; x < out_width; ++x) {
+                    temp_line[x] = Rounding::intermediate(temp_line[x]);
+                }
+            }
+            
+            // Vertical pass.
+            for (int y = 0; y < rows; ++y) {
+                for (int j = 0; j < kh; ++j) {
+                    srcs[j] = &temp[(y + j) * out_width];
+                }
+                weightedSum(srcs.data(), vert, kh, sums.data(), out_width);
+                l_uint32* line = dst_data + (dst_y + y0 + y) * dst_wpl;
+                for (int x = 0; x < out_width; ++x) {
+                    SET_DATA_BYTE(line, dst_x + x, Rounding::final(sums[x]));
+                }
+            }
+        } else {
+            std::vector<float> src_lines(src_rows * src_width);
+            std::vector<float> temp(src_width);
+            for (int y = 0; y < src_rows; ++y) {
+                l_uint32 const* line = src_data + (y0 + y) * src_wpl;
+                float* src_line = &src_lines[y * src_width];
+                for (int x = 0; x < src_width; ++x) {
+                    src_line[x] = GET_DATA_BYTE(line, x);
+                }
+            }
+            
+            for (int y = 0; y < rows; ++y) {
+                // Vertical pass.
+                for (int j = 0; j < kh; ++j) {
+                    srcs[j] = &src_lines[(y + j) * src_width];
+                }
+                weightedSum(srcs.data(), vert, kh, temp.data(), src_width);
+                for (int x = 0; x < src_width; ++x) {
+                    temp[x] = Rounding::intermediate(temp[x]);
+                }
+                
+                // Horizontal pass.
+                for (int i = 0; i < kw; ++i) {
+                    srcs[i] = temp.data() + i;
+                }
+                weightedSum(srcs.data(), hor, kw, sums.data(), out_width);
+                l_uint32* line = dst_data + (dst_y + y0 + y) * dst_wpl;
+                for (int x = 0; x < out_width; ++x) {
+                    SET_DATA_BYTE(line, dst_x + x, Rounding::final(sums[x]));
+                }
+            }
+        }
+    });
 }
 
 
-Pix* savGolFilterGrayToGray(Pix* pix, Point window_size, l_int8 hor_degree, l_int8 vert_degree) {
-    Pix* src = pixEndianByteSwapNew(pix);
+Pix* savGolFilterGrayToGray(Pix* src, Point window_size, l_int8 hor_degree, l_int8 vert_degree) {
     int const width = pixGetWidth(src);
     int const height = pixGetHeight(src);
     
@@ -61,7 +276,7 @@ Pix* savGolFilterGrayToGray(Pix* pix, Point window_size, l_int8 hor_degree, l_in
     int const kh = window_size.y;
     
     if (kw > width || kh > height) {
-        return src;
+        return pixCopy(NULL, src);
     }
     
     /*
@@ -76,12 +291,6 @@ Pix* savGolFilterGrayToGray(Pix* pix, Point window_size, l_int8 hor_degree, l_in
     // Co-ordinates of the central point (C) of the kernel.
     Point const k_center(kw / 2, kh / 2);
     
-    // Origin is the current hot spot of the kernel.
-    // Normally it's at k_center, but sometimes we move
-    // it to other locations to avoid parts of the kernel
-    // from going outside of the image area.
-    Point k_origin;
-    
     // Length of the top segment (T) of the kernel.
     int const k_top = k_center.y;
     
@@ -94,67 +303,11 @@ Pix* savGolFilterGrayToGray(Pix* pix, Point window_size, l_int8 hor_degree, l_in
     // Length of the right segment (R) of the kernel.
     int const k_right = kw - k_left - 1;
     
-    uint8_t* src_data = (uint8_t*)pixGetData(src);
-    l_int32 wpl = pixGetWpl(src);
-//        for (i = 0; i < h; i += factor) {
-//            line1 = data1 + i * wpl1;
-//            line2 = data2 + i * wpl2;
-//            for (j = 0; j < w; j += factor) {
-//                val1 = GET_DATA_BYTE(line1, j);
-//                val2 = GET_DATA_BYTE(line2, j);
-//                val = L_ABS(val1 - val2);
-//                array[val]++;
-//            }
-//        }
-    
-    int const src_bpl = wpl*4;
     Pix* dst = pixCreate(width, height, 8);
     if (width > 0 && height > 0 && dst==NULL) {
         throw std::bad_alloc();
     }
     
-    uint8_t* const dst_data = (uint8_t* const)pixGetData(dst);
-    int const dst_bpl =pixGetWpl(dst)*4;
-    
-    // Top-left corner.
-    uint8_t* src_line = src_data;
-    uint8_t* dst_line = dst_data;
-    Kernel kernel(window_size, Point(0, 0), hor_degree, vert_degree);
-    for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-        k_origin.y = y;
-        for (int x = 0; x < k_left; ++x) {
-            k_origin.x= x;
-            kernel.recalcForOrigin(k_origin);
-            kernel.convolve(dst_line + x, src_line, src_bpl);
-        }
-    }
-    
-    // Top area between two corners.
-    k_origin.x = k_center.x;
-    src_line = src_data - k_left;
-    dst_line = dst_data;
-    for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-        k_origin.y = y;
-        kernel.recalcForOrigin(k_origin);
-        for (int x = k_left; x < width - k_right; ++x) {
-            kernel.convolve(dst_line + x, src_line + x, src_bpl);
-        }
-    }
-    
-    // Top-right corner.
-    k_origin.y = 0;
-    src_line = src_data + width - kw;
-    dst_line = dst_data;
-    for (int y = 0; y < k_top; ++y, dst_line += dst_bpl) {
-        k_origin.x = k_center.x + 1;
-        for (int x = width - k_right; x < width; ++x) {
-            kernel.recalcForOrigin(k_origin);
-            kernel.convolve(dst_line + x, src_line, src_bpl);
-            k_origin.x += 1;
-        }
-        k_origin.y += 1;
-    }
-    
     // Central area.
     // Take advantage of Savitzky-Golay filter being separable.
     SavGolKernel const hor_kernel(
@@ -165,123 +318,54 @@ Pix* savGolFilterGrayToGray(Pix* pix, Point window_size, l_int8 hor_degree, l_in
                                    Point(1, window_size.y),
                                    Point(0, k_center.y), 0, vert_degree
                                    );
-    
-    int const shift = kw - 1;
-    
-    // Allocate a 16-byte aligned temporary storage.
-    // That may help the compiler to emit efficient SSE code.
-    int const temp_stride = (width - shift + 3) & ~3;
-    AlignedArray<float, 4> temp_array(temp_stride * height);
-    
-    // Horizontal pass.
-    src_line = src_data - shift;
-    float* temp_line = temp_array.data() - shift;
+    convolveSeparable<TruncatingRounding>(src, hor_kernel.data(), kw, vert_kernel.data(), kh,
+                                          HORIZONTAL_FIRST, dst, k_left, k_top);
+    
+    // Border area.
+    // The window is moved so that it lies completely within the image, and the
+    // origin of the kernel is moved to the pixel being calculated instead.
+    std::shared_ptr<BorderKernels const> kernels = BorderKernels::get(window_size, hor_degree, vert_degree);
+    l_uint32* const dst_data = pixGetData(dst);
+    l_int32 const dst_wpl = pixGetWpl(dst);
     for (int y = 0; y < height; ++y) {
-        for (int i = shift; i < width; ++i) {
-            float sum = 0.0f;
-            
-            uint8_t const* src = src_line + i;
-            for (int j = 0; j < kw; ++j) {
-                sum += src[j] * hor_kernel[j];
+        bool const vert_border = y < k_top || y >= height - k_bottom;
+        int const top = bound(0, y - k_top, height - kh);
+        l_uint32* dst_line = dst_data + y * dst_wpl;
+        for (int x = 0; x < width; ++x) {
+            if (!vert_border && x == k_left) {
+                // skip the central area
+                x = width - k_right;
             }
-            temp_line[i] = sum;
-        }
-        temp_line += temp_stride;
-        src_line += src_bpl;
-    }
-    
-    // Vertical pass.
-    dst_line = dst_data + k_top * dst_bpl + k_left - shift;
-    temp_line = temp_array.data() - shift;
-    for (int y = k_top; y < height - k_bottom; ++y) {
-        for (int i = shift; i < width; ++i) {
-            float sum = 0.0f;
-            
-            float* tmp = temp_line + i;
-            for (int j = 0; j < kh; ++j, tmp += temp_stride) {
-                sum += *tmp * vert_kernel[j];
+            if (x >= width) {
+                break;
             }
-            int const val = static_cast<int>(sum);
-            dst_line[i] = static_cast<uint8_t>(bound(0, val, 255));
-        }
-        
-        temp_line += temp_stride;
-        dst_line += dst_bpl;
-    }
-    
-    // Left area between two corners.
-    k_origin.x = 0;
-    k_origin.y = k_center.y + 1;
-    for (int x = 0; x < k_left; ++x) {
-        src_line = src_data;
-        dst_line = dst_data + dst_bpl * k_top;
-        
-        kernel.recalcForOrigin(k_origin);
-        for (int y = k_top; y < height - k_bottom; ++y) {
-            kernel.convolve(dst_line + x, src_line, src_bpl);
-            src_line += src_bpl;
-            dst_line += dst_bpl;
-        }
-        k_origin.x += 1;
-    }
-    
-    // Right area between two corners.
-    k_origin.x = (k_center.x + 1);
-    k_origin.y = (k_center.y);
-    for (int x = width - k_right; x < width; ++x) {
-        src_line = src_data + width - kw;
-        dst_line = dst_data + dst_bpl * k_top;
-        
-        kernel.recalcForOrigin(k_origin);
-        for (int y = k_top; y < height - k_bottom; ++y) {
-            kernel.convolve(dst_line + x, src_line, src_bpl);
-            src_line += src_bpl;
-            dst_line += dst_bpl;
-        }
-        k_origin.x += 1;
-    }
-    
-    // Bottom-left corner.
-    k_origin.y = (k_center.y + 1);
-    src_line = src_data + src_bpl * (height - kh);
-    dst_line = dst_data + dst_bpl * (height - k_bottom);
-    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-        for (int x = 0; x < k_left; ++x) {
-            k_origin.x = x;
-            kernel.recalcForOrigin(k_origin);
-            kernel.convolve(dst_line + x, src_line, src_bpl);
+            int const left = bound(0, x - k_left, width - kw);
+            Point origin(x - left, y - top);
+            if (!vert_border && x < k_left) {
+                // The left area between the two corners has always used
+                // an origin one row below the pixel.
+                origin.y = k_center.y + 1;
+            }
+            float const* kernel = kernels->forOrigin(origin);
+            SET_DATA_BYTE(dst_line, x, convolveWindow(src, left, top, kernel, kw, kh));
         }
-        k_origin.y += 1;
     }
-    
-    // Bottom area between two corners.
-    k_origin.x = (k_center.x);
-    k_origin.y = (k_center.y + 1);
-    src_line = src_data + src_bpl * (height - kh) - k_left;
-    dst_line = dst_data + dst_bpl * (height - k_bottom);
-    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-        kernel.recalcForOrigin(k_origin);
-        for (int x = k_left; x < width - k_right; ++x) {
-            kernel.convolve(dst_line + x, src_line + x, src_bpl);
-        }
-        k_origin.y += 1;
+    return dst;
+}
+
+Pix* convolveSepGray(Pix* pix, float const* vert_kernel, float const* hor_kernel, l_int32 window_size) {
+    l_int32 const border = window_size / 2;
+    Pix* pixBordered = pixAddMirroredBorder(pix, border, border, border, border);
+    if (pixBordered == NULL) {
+        return NULL;
     }
-    
-    // Bottom-right corner.
-    k_origin.y = (k_center.y + 1);
-    src_line = src_data + src_bpl * (height - kh) + (width - kw);
-    dst_line = dst_data + dst_bpl * (height - k_bottom);
-    for (int y = height - k_bottom; y < height; ++y, dst_line += dst_bpl) {
-        k_origin.x = (k_center.x + 1);
-        for (int x = width - k_right; x < width; ++x) {
-            kernel.recalcForOrigin(k_origin);
-            kernel.convolve(dst_line + x, src_line, src_bpl);
-            k_origin.x += 1;
-        }
-        k_origin.y += 1;
+    Pix* dst = pixCreate(pixGetWidth(pix), pixGetHeight(pix), 8);
+    if (dst != NULL) {
+        pixCopyResolution(dst, pix);
+        convolveSeparable<LeptonicaRounding>(pixBordered, hor_kernel, window_size, vert_kernel, window_size,
+                                             VERTICAL_FIRST, dst, 0, 0);
     }
-    pixEndianByteSwap(dst);
-    pixDestroy(&src);
+    pixDestroy(&pixBordered);
     return dst;
 }
 
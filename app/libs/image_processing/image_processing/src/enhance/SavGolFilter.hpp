@@ -37,4 +37,16 @@
  */
 Pix* savGolFilter(Pix* src, Point window_size, l_int8 hor_degree, l_int8 vert_degree);
 
+/**
+ * \brief Same as pixConvolveSep() on an 8 bpp pix with a vertical kernel
+ * and then a horizontal kernel of window_size elements with the origin in the center.
+ *
+ * Like leptonica the pix gets a mirrored border and the absolute value is rounded
+ * after each pass. The rows are processed in cache sized bands on the WorkerPool
+ * with a vectorized inner loop.
+ * Note that leptonica inverts its kernels, so the arrays must contain the kernels
+ * in reverse order to get the same result.
+ */
+Pix* convolveSepGray(Pix* pix, float const* vert_kernel, float const* hor_kernel, l_int32 window_size);
+
 #endif /* SavGolFilter_hpp */
@@ -8,12 +8,25 @@
 
 #include "savgol.hpp"
 #include "SavGolKernel.hpp"
+#include "SavGolFilter.hpp"
+#include <algorithm>
+#include <vector>
 
 Pix* pixSavGolFilter(Pix* pix, l_uint8 window_size, l_uint8 hor_degree, l_uint8 vert_degree ){
     
     SavGolKernel const hor_kernel(Point(window_size, 1), Point(window_size/2, 0), hor_degree, 0);
     SavGolKernel const vert_kernel(Point(1, window_size), Point(0, window_size/2), 0, vert_degree);
     
+    if (pixGetDepth(pix) == 8 && pixGetColormap(pix) == NULL) {
+        // Same result as the pixConvolveSep() call below: kernelCreate() takes the height
+        // first, so hk is applied vertically and vk horizontally, and both are inverted.
+        std::vector<float> hk(hor_kernel.data(), hor_kernel.data() + window_size);
+        std::vector<float> vk(vert_kernel.data(), vert_kernel.data() + window_size);
+        std::reverse(hk.begin(), hk.end());
+        std::reverse(vk.begin(), vk.end());
+        return convolveSepGray(pix, hk.data(), vk.data(), window_size);
+    }
+    
     L_KERNEL*  hk = kernelCreate(window_size, 1);
     kernelSetOrigin(hk, window_size/2, 0);
     
@@ -22,11 +22,16 @@
  */
 
 #include "pageseg.h"
+#include "WorkerPool.h"
 #include <sstream>
 #include <iostream>
 
 using namespace std;
 
+/*pagesegGetColumns reduces the page further as long as the text stays at least this high*/
+static const l_int32 MIN_WORKING_TEXT_HEIGHT = 9;
+static const l_int32 MAX_WORKING_REDUCTION = 8;
+
 l_int32 getMedianComponentHeight(Pix* pixtl, bool debug) {
 	ostringstream s;
 	Pixa* comp;
@@ -71,83 +76,123 @@ void growTextBounds(Boxa* textBounds) {
 	}
 }
 
+/**
+ * Median height of the character sized connected components of pixb.
+ */
+static l_int32 estimateTextHeight(Pix* pixb) {
+	l_int32 w = pixGetWidth(pixb);
+	l_int32 h = pixGetHeight(pixb);
+	Boxa* boxa = pixConnCompBB(pixb, 8);
+	Numa* heights = numaCreate(0);
+	int n = boxaGetCount(boxa);
+	for (int i = 0; i < n; i++) {
+		l_int32 bw, bh;
+		boxaGetBoxGeometry(boxa, i, NULL, NULL, &bw, &bh);
+		/*skip specks, lines and images*/
+		if (bw >= 2 && bh >= 4 && bw < w / 4 && bh < h / 8) {
+			numaAddNumber(heights, bh);
+		}
+	}
+	float median = 0;
+	if (numaGetCount(heights) > 0) {
+		numaGetMedian(heights, &median);
+	}
+	numaDestroy(&heights);
+	boxaDestroy(&boxa);
+	return median;
+}
+
 Pixa* pagesegGetColumns(Pix* pixtext, bool debug) {
 	ostringstream s;
 	PIX *pixb, *pixBinary;
 	if (debug) {
 		startTimer();
 	}
-    l_int32 borderSize = 50;
-    Pix* pixBorder = pixAddBlackOrWhiteBorder(pixtext, borderSize, borderSize, borderSize, borderSize, L_GET_WHITE_VAL);
-	int w = pixGetHeight(pixBorder);
-    
 
-	s << "o1.20+c5.20+d10.5+o1." << w / 10;
+	/* The structuring elements below are sized for a 300 dpi scan at half resolution.
+	 * Pages with larger text are reduced further, so that 600 dpi scans get the same analysis. */
+	Pix* pixReduced = pixReduceRankBinaryCascade(pixtext, 1, 0, 0, 0);
+	l_int32 reduction = 2;
+	l_int32 textHeight = estimateTextHeight(pixReduced);
+	while (textHeight / 2 >= MIN_WORKING_TEXT_HEIGHT && reduction < MAX_WORKING_REDUCTION) {
+		Pix* pixt = pixReduceRankBinary2(pixReduced, 1, NULL);
+		pixDestroy(&pixReduced);
+		pixReduced = pixt;
+		reduction *= 2;
+		textHeight /= 2;
+	}
+	if (debug) {
+		std::cout << "reduction: " << reduction << "\n" << "text height: " << textHeight << "\n";
+	}
+	l_int32 borderSize = 25;
+	pixBinary = pixAddBlackOrWhiteBorder(pixReduced, borderSize, borderSize, borderSize, borderSize, L_GET_WHITE_VAL);
+	pixDestroy(&pixReduced);
 
 	/*remove long vertical lines*/
-	Pix* pixvl = pixMorphCompSequence(pixBorder, s.str().c_str(), 0);
-	pixSetMasked(pixBorder, pixvl, 0);
-	pixDestroy(&pixvl);
-
-	pixBinary = pixReduceRankBinaryCascade(pixBorder, 1, 0, 0, 0);
-
-    pixDestroy(&pixBorder);
+	Pix* pixMask = pixOpenCompBrickDwa(NULL, pixBinary, 1, 10);
+	pixCloseCompBrickDwa(pixMask, pixMask, 3, 10);
+	pixDilateCompBrickDwa(pixMask, pixMask, 5, 3);
+	pixOpenCompBrickDwa(pixMask, pixMask, 1, pixGetHeight(pixBinary) / 10);
+	pixSetMasked(pixBinary, pixMask, 0);
 
 	/*remove long horizontal lines*/
-	Pix* pixhl = pixMorphCompSequence(pixBinary, "o70.1+c20.5+d5.10", 0);
-	pixSetMasked(pixBinary, pixhl, 0);
-	pixDestroy(&pixhl);
+	pixOpenCompBrickDwa(pixMask, pixBinary, 70, 1);
+	pixCloseCompBrickDwa(pixMask, pixMask, 20, 5);
+	pixDilateCompBrickDwa(pixMask, pixMask, 5, 10);
+	pixSetMasked(pixBinary, pixMask, 0);
+	pixDestroy(&pixMask);
 
 	pixb = pixInvert(NULL, pixBinary);
 
-	/*create vertical whitespace mask*/
-	//Pix *pixvws = pixMorphCompSequence(pixb, "o1.100+c2.1+o7.1+c7.10+c1.50", 0);
-	Pix *pixvws = pixMorphCompSequence(pixb, "o1.100+c2.1+o7.1+c7.10", 0);
-
-	/* Three steps to getting text line mask:
+	/* The whitespace masks and the closed text lines are independent of each other:
+	 *   (0) vertical whitespace mask
 	 *   (1) close the characters and words in the textlines
-	 *   (2) open the vertical whitespace corridors back up
-	 *   (3) small opening to remove noise    */
-	pixCloseSafeBrick(pixBinary, pixBinary, 60, 1);
-	//pixDisplay(pixBinary,0,0);
+	 *   (2) horizontal whitespace mask, opened further once the line spacing is known */
+	Pix *pixvws = NULL, *pixhws = NULL;
+	WorkerPool::shared().parallelFor(3, [&](l_int32 i) {
+		if (i == 0) {
+			pixvws = pixOpenCompBrickDwa(NULL, pixb, 1, 100);
+			pixCloseCompBrickDwa(pixvws, pixvws, 2, 1);
+			pixOpenCompBrickDwa(pixvws, pixvws, 7, 1);
+			pixCloseCompBrickDwa(pixvws, pixvws, 7, 10);
+		} else if (i == 1) {
+			pixCloseCompBrickDwa(pixBinary, pixBinary, 60, 1);
+		} else {
+			pixhws = pixOpenCompBrickDwa(NULL, pixb, 50, 1);
+		}
+	});
+	pixDestroy(&pixb);
+
+	/* open the vertical whitespace corridors back up and remove noise */
 	pixSubtract(pixBinary, pixBinary, pixvws);
 	pixOpenBrick(pixBinary, pixBinary, 1, 3);
-	Pix* pixtl = pixMorphCompSequence(pixBinary, "o1.3+o25.1", 0);
-	pixDestroy(&pixBinary);
+	pixOpenCompBrickDwa(pixBinary, pixBinary, 25, 1);
 
 	/*make a guess at the text size*/
-	int ts = getMedianComponentHeight(pixtl, debug);
-	pixBinary = pixtl;
-
-	/*close inter word spacing*/
-	pixCloseBrick(pixtl, pixtl, ts * 2, 1);
-	pixOpenBrick(pixvws, pixvws, ts * 1.2, 1);
-
-	/*make a guess at the line spacing*/
-	/*create components for vertical white space between text lines */
-	s.str("");
-	s << "c1." << ts * 3;
-	Pix* pixls = pixMorphCompSequence(pixtl, s.str().c_str(), 0);
-	pixSubtract(pixls, pixls, pixtl);
-	/*small opening to remove noise*/
-	pixOpenBrick(pixls, pixls, 2, 2);
-	int ls = getMedianComponentHeight(pixls, debug);
-	pixDestroy(&pixls);
-
-	/*create horizontal whitespace mask*/
-	s.str("");
-	s << "o50.1";
-	Pix *pixhws = pixMorphCompSequence(pixb, s.str().c_str(), 0);
-	pixDestroy(&pixb);
-	//	pixOpenBrick(pixhws, pixhws, 1, ls * 1.6);
-	pixOpenBrick(pixhws, pixhws, 1, ls * 1.5);
+	int ts = L_MAX(1, getMedianComponentHeight(pixBinary, debug));
+
+	WorkerPool::shared().parallelFor(2, [&](l_int32 i) {
+		if (i == 0) {
+			pixOpenCompBrickDwa(pixvws, pixvws, ts * 1.2, 1);
+			return;
+		}
+		/*close inter word spacing*/
+		pixCloseCompBrickDwa(pixBinary, pixBinary, ts * 2, 1);
+
+		/*make a guess at the line spacing*/
+		/*create components for vertical white space between text lines */
+		Pix* pixls = pixCloseCompBrickDwa(NULL, pixBinary, 1, ts * 3);
+		pixSubtract(pixls, pixls, pixBinary);
+		/*small opening to remove noise*/
+		pixOpenBrick(pixls, pixls, 2, 2);
+		int ls = L_MAX(1, getMedianComponentHeight(pixls, debug));
+		pixDestroy(&pixls);
+		pixOpenCompBrickDwa(pixhws, pixhws, 1, ls * 1.5);
+	});
 
 	/* Join pixels vertically to make a textblock mask */
-	s.str("");
-	s << "c" << ts << "." << ts * 8 << "+ o4.1";
-	pixb = pixBinary;
-	pixBinary = pixMorphSequence(pixb, s.str().c_str(), 0);
-	pixDestroy(&pixb);
+	pixCloseCompBrickDwa(pixBinary, pixBinary, ts, ts * 8);
+	pixOpenBrick(pixBinary, pixBinary, 4, 1);
 	pixSubtract(pixBinary, pixBinary, pixhws);
 	pixDestroy(&pixhws);
 
@@ -161,7 +206,7 @@ Pixa* pagesegGetColumns(Pix* pixtext, bool debug) {
 	s << "c" << ts << "." << ts << "+d3.3";
 	Pix* pixt2 = pixMorphSequenceByComponent(pixBinary, s.str().c_str(), 8, 0, 0, NULL);
 	pixDestroy(&pixBinary);
-	pixCloseSafeBrick(pixt2, pixt2, 10, 1);
+	pixCloseCompBrickDwa(pixt2, pixt2, 10, 1);
 	pixSubtract(pixt2, pixt2, pixvws);
 
 	Pix* pixd = pixSelectBySize(pixt2, ts * 5, ts, 4, L_SELECT_IF_EITHER, L_SELECT_IF_GTE, NULL);
@@ -179,12 +224,12 @@ Pixa* pagesegGetColumns(Pix* pixtext, bool debug) {
 	//	pixDestroy(&pixsep2);
 	/* Expand mask to full resolution, and do filling or
 	 * small dilations for better coverage. */
-	pixBinary = pixExpandReplicate(pixd, 2);
+	pixBinary = pixExpandReplicate(pixd, reduction);
 	pixDestroy(&pixd);
 	pixDilateBrick(pixBinary, pixBinary, 3, 3);
 
 	Boxa* boxatext = pixConnCompBB(pixBinary, 8);
-    Boxa* translated = boxaTranslate(boxatext, -borderSize, -borderSize);
+	Boxa* translated = boxaTranslate(boxatext, -borderSize * reduction, -borderSize * reduction);
 	Pixa* pixaText = pixaCreateFromBoxa(pixtext, translated, NULL);
     
 	//substract
@@ -199,45 +244,62 @@ Pixa* pagesegGetColumns(Pix* pixtext, bool debug) {
 	return pixaText;
 }
 
-void segmentComplexLayout(Pix* pixOrg,Pix* pixhm, Pix* pixb, Pixa** pixaImage, Pixa** pixaText, ProgressCallback* callback, bool debug) {
-	ostringstream debugstring;
-
-	if (debug) {
-		startTimer();
-	}
-
-	if (debug) {
-		debugstring << "Image-Text separation: " << stopTimer() << std::endl;
-		startTimer();
+/**
+ * Shows the images of pixOrg inside the binarized text of pixb. The preview is reduced by
+ * powers of two until its longest edge is at most maxEdge.
+ */
+Pix* pixMakeLayoutPreview(Pix* pixOrg, Pix* pixhm, Pix* pixb, l_int32 maxEdge) {
+	Pix* pixtext = pixClone(pixb);
+	Pix* pixImageMask = pixhm != NULL ? pixClone(pixhm) : NULL;
+	while (L_MAX(pixGetWidth(pixtext), pixGetHeight(pixtext)) > maxEdge) {
+		Pix* pixReduced = pixReduceRankBinary2(pixtext, 1, NULL);
+		pixDestroy(&pixtext);
+		pixtext = pixReduced;
+		if (pixImageMask != NULL) {
+			pixReduced = pixReduceBinary2(pixImageMask, NULL);
+			pixDestroy(&pixImageMask);
+			pixImageMask = pixReduced;
+		}
 	}
-	/*create preview image*/
-	Pix* pixpreview = NULL;
-	if (pixhm != NULL) {
-		Pix* pixb2 = pixReduceBinary2(pixb, NULL);
-		Pix* pixhm2 = pixReduceBinary2(pixhm, NULL);
-		Pix* pixtext32 = pixConvertTo32(pixb2);
-		Pix* pixOrg2 = pixScale(pixOrg, 0.5, 0.5);
-		pixDestroy(&pixb2);
-		pixInvert(pixhm2, pixhm2);
-		pixPaintThroughMask(pixOrg2, pixhm2, 0, 0, 0);
-		pixDestroy(&pixhm2);
-		Pix* pixmask = pixConvertTo1(pixOrg2, 1);
-		pixCombineMasked(pixOrg2, pixtext32, pixmask);
-		pixDestroy(&pixmask);
-		pixDestroy(&pixtext32);
-		pixpreview = pixOrg2;
-	} else {
-		Pix* pixtext32 = pixConvertTo32(pixb);
-		pixpreview = pixtext32;
+	if (pixImageMask == NULL) {
+		return pixtext;
 	}
 
-	if (debug) {
-		debugstring << "Preview-Image generation: " << stopTimer() << std::endl;
+	Pix* pixtext32 = pixConvertTo32(pixtext);
+	pixDestroy(&pixtext);
+	Pix* pixScaled = pixScaleToSize(pixOrg, pixGetWidth(pixtext32), pixGetHeight(pixtext32));
+	Pix* pixpreview = pixConvertTo32(pixScaled);
+	pixDestroy(&pixScaled);
+	/*pixImageMask may still be a clone of pixhm, which must not be changed*/
+	Pix* pixNoImages = pixInvert(NULL, pixImageMask);
+	pixDestroy(&pixImageMask);
+	pixPaintThroughMask(pixpreview, pixNoImages, 0, 0, 0);
+	pixDestroy(&pixNoImages);
+	Pix* pixmask = pixConvertTo1(pixpreview, 1);
+	pixCombineMasked(pixpreview, pixtext32, pixmask);
+	pixDestroy(&pixmask);
+	pixDestroy(&pixtext32);
+	return pixpreview;
+}
+
+void segmentComplexLayout(Pix* pixOrg,Pix* pixhm, Pix* pixb, Pixa** pixaImage, Pixa** pixaText, ProgressCallback* callback, bool debug) {
+	ostringstream debugstring;
+
+	/*the preview only adds to pixb if there are images to show*/
+	if (callback != NULL && pixhm != NULL) {
+		if (debug) {
+			startTimer();
+		}
+		Pix* pixpreview = pixMakeLayoutPreview(pixOrg, pixhm, pixb, PREVIEW_MAX_EDGE);
+		callback->sendPix(pixpreview);
+		pixDestroy(&pixpreview);
+		if (debug) {
+			debugstring << "Preview-Image generation: " << stopTimer() << std::endl;
+		}
 	}
     if(callback!=NULL){
         callback->sendMessage(MESSAGE_ANALYSE_LAYOUT);
     }
-    pixDestroy(&pixpreview);
 
 	if (debug) {
 		startTimer();
@@ -30,6 +30,7 @@
 l_int32 renderTransformedBoxa(PIX *pixt, BOXA *boxa, l_int32 i);
 Pixa* pagesegGetColumns(Pix* pixtext, bool debug);
 Pix* combinePixa(Pixa* pixaText, bool debug);
+Pix* pixMakeLayoutPreview(Pix* pixOrg, Pix* pixhm, Pix* pixb, l_int32 maxEdge);
 void segmentComplexLayout(Pix* pixOrg, Pix* pixhm, Pix* pixb, Pixa** pixaImage, Pixa** pixaText, ProgressCallback* callback,bool debug);
 void extractImages(Pix* pixOrg, Pix** pixhm, Pix** pixg);
 
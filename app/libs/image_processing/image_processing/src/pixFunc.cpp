@@ -170,8 +170,8 @@ Pix* livreAdapt(Pix* pixs){
     return pix1;
 }
 
-void setResolutionBasedOnTextSize(Pix* pix, l_float32 textLineHeight){
-    FUNCNAME("setResolutionBasedOnTextSize");
+static l_int32 resolutionBasedOnTextSize(Pix* pix, l_float32 textLineHeight){
+    FUNCNAME("resolutionBasedOnTextSize");
     l_uint32 res;
     //12pt at 300dpi is roughly 48px
     //since font size is unknown we assume 12pt font
@@ -185,17 +185,32 @@ void setResolutionBasedOnTextSize(Pix* pix, l_float32 textLineHeight){
         res = L_MIN(600, 6.25 * textLineHeight);
     }
     L_INFO("text line height = %.2f, dpi = %i\n", procName, textLineHeight, res);
-    pixSetResolution(pix, res, res);
+    return res;
 }
 
 Pix* findResolution(Pix* pix) {
     FUNCNAME("findResolution");
     l_int32 lines;
     l_float32 textLineHeight = pixGetTextLineHeightGeneral(pix, &lines);
-    setResolutionBasedOnTextSize(pix, textLineHeight);
+    l_int32 res = resolutionBasedOnTextSize(pix, textLineHeight);
+    pixSetResolution(pix, res, res);
     return pixClone(pix);
 }
 
+/**
+ * Returns the resolution that findResolution sets on the 8 bit version of pix,
+ * without converting more than that measurement needs.
+ */
+l_int32 estimateResolution(Pix* pix) {
+    FUNCNAME("estimateResolution");
+    l_int32 lines;
+    // pixGetTextLineHeightGeneral converts everything but binary images to 8 bit itself
+    Pix* pix8 = pixGetDepth(pix) == 1 ? pixConvertTo8(pix, FALSE) : pixClone(pix);
+    l_float32 textLineHeight = pixGetTextLineHeightGeneral(pix8, &lines);
+    pixDestroy(&pix8);
+    return resolutionBasedOnTextSize(pix, textLineHeight);
+}
+
 Pix* pixCorrectOrientation(Pix* pix){
     FUNCNAME("pixCorrectOrientation");
     l_float32 upConf,leftConf;
@@ -229,16 +244,29 @@ Pix* savGol32(Pix* pix){
     return result;
 }
 
-Pix* savGol(Pix* pix) {
-    FUNCNAME("savGol");
-    l_int32 xres, yres;
-    pixGetResolution(pix, &xres, &yres);
-    l_uint8 degree = 4;
+static l_uint8 savGolWindow(l_int32 yres) {
     l_float32 textLineHeight = yres/6.25;
     l_uint8 window = L_MIN(15, L_MAX(5, textLineHeight/4));
     if(window % 2 == 0){
         window--;
     }
+    return window;
+}
+
+/**
+ * Number of rows above and below a row that savGol needs to see on a page with the given
+ * vertical resolution.
+ */
+l_int32 savGolHalo(l_int32 yres) {
+    return savGolWindow(yres) / 2;
+}
+
+Pix* savGol(Pix* pix) {
+    FUNCNAME("savGol");
+    l_int32 yres = pixGetYRes(pix);
+    l_uint8 degree = 4;
+    l_float32 textLineHeight = yres/6.25;
+    l_uint8 window = savGolWindow(yres);
 
     L_INFO("text line height = %.2f, window = %i, degree = %i\n", procName, textLineHeight, window, degree);
     Pix* result =  pixSavGolFilter(pix, window, degree, degree);
@@ -307,13 +335,31 @@ Pix* ensure150dpi(Pix* pix) {
     return pixScaleBinary(pix, scale, scale);
 }
 
+/**
+ * Returns a pixel local stage that converts a page to 8 bit and gives it the resolution
+ * that estimateResolution found on the whole page, so that savGol can run in the same band.
+ */
+static PIX_FUNC convertTo8WithResolution(l_int32 res) {
+    return [res](Pix* p){
+        Pix* pix8 = convertTo8(p);
+        pixSetResolution(pix8, res, res);
+        return pix8;
+    };
+}
+
 Pix* pixPrepareForOcr(Pix* pixOrg, ProgressCallback* callback) {
+    FUNCNAME("pixPrepareForOcr");
     auto binarizeWithCallback = [&](Pix* p){
         return binarize(p, callback);
     };
-    Pix* result = run(pixOrg, {convertTo8, findResolution, savGol, binarizeWithCallback , ensure150dpi, dewarpOrDeskew});
-    FUNCNAME("pixPrepareForOcr");
-    return result;
+    l_int32 res = estimateResolution(pixOrg);
+    PixPipeline pipeline;
+    pipeline.addPixelLocal(convertTo8WithResolution(res))
+            .addRowLocal(savGol, [res](Pix*){ return savGolHalo(res); })
+            .addWholePage(binarizeWithCallback)
+            .addWholePage(ensure150dpi)
+            .addWholePage(dewarpOrDeskew);
+    return pipeline.run(pixOrg);
 }
 
 Pix* pixPrepareLayoutAnalysis(Pix* pixOrg, ProgressCallback* callback) {
@@ -321,31 +367,25 @@ Pix* pixPrepareLayoutAnalysis(Pix* pixOrg, ProgressCallback* callback) {
     auto binarizeWithCallback = [&](Pix* p){
         return binarize(p, callback);
     };
-    return run(pixOrg, {convertTo8, findResolution, savGol, binarizeWithCallback}, callback);
+    l_int32 res = estimateResolution(pixOrg);
+    PixPipeline pipeline(callback);
+    pipeline.addPixelLocal(convertTo8WithResolution(res))
+            .addRowLocal(savGol, [res](Pix*){ return savGolHalo(res); })
+            .addWholePage(binarizeWithCallback);
+    return pipeline.run(pixOrg);
 }
 
 Pix* run(Pix* pix, const std::list<PIX_FUNC>& funcs, ProgressCallback* callback) {
-    Pix* pixConverted = pixClone(pix);
+    PixPipeline pipeline(callback);
     for (auto &func : funcs) {
-        Pix* newPix = timePixFunc(pixConverted, func);
-        //Pix* newPix = (*it)(pixConverted);
-        if(callback!=nullptr){
-            callback->sendPix(newPix);
-        }
-        pixDestroy(&pixConverted);
-        pixConverted = newPix;
+        pipeline.addWholePage([func](Pix* p){
+            return timePixFunc(p, func);
+        });
     }
-    return pixConverted;
+    return pipeline.run(pix);
 }
 
 
 Pix* run(Pix* pix, const std::list<PIX_FUNC>& funcs) {
-    Pix* pixConverted = pixClone(pix);
-    for (auto &func : funcs) {
-        Pix* newPix = timePixFunc(pixConverted, func);
-        //Pix* newPix = (*it)(pixConverted);
-        pixDestroy(&pixConverted);
-        pixConverted = newPix;
-    }
-    return pixConverted;
+    return run(pix, funcs, nullptr);
 }
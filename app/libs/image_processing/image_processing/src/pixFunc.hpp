@@ -13,11 +13,9 @@
 #include "allheaders.h"
 #include <list>
 #include "ProgressCallback.h"
+#include "PixPipeline.h"
 #include <functional>
 
-//typedef Pix* (*PIX_FUNC)(Pix* pix);
-typedef std::function<Pix*(Pix* pix)> PIX_FUNC;
-
 Pix* run(Pix* pix, const std::list<PIX_FUNC>& funcs);
 Pix* run(Pix* pix, const std::list<PIX_FUNC>& funcs, ProgressCallback* callback);
 
@@ -39,9 +37,11 @@ Pix* medianFilter(Pix* pix);
 Pix* unsharpMasking(Pix* pix);
 Pix* livreAdapt(Pix* pixs);
 Pix* findResolution(Pix* pixs);
+l_int32 estimateResolution(Pix* pix);
 Pix* blurDetect(Pix* pixs);
 Pix* stats(Pix* pixs);
 Pix* savGol(Pix* pix);
+l_int32 savGolHalo(l_int32 yres);
 Pix* savGol32(Pix* pix);
 Pix* reduce2(Pix* pix);
 Pix* reduceGray2(Pix* pix);
@@ -8,6 +8,7 @@ LOCAL_MODULE := libtess
 LOCAL_SRC_FILES += \
   pageiterator.cpp \
   html_text.cpp \
+  ocrsessionpool.cpp \
   resultiterator.cpp \
   tessbaseapi.cpp
 
@@ -74,6 +75,11 @@ LOCAL_CFLAGS := \
   -DTESSERACT_MICRO_VERSION=0 \
   -Wno-shift-negative-value
 
+# NEON kernels in arch/ are selected at compile time via __ARM_NEON.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_C_INCLUDES)
 LOCAL_EXPORT_CFLAGS := $(LOCAL_CFLAGS)
 LOCAL_SHARED_LIBRARIES += liblept_shared # to inherit C_INCLUDE and CFLAGS
@@ -0,0 +1,459 @@
+/*  This file is part of Text Fairy.
+
+ Text Fairy is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ Text Fairy is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with Text Fairy.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ocrsessionpool.cpp
+ *
+ * A fixed number of Tesseract instances which are initialised once with the same
+ * tessdata and then recognize queued pages in parallel, one page per instance.
+ */
+
+#include "common.h"
+#include "baseapi.h"
+#include "ocrclass.h"
+#include "allheaders.h"
+#include "html_text.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ocr_page_t {
+    int id;
+    PIX *pix;
+    tesseract::PageSegMode pageSegMode;
+    bool sparseTextFallback;
+    std::atomic<bool> cancel_ocr;
+    bool done;
+
+    std::string hocrText;
+    std::string htmlText;
+    std::string utf8Text;
+    int meanConfidence;
+
+    ocr_page_t(int pageId, PIX *pixs, tesseract::PageSegMode mode, bool fallback) {
+        id = pageId;
+        pix = pixClone(pixs);
+        pageSegMode = mode;
+        sparseTextFallback = fallback;
+        cancel_ocr = false;
+        done = false;
+        meanConfidence = 0;
+    }
+
+    ~ocr_page_t() {
+        pixDestroy(&pix);
+    }
+};
+
+static jmethodID method_onProgressValues;
+
+/**
+ * State of Tesseract's monitor while a session recognizes a page.
+ */
+struct page_monitor_t {
+    ocr_page_t *page;
+    // the Java pool and the env of the session's thread, both null without progress callback
+    jobject callbackObject;
+    JNIEnv *env;
+    int lastProgress;
+};
+
+/**
+ * Callback for Tesseract's monitor to cancel the recognition of a single page.
+ */
+static bool cancelPageFunc(void *cancel_this, int words) {
+    auto *state = (page_monitor_t *) cancel_this;
+    return state->page->cancel_ocr;
+}
+
+/**
+ * Callback for Tesseract's monitor to report the progress of a single page, like
+ * progressJavaCallback in tessbaseapi.cpp. The text box is always the whole page.
+ */
+static bool pageProgressFunc(ETEXT_DESC *monitor, int left, int right, int top, int bottom) {
+    auto *state = (page_monitor_t *) monitor->cancel_this;
+    int progress = monitor->progress;
+    if (state->env != nullptr && !state->page->cancel_ocr &&
+        (progress > state->lastProgress || left != 0 || right != 0 || top != 0 || bottom != 0)) {
+        PIX *pix = state->page->pix;
+        state->env->CallVoidMethod(state->callbackObject, method_onProgressValues,
+                                   (jint) state->page->id, (jint) progress,
+                                   (jint) left, (jint) right, (jint) top, (jint) bottom,
+                                   (jint) 0, (jint) pixGetWidth(pix),
+                                   (jint) 0, (jint) pixGetHeight(pix));
+        if (state->env->ExceptionCheck()) {
+            // there is no Java caller on the session's thread that could handle it
+            LOGE("Exception in the progress callback of page %d", state->page->id);
+            state->env->ExceptionClear();
+        }
+        state->lastProgress = progress;
+    }
+    return true;
+}
+
+static std::string takeText(char *text) {
+    std::string result;
+    if (text != nullptr) {
+        result = text;
+        delete[] text;
+    }
+    return result;
+}
+
+class OcrSessionPool {
+public:
+    /**
+     * callbackObject is a global reference to the Java pool that receives the progress of
+     * every page, or null. It stays owned by the caller.
+     */
+    OcrSessionPool(JavaVM *vm, jobject callbackObject)
+            : vm(vm), callbackObject(callbackObject), nextPageId(0), waiting(0), stopping(false) {
+    }
+
+    /**
+     * Cancels all pages. Pages that are still queued are never recognized, their
+     * results are empty. Waits for the threads that wait in takePage() to leave it.
+     */
+    ~OcrSessionPool() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+            for (auto &entry : pages) {
+                entry.second->cancel_ocr = true;
+            }
+            for (ocr_page_t *page : queue) {
+                page->done = true;
+            }
+            queue.clear();
+            finished.notify_all();
+            queued.notify_all();
+            finished.wait(lock, [this] { return waiting == 0; });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        for (auto &entry : pages) {
+            delete entry.second;
+        }
+        for (tesseract::TessBaseAPI *api : sessions) {
+            api->End();
+            delete api;
+        }
+        // The sessions shared their dictionaries and LSTM weights.
+        tesseract::TessBaseAPI::ClearPersistentCache();
+    }
+
+    /**
+     * Initialises up to size sessions with the same language and engine mode. The
+     * sessions are loaded one after the other to keep the peak memory of loading
+     * the traineddata low. Returns the number of usable sessions.
+     */
+    int init(const char *datapath, const char *language, tesseract::OcrEngineMode oem, int size) {
+        for (int i = 0; i < size; i++) {
+            auto *api = new tesseract::TessBaseAPI();
+            if (api->Init(datapath, language, oem)) {
+                LOGE("Could not initialize session %d with language=%s!", i, language);
+                delete api;
+                break;
+            }
+            sessions.push_back(api);
+        }
+        LOGI("Initialized %d sessions with language=%s", (int) sessions.size(), language);
+        return (int) sessions.size();
+    }
+
+    /**
+     * Sets a variable on all sessions. Must be called before the first page is added.
+     */
+    bool setVariable(const char *name, const char *value) {
+        bool set = !sessions.empty();
+        for (tesseract::TessBaseAPI *api : sessions) {
+            set &= api->SetVariable(name, value);
+        }
+        return set;
+    }
+
+    /**
+     * Queues a page for recognition and returns its id. The pool keeps its own
+     * clone of pix.
+     */
+    int addPage(PIX *pix, tesseract::PageSegMode mode, bool sparseTextFallback) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty()) {
+            for (tesseract::TessBaseAPI *api : sessions) {
+                workers.emplace_back(&OcrSessionPool::run, this, api);
+            }
+        }
+        int id = nextPageId++;
+        auto *page = new ocr_page_t(id, pix, mode, sparseTextFallback);
+        pages[id] = page;
+        queue.push_back(page);
+        queued.notify_one();
+        return id;
+    }
+
+    /**
+     * Blocks until the page has been recognized or the pool is destroyed and hands
+     * it over to the caller. Returns nullptr for unknown page ids.
+     */
+    ocr_page_t *takePage(int id) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = pages.find(id);
+        if (it == pages.end()) {
+            return nullptr;
+        }
+        ocr_page_t *page = it->second;
+        waiting++;
+        finished.wait(lock, [page] { return page->done; });
+        waiting--;
+        pages.erase(it);
+        if (stopping && waiting == 0) {
+            // the destructor waits for the last waiting thread
+            finished.notify_all();
+        }
+        return page;
+    }
+
+    jobject getCallbackObject() const {
+        return callbackObject;
+    }
+
+    void cancelPage(int id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pages.find(id);
+        if (it != pages.end()) {
+            it->second->cancel_ocr = true;
+        }
+    }
+
+private:
+    void run(tesseract::TessBaseAPI *api) {
+        // the session's thread stays attached while it runs, to report the progress
+        JNIEnv *env = nullptr;
+        if (callbackObject != nullptr && vm->AttachCurrentThread(&env, nullptr) != 0) {
+            LOGE("Failed to attach, no progress will be reported");
+            env = nullptr;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            queued.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                break;
+            }
+            ocr_page_t *page = queue.front();
+            queue.pop_front();
+            lock.unlock();
+
+            if (!page->cancel_ocr) {
+                recognize(api, page, env);
+            }
+
+            lock.lock();
+            page->done = true;
+            finished.notify_all();
+        }
+        lock.unlock();
+
+        if (env != nullptr) {
+            vm->DetachCurrentThread();
+        }
+    }
+
+    bool recognizeWithMode(tesseract::TessBaseAPI *api, ocr_page_t *page, JNIEnv *env,
+                           tesseract::PageSegMode mode) {
+        page_monitor_t state = {page, callbackObject, env, 0};
+        ETEXT_DESC monitor;
+        monitor.progress_callback2 = pageProgressFunc;
+        monitor.cancel = cancelPageFunc;
+        monitor.cancel_this = &state;
+
+        api->SetPageSegMode(mode);
+        api->SetImage(page->pix);
+        page->hocrText = takeText(api->GetHOCRText(&monitor, 0));
+        if (page->cancel_ocr) {
+            return false;
+        }
+        page->meanConfidence = api->MeanTextConf();
+        page->utf8Text = takeText(api->GetUTF8Text());
+        return true;
+    }
+
+    void recognize(tesseract::TessBaseAPI *api, ocr_page_t *page, JNIEnv *env) {
+        bool recognized = recognizeWithMode(api, page, env, page->pageSegMode);
+        if (recognized && page->sparseTextFallback && page->utf8Text.empty() &&
+            page->pageSegMode != tesseract::PSM_SPARSE_TEXT) {
+            LOGI("No words found. Looking for sparse text.");
+            recognized = recognizeWithMode(api, page, env, tesseract::PSM_SPARSE_TEXT);
+        }
+        if (recognized) {
+            tesseract::ResultIterator *res_it = api->GetIterator();
+            if (res_it != nullptr) {
+                page->htmlText = GetHTMLText(res_it, 70);
+                delete res_it;
+            }
+        }
+        api->Clear();
+    }
+
+    JavaVM *vm;
+    jobject callbackObject;
+    std::vector<tesseract::TessBaseAPI *> sessions;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable finished;
+    std::deque<ocr_page_t *> queue;
+    std::map<int, ocr_page_t *> pages;
+    int nextPageId;
+    // number of threads in takePage()
+    int waiting;
+    bool stopping;
+};
+
+static jfieldID field_PageResult_hocrText;
+static jfieldID field_PageResult_htmlText;
+static jfieldID field_PageResult_utf8Text;
+static jfieldID field_PageResult_meanConfidence;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void Java_com_googlecode_tesseract_android_OcrSessionPool_nativeClassInit(JNIEnv *env,
+                                                                          jclass clazz,
+                                                                          jclass resultClass) {
+    method_onProgressValues = env->GetMethodID(clazz, "onProgressValues", "(IIIIIIIIII)V");
+    field_PageResult_hocrText = env->GetFieldID(resultClass, "hocrText", "Ljava/lang/String;");
+    field_PageResult_htmlText = env->GetFieldID(resultClass, "htmlText", "Ljava/lang/String;");
+    field_PageResult_utf8Text = env->GetFieldID(resultClass, "utf8Text", "Ljava/lang/String;");
+    field_PageResult_meanConfidence = env->GetFieldID(resultClass, "meanConfidence", "I");
+}
+
+jlong Java_com_googlecode_tesseract_android_OcrSessionPool_nativeConstruct(JNIEnv *env,
+                                                                          jclass clazz,
+                                                                          jobject callbackObject,
+                                                                          jstring dir,
+                                                                          jstring lang,
+                                                                          jint mode,
+                                                                          jint size) {
+    const char *c_dir = env->GetStringUTFChars(dir, NULL);
+    const char *c_lang = env->GetStringUTFChars(lang, NULL);
+
+    JavaVM *vm = nullptr;
+    env->GetJavaVM(&vm);
+    jobject callbackRef = callbackObject != nullptr ? env->NewGlobalRef(callbackObject) : nullptr;
+    auto *pool = new OcrSessionPool(vm, callbackRef);
+    if (pool->init(c_dir, c_lang, (tesseract::OcrEngineMode) mode, size) == 0) {
+        delete pool;
+        pool = nullptr;
+        if (callbackRef != nullptr) {
+            env->DeleteGlobalRef(callbackRef);
+        }
+    }
+
+    env->ReleaseStringUTFChars(dir, c_dir);
+    env->ReleaseStringUTFChars(lang, c_lang);
+
+    return (jlong) pool;
+}
+
+jboolean Java_com_googlecode_tesseract_android_OcrSessionPool_nativeSetVariable(JNIEnv *env,
+                                                                               jclass clazz,
+                                                                               jlong nativePool,
+                                                                               jstring var,
+                                                                               jstring value) {
+    auto *pool = (OcrSessionPool *) nativePool;
+
+    const char *c_var = env->GetStringUTFChars(var, NULL);
+    const char *c_value = env->GetStringUTFChars(value, NULL);
+
+    jboolean set = pool->setVariable(c_var, c_value) ? JNI_TRUE : JNI_FALSE;
+
+    env->ReleaseStringUTFChars(var, c_var);
+    env->ReleaseStringUTFChars(value, c_value);
+
+    return set;
+}
+
+jint Java_com_googlecode_tesseract_android_OcrSessionPool_nativeAddPage(JNIEnv *env,
+                                                                       jclass clazz,
+                                                                       jlong nativePool,
+                                                                       jlong nativePix,
+                                                                       jint pageSegMode,
+                                                                       jboolean sparseTextFallback) {
+    auto *pool = (OcrSessionPool *) nativePool;
+    return pool->addPage((PIX *) nativePix, (tesseract::PageSegMode) pageSegMode,
+                         sparseTextFallback == JNI_TRUE);
+}
+
+jboolean Java_com_googlecode_tesseract_android_OcrSessionPool_nativeGetResult(JNIEnv *env,
+                                                                             jclass clazz,
+                                                                             jlong nativePool,
+                                                                             jint pageId,
+                                                                             jobject result) {
+    auto *pool = (OcrSessionPool *) nativePool;
+    ocr_page_t *page = pool->takePage(pageId);
+    if (page == nullptr) {
+        LOGE("unknown page %d", pageId);
+        return JNI_FALSE;
+    }
+    jboolean recognized = page->cancel_ocr ? JNI_FALSE : JNI_TRUE;
+    if (recognized) {
+        jstring hocrText = env->NewStringUTF(page->hocrText.c_str());
+        env->SetObjectField(result, field_PageResult_hocrText, hocrText);
+        env->DeleteLocalRef(hocrText);
+        jstring htmlText = env->NewStringUTF(page->htmlText.c_str());
+        env->SetObjectField(result, field_PageResult_htmlText, htmlText);
+        env->DeleteLocalRef(htmlText);
+        jstring utf8Text = env->NewStringUTF(page->utf8Text.c_str());
+        env->SetObjectField(result, field_PageResult_utf8Text, utf8Text);
+        env->DeleteLocalRef(utf8Text);
+        env->SetIntField(result, field_PageResult_meanConfidence, page->meanConfidence);
+    }
+    delete page;
+    return recognized;
+}
+
+void Java_com_googlecode_tesseract_android_OcrSessionPool_nativeCancelPage(JNIEnv *env,
+                                                                          jclass clazz,
+                                                                          jlong nativePool,
+                                                                          jint pageId) {
+    auto *pool = (OcrSessionPool *) nativePool;
+    pool->cancelPage(pageId);
+}
+
+void Java_com_googlecode_tesseract_android_OcrSessionPool_nativeDestroy(JNIEnv *env,
+                                                                       jclass clazz,
+                                                                       jlong nativePool) {
+    auto *pool = (OcrSessionPool *) nativePool;
+    jobject callbackObject = pool->getCallbackObject();
+    // joins the sessions' threads, nothing reports progress after this
+    delete pool;
+    if (callbackObject != nullptr) {
+        env->DeleteGlobalRef(callbackObject);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <malloc.h>
 #include "android/bitmap.h"
 #include "common.h"
@@ -57,6 +58,43 @@ struct native_data_t {
         boxSetGeometry(currentTextBox, x, y, width, height);
     }
 
+    /**
+     * Hands raw image data to Tesseract. Tesseract converts the data into its own Pix
+     * during this call, so the caller only has to keep the data valid (pinned array or
+     * live direct buffer) until this method returns.
+     */
+    void setImageData(const unsigned char *imagedata, int width, int height, int bpp, int bpl) {
+        api.SetImage(imagedata, width, height, bpp, bpl);
+        setTextBoundaries(0, 0, width, height);
+
+        // Nothing has to be kept alive for the new image, so release what an earlier
+        // nativeSetImagePix call left behind.
+        if (data != nullptr)
+            free(data);
+        else if (pix != nullptr)
+            pixDestroy(&pix);
+        data = nullptr;
+        pix = nullptr;
+    }
+
+    /**
+     * Hands a Pix to Tesseract. Tesseract doesn't take ownership of it, so it is kept
+     * until the next image is set or this instance is released.
+     */
+    void setImagePix(PIX *pixd) {
+        if (pixd) {
+            setTextBoundaries(0, 0, pixGetWidth(pixd), pixGetHeight(pixd));
+        }
+        api.SetImage(pixd);
+
+        if (data != nullptr)
+            free(data);
+        else if (pix != nullptr)
+            pixDestroy(&pix);
+        data = nullptr;
+        pix = pixd;
+    }
+
     void initStateVariables(JNIEnv *env, jobject object) {
         cancel_ocr = false;
         cachedObject = env->NewGlobalRef(object);
@@ -250,30 +288,92 @@ void Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetImageBytes(JNIEn
                                                                            jint bpp,
                                                                            jint bpl) {
 
-    jbyte *data_array = env->GetByteArrayElements(data, NULL);
     int count = env->GetArrayLength(data);
-    unsigned char *imagedata = (unsigned char *) malloc(count * sizeof(unsigned char));
+    if (height <= 0 || count < (height - 1) * bpl + width * bpp) {
+        LOGE("image data too small: %d bytes for %d lines of %d bytes", count, height, bpl);
+        return;
+    }
 
-    // This is painfully slow, but necessary because we don't know
-    // how many bits the JVM might be using to represent a byte
-    for (int i = 0; i < count; i++) {
-        imagedata[i] = (unsigned char) data_array[i];
+    // jbyte is a plain 8 bit char on Android, so the array can be handed to Tesseract as is.
+    // No JNI calls are made while the array is pinned.
+    auto *imagedata = (unsigned char *) env->GetPrimitiveArrayCritical(data, NULL);
+    if (imagedata == NULL) {
+        return;
     }
+    native_data_t *nat = (native_data_t *) mNativeData;
+    nat->setImageData(imagedata, (int) width, (int) height, (int) bpp, (int) bpl);
+    env->ReleasePrimitiveArrayCritical(data, imagedata, JNI_ABORT);
+}
 
-    env->ReleaseByteArrayElements(data, data_array, JNI_ABORT);
+jboolean Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetImageBuffer(JNIEnv *env,
+                                                                               jobject thiz,
+                                                                               jlong mNativeData,
+                                                                               jobject buffer,
+                                                                               jint width,
+                                                                               jint height,
+                                                                               jint bpp,
+                                                                               jint bpl) {
+
+    auto *imagedata = (unsigned char *) env->GetDirectBufferAddress(buffer);
+    if (imagedata == nullptr) {
+        LOGE("buffer is not a direct buffer");
+        return JNI_FALSE;
+    }
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (height <= 0 || capacity < (jlong) (height - 1) * bpl + width * bpp) {
+        LOGE("buffer too small: %lld bytes for %d lines of %d bytes", (long long) capacity, height, bpl);
+        return JNI_FALSE;
+    }
 
     native_data_t *nat = (native_data_t *) mNativeData;
-    nat->api.SetImage(imagedata, (int) width, (int) height, (int) bpp, (int) bpl);
+    nat->setImageData(imagedata, (int) width, (int) height, (int) bpp, (int) bpl);
+    return JNI_TRUE;
+}
 
-    // Since Tesseract doesn't take ownership of the memory, we keep a pointer in the native
-    // code struct. We need to free that pointer when we release our instance of Tesseract or
-    // attempt to set a new image using one of the nativeSet* methods.
-    if (nat->data != NULL)
-        free(nat->data);
-    else if (nat->pix != NULL)
-        pixDestroy(&nat->pix);
-    nat->data = imagedata;
-    nat->pix = NULL;
+jboolean Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetImageBitmap(JNIEnv *env,
+                                                                               jobject thiz,
+                                                                               jlong mNativeData,
+                                                                               jobject bitmap) {
+
+    AndroidBitmapInfo info;
+    void *pixels;
+    int ret;
+
+    if ((ret = AndroidBitmap_getInfo(env, bitmap, &info)) < 0) {
+        LOGE("AndroidBitmap_getInfo() failed ! error=%d", ret);
+        return JNI_FALSE;
+    }
+
+    // A_8 bitmaps only hold alpha values, which are not the image content.
+    if (info.format != ANDROID_BITMAP_FORMAT_RGBA_8888) {
+        LOGE("Bitmap format is not RGBA_8888 !");
+        return JNI_FALSE;
+    }
+
+    if ((ret = AndroidBitmap_lockPixels(env, bitmap, &pixels)) < 0) {
+        LOGE("AndroidBitmap_lockPixels() failed ! error=%d", ret);
+        return JNI_FALSE;
+    }
+
+    // Only the rows are copied while the bitmap is locked, the byte order is fixed
+    // afterwards.
+    PIX *pixd = pixCreateNoInit(info.width, info.height, 32);
+    auto *src = (const l_uint8 *) pixels;
+    auto *dst = (l_uint8 *) pixGetData(pixd);
+    l_int32 dstBpl = pixGetWpl(pixd) * 4;
+    for (uint32_t y = 0; y < info.height; y++) {
+        memcpy(dst, src, 4 * info.width);
+        dst += dstBpl;
+        src += info.stride;
+    }
+    AndroidBitmap_unlockPixels(env, bitmap);
+
+    // The bytes of a RGBA_8888 bitmap are in R, G, B, A order, Leptonica keeps each
+    // pixel in a native word with red in the most significant byte.
+    pixEndianByteSwap(pixd);
+    auto *nat = (native_data_t *) mNativeData;
+    nat->setImagePix(pixd);
+    return JNI_TRUE;
 }
 
 void Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetImagePix(JNIEnv *env,
@@ -282,25 +382,9 @@ void Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetImagePix(JNIEnv
                                                                          jlong nativePix) {
 
     PIX *pixs = (PIX *) nativePix;
-    PIX *pixd = pixClone(pixs);
 
     auto *nat = (native_data_t *) mNativeData;
-    if (pixd) {
-        l_int32 width = pixGetWidth(pixd);
-        l_int32 height = pixGetHeight(pixd);
-        nat->setTextBoundaries(0, 0, width, height);
-    }
-    nat->api.SetImage(pixd);
-
-    // Since Tesseract doesn't take ownership of the memory, we keep a pointer in the native
-    // code struct. We need to free that pointer when we release our instance of Tesseract or
-    // attempt to set a new image using one of the nativeSet* methods.
-    if (nat->data != nullptr)
-        free(nat->data);
-    else if (nat->pix != nullptr)
-        pixDestroy(&nat->pix);
-    nat->data = nullptr;
-    nat->pix = pixd;
+    nat->setImagePix(pixClone(pixs));
 }
 
 void Java_com_googlecode_tesseract_android_TessBaseAPI_nativeSetRectangle(JNIEnv *env,
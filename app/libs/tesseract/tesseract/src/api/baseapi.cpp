@@ -88,6 +88,7 @@
 #include "tesseractclass.h"    // for Tesseract
 #include "thresholder.h"       // for ImageThresholder
 #include "tprintf.h"           // for tprintf
+#include "weightmatrix.h"      // for WeightMatrix
 #include "werd.h"              // for WERD, WERD_IT, W_FUZZY_NON, W_FUZZY_SP
 
 static BOOL_VAR(stream_filelist, false, "Stream a filelist from stdin");
@@ -1862,11 +1863,12 @@ void TessBaseAPI::End() {
 
 // Clear any library-level memory caches.
 // There are a variety of expensive-to-load constant data structures (mostly
-// language dictionaries) that are cached globally -- surviving the Init()
-// and End() of individual TessBaseAPI's.  This function allows the clearing
-// of these caches.
+// language dictionaries and LSTM weights) that are cached globally --
+// surviving the Init() and End() of individual TessBaseAPI's.  This function
+// allows the clearing of these caches.
 void TessBaseAPI::ClearPersistentCache() {
   Dict::GlobalDawgCache()->DeleteUnusedDawgs();
+  WeightMatrix::DeleteUnusedIntWeights();
 }
 
 /**
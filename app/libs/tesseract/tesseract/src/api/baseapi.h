@@ -697,9 +697,9 @@ class TESS_API TessBaseAPI {
   /**
    * Clear any library-level memory caches.
    * There are a variety of expensive-to-load constant data structures (mostly
-   * language dictionaries) that are cached globally -- surviving the Init()
-   * and End() of individual TessBaseAPI's.  This function allows the clearing
-   * of these caches.
+   * language dictionaries and LSTM weights) that are cached globally --
+   * surviving the Init() and End() of individual TessBaseAPI's.  This function
+   * allows the clearing of these caches.
    **/
   static void ClearPersistentCache();
 
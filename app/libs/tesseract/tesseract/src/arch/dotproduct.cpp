@@ -25,4 +25,11 @@ double DotProductNative(const double* u, const double* v, int n) {
   return total;
 }
 
+// Computes and returns the dot product of the two n-vectors u and v.
+float DotProductFloatNative(const float* u, const float* v, int n) {
+  float total = 0.0f;
+  for (int k = 0; k < n; ++k) total += u[k] * v[k];
+  return total;
+}
+
 }  // namespace tesseract
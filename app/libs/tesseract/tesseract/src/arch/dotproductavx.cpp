@@ -57,4 +57,35 @@ double DotProductAVX(const double* u, const double* v, int n) {
   return result;
 }
 
+// As DotProductAVX, but for float vectors, 8 values to a register.
+float DotProductFloatAVX(const float* u, const float* v, int n) {
+  const unsigned quot = n / 16;
+  const unsigned rem = n % 16;
+  __m256 t0 = _mm256_setzero_ps();
+  __m256 t1 = _mm256_setzero_ps();
+  for (unsigned k = 0; k < quot; k++) {
+    __m256 f0 = _mm256_loadu_ps(u);
+    __m256 f1 = _mm256_loadu_ps(v);
+    f0 = _mm256_mul_ps(f0, f1);
+    t0 = _mm256_add_ps(t0, f0);
+    u += 8;
+    v += 8;
+    __m256 f2 = _mm256_loadu_ps(u);
+    __m256 f3 = _mm256_loadu_ps(v);
+    f2 = _mm256_mul_ps(f2, f3);
+    t1 = _mm256_add_ps(t1, f2);
+    u += 8;
+    v += 8;
+  }
+  t0 = _mm256_add_ps(t0, t1);
+  alignas(32) float tmp[8];
+  _mm256_store_ps(tmp, t0);
+  float result = ((tmp[0] + tmp[1]) + (tmp[2] + tmp[3])) +
+                 ((tmp[4] + tmp[5]) + (tmp[6] + tmp[7]));
+  for (unsigned k = 0; k < rem; k++) {
+    result += *u++ * *v++;
+  }
+  return result;
+}
+
 }  // namespace tesseract.
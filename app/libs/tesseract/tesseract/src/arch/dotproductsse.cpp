@@ -78,4 +78,27 @@ double DotProductSSE(const double* u, const double* v, int n) {
   return result;
 }
 
+// As DotProductSSE, but for float vectors, 4 values to a register.
+float DotProductFloatSSE(const float* u, const float* v, int n) {
+  int max_offset = n - 4;
+  int offset = 0;
+  __m128 sum = _mm_setzero_ps();
+  while (offset <= max_offset) {
+    __m128 floats1 = _mm_loadu_ps(u + offset);
+    __m128 floats2 = _mm_loadu_ps(v + offset);
+    offset += 4;
+    sum = _mm_add_ps(sum, _mm_mul_ps(floats1, floats2));
+  }
+  // Add the 4 sums in sum horizontally.
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  float result = _mm_cvtss_f32(sum);
+  // Add on any left-over products.
+  while (offset < n) {
+    result += u[offset] * v[offset];
+    ++offset;
+  }
+  return result;
+}
+
 }  // namespace tesseract.
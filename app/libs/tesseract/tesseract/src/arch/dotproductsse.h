@@ -23,6 +23,7 @@ namespace tesseract {
 // Computes and returns the dot product of the n-vectors u and v.
 // Uses Intel SSE intrinsics to access the SIMD instruction set.
 double DotProductSSE(const double* u, const double* v, int n);
+float DotProductFloatSSE(const float* u, const float* v, int n);
 
 }  // namespace tesseract.
 
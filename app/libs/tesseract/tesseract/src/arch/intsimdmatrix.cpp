@@ -91,4 +91,23 @@ void IntSimdMatrix::MatrixDotVector(const GENERIC_2D_ARRAY<int8_t>& w,
   }
 }
 
+// As MatrixDotVector, but for num_vectors inputs at once.
+void IntSimdMatrix::MatrixDotVectors(const GENERIC_2D_ARRAY<int8_t>& w,
+                                     const GenericVector<double>& scales,
+                                     int num_vectors, const int8_t* const* u,
+                                     double* const* v) {
+  int num_out = w.dim1();
+  int num_in = w.dim2() - 1;
+  for (int i = 0; i < num_out; ++i) {
+    const int8_t* wi = w[i];
+    for (int k = 0; k < num_vectors; ++k) {
+      const int8_t* uk = u[k];
+      int total = 0;
+      for (int j = 0; j < num_in; ++j) total += wi[j] * uk[j];
+      v[k][i] = (static_cast<double>(total) / INT8_MAX + wi[num_in]) *
+                scales[i];
+    }
+  }
+}
+
 }  // namespace tesseract
@@ -82,6 +82,12 @@ struct IntSimdMatrix {
   static void MatrixDotVector(const GENERIC_2D_ARRAY<int8_t>& w,
                               const GenericVector<double>& scales,
                               const int8_t* u, double* v);
+  // As MatrixDotVector, but for num_vectors inputs u[k] giving v[k], reading
+  // each row of w once for all of them.
+  static void MatrixDotVectors(const GENERIC_2D_ARRAY<int8_t>& w,
+                               const GenericVector<double>& scales,
+                               int num_vectors, const int8_t* const* u,
+                               double* const* v);
 
   // Rounds the input up to a multiple of the given factor.
   static int Roundup(int input, int factor) {
@@ -116,6 +122,7 @@ struct IntSimdMatrix {
   static const IntSimdMatrix* intSimdMatrix;
   static const IntSimdMatrix intSimdMatrixAVX2;
   static const IntSimdMatrix intSimdMatrixSSE;
+  static const IntSimdMatrix intSimdMatrixNEON;
 };
 
 }  // namespace tesseract
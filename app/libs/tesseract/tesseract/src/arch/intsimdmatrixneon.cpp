@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////
+// File:        intsimdmatrixneon.cpp
+// Description: NEON implementation of 8-bit int SIMD matrix multiply.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+// The Android build compiles every file in this directory for every ABI, so
+// the implementation is only provided when NEON is enabled by the compiler.
+#if defined(__ARM_NEON)
+
+#include "intsimdmatrix.h"
+
+#include <arm_neon.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace tesseract {
+
+// Number of outputs held in each "register". The 8 results are actually
+// accumulated in 8 separate int32x4_t registers, one per output, and reduced
+// horizontally at the end.
+constexpr int kNumOutputsPerRegister = 8;
+// Maximum number of registers that we will use.
+constexpr int kMaxOutputRegisters = 1;
+// Number of inputs in the inputs register.
+constexpr int kNumInputsPerRegister = 8;
+// Number of inputs in each weight group.
+constexpr int kNumInputsPerGroup = 8;
+
+// Adds the 4 32-bit lanes of v together.
+static inline int32_t HorizontalSum(int32x4_t v) {
+#if defined(__aarch64__)
+  return vaddvq_s32(v);
+#else
+  int32x2_t sum = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+  sum = vpadd_s32(sum, sum);
+  return vget_lane_s32(sum, 0);
+#endif
+}
+
+// Computes one set of 8x8 products of inputs and weights for a single output,
+// adding to result.
+// Multiplies 8x8-bit inputs by 8x8-bit weights to make 8x16-bit results,
+// which are then added in adjacent pairs to the 4x32-bit result.
+// Note: wi is incremented by the amount of data read.
+static inline void MultiplyGroup(const int8x8_t& inputs, const int8_t*& wi,
+                                 int32x4_t& result) {
+  int8x8_t weights = vld1_s8(wi);
+  wi += kNumInputsPerGroup;
+  // |int8 * int8| <= 128 * 128, which fits in an int16.
+  result = vpadalq_s16(result, vmull_s8(weights, inputs));
+}
+
+// Extracts and converts the 8 results, adding the bias from wi and scaling by
+// scales, before storing in *v. Note that wi, scales and v are expected to
+// contain 8 consecutive elements, but only num_out of them are written.
+static inline void ExtractResults(const int32x4_t* results, const int8_t* wi,
+                                  const double* scales, int num_out,
+                                  double* v) {
+  for (int out = 0; out < num_out; ++out) {
+    double res = HorizontalSum(results[out]);
+    v[out] = (res / INT8_MAX + wi[out]) * scales[out];
+  }
+}
+
+// Computes part of matrix.vector v = Wu. Computes N=8 results.
+// The weights *must* be arranged so that consecutive reads from wi
+// provides (num_in/kNumInputsPerGroup groups of (N output dim groups of
+// (kNumInputsPerGroup inputs))). After that there must be N consecutive
+// bias weights, before continuing with any more weights.
+// u must be padded out with zeros to
+// kNumInputsPerGroup*ceil(num_in/kNumInputsPerGroup) elements.
+static void PartialMatrixDotVector8(const int8_t* wi, const double* scales,
+                                    const int8_t* u, int num_in, int num_out,
+                                    double* v) {
+  // Initialize all the results to 0.
+  int32x4_t results[kNumOutputsPerRegister];
+  for (int i = 0; i < kNumOutputsPerRegister; ++i) {
+    results[i] = vdupq_n_s32(0);
+  }
+  // Iterate over the input (u), one registerful at a time.
+  for (int j = 0; j < num_in; j += kNumInputsPerRegister) {
+    int8x8_t inputs = vld1_s8(u + j);
+    MultiplyGroup(inputs, wi, results[0]);
+    MultiplyGroup(inputs, wi, results[1]);
+    MultiplyGroup(inputs, wi, results[2]);
+    MultiplyGroup(inputs, wi, results[3]);
+    MultiplyGroup(inputs, wi, results[4]);
+    MultiplyGroup(inputs, wi, results[5]);
+    MultiplyGroup(inputs, wi, results[6]);
+    MultiplyGroup(inputs, wi, results[7]);
+  }
+  ExtractResults(results, wi, scales,
+                 std::min(kNumOutputsPerRegister, num_out), v);
+}
+
+static void matrixDotVector(int dim1, int dim2, const int8_t* wi,
+                            const double* scales, const int8_t* u, double* v) {
+  const int num_out = dim1;
+  const int num_in = dim2 - 1;
+  // Each call to a partial_func_ produces group_size outputs, except the
+  // last one, which can produce less.
+  const int rounded_num_in =
+    IntSimdMatrix::Roundup(num_in, kNumInputsPerGroup);
+  const int rounded_num_out =
+    IntSimdMatrix::Roundup(num_out, kNumOutputsPerRegister);
+  const int group_size = kNumOutputsPerRegister * kMaxOutputRegisters;
+  const int w_step = (rounded_num_in + 1) * group_size;
+
+  for (int output = 0; output + group_size <= rounded_num_out;
+       output += group_size) {
+    PartialMatrixDotVector8(wi, scales, u, rounded_num_in, num_out - output, v);
+    wi += w_step;
+    scales += group_size;
+    v += group_size;
+  }
+}
+
+const IntSimdMatrix IntSimdMatrix::intSimdMatrixNEON = {
+  // Function.
+  matrixDotVector,
+  // Number of 32 bit outputs held in each register.
+  kNumOutputsPerRegister,
+  // Maximum number of registers that we will use to hold outputs.
+  kMaxOutputRegisters,
+  // Number of 8 bit inputs in the inputs register.
+  kNumInputsPerRegister,
+  // Number of inputs in each weight group.
+  kNumInputsPerGroup
+};
+
+}  // namespace tesseract.
+
+#endif  // __ARM_NEON
@@ -19,6 +19,7 @@
 #include "simddetect.h"
 #include "dotproduct.h"
 #include "dotproductavx.h"
+#include "dotproductneon.h"
 #include "dotproductsse.h"
 #include "intsimdmatrix.h"   // for IntSimdMatrix
 #include "params.h"   // for STRING_VAR
@@ -49,6 +50,8 @@ namespace tesseract {
 // bandwidth constrained and could benefit from holding the reused vector
 // in AVX registers.
 DotProductFunction DotProduct;
+// The float equivalent, used for single precision inference.
+DotProductFloatFunction DotProductFloat;
 
 static STRING_VAR(dotproduct, "auto",
                   "Function used for calculation of dot product");
@@ -62,6 +65,8 @@ bool SIMDDetect::avx512F_available_;
 bool SIMDDetect::avx512BW_available_;
 // If true, then SSe4.1 has been detected.
 bool SIMDDetect::sse_available_;
+// If true, then NEON has been detected.
+bool SIMDDetect::neon_available_;
 
 // Computes and returns the dot product of the two n-vectors u and v.
 static double DotProductGeneric(const double* u, const double* v, int n) {
@@ -70,13 +75,35 @@ static double DotProductGeneric(const double* u, const double* v, int n) {
   return total;
 }
 
+static float DotProductFloatGeneric(const float* u, const float* v, int n) {
+  float total = 0.0f;
+  for (int k = 0; k < n; ++k) total += u[k] * v[k];
+  return total;
+}
+
 // Compute dot product using std::inner_product.
 static double DotProductStdInnerProduct(const double* u, const double* v, int n) {
   return std::inner_product(u, u + n, v, 0.0);
 }
+static float DotProductFloatStdInnerProduct(const float* u, const float* v,
+                                            int n) {
+  return std::inner_product(u, u + n, v, 0.0f);
+}
+
+#if defined(__ARM_NEON)
+// NEON has double precision lanes only on AArch64. 32 bit ARM still gets the
+// NEON int8 matrix multiply, but uses the native double dot product.
+#if defined(__aarch64__)
+static const DotProductFunction DotProductNEONOrNative = DotProductNEON;
+#else
+static const DotProductFunction DotProductNEONOrNative = DotProductNative;
+#endif
+#endif
 
-static void SetDotProduct(DotProductFunction f, const IntSimdMatrix* m = nullptr) {
+static void SetDotProduct(DotProductFunction f, DotProductFloatFunction ff,
+                          const IntSimdMatrix* m = nullptr) {
   DotProduct = f;
+  DotProductFloat = ff;
   IntSimdMatrix::intSimdMatrix = m;
 }
 
@@ -87,7 +114,7 @@ static void SetDotProduct(DotProductFunction f, const IntSimdMatrix* m = nullptr
 // clang.
 SIMDDetect::SIMDDetect() {
   // The fallback is a generic dot product calculation.
-  SetDotProduct(DotProductGeneric);
+  SetDotProduct(DotProductGeneric, DotProductFloatGeneric);
 
 #if defined(HAS_CPUID)
 #if defined(__GNUC__)
@@ -138,23 +165,38 @@ SIMDDetect::SIMDDetect() {
 #endif
 #endif
 
+#if defined(__ARM_NEON)
+  // NEON is mandatory on AArch64, and the armeabi-v7a build is compiled with
+  // NEON enabled, so the compiler flag is sufficient here.
+  neon_available_ = true;
+#endif
+
   // Select code for calculation of dot product based on autodetection.
   if (false) {
     // This is a dummy to support conditional compilation.
 #if defined(AVX2)
   } else if (avx2_available_) {
     // AVX2 detected.
-    SetDotProduct(DotProductAVX, &IntSimdMatrix::intSimdMatrixAVX2);
+    SetDotProduct(DotProductAVX, DotProductFloatAVX,
+                  &IntSimdMatrix::intSimdMatrixAVX2);
 #endif
 #if defined(AVX)
   } else if (avx_available_) {
     // AVX detected.
-    SetDotProduct(DotProductAVX, &IntSimdMatrix::intSimdMatrixSSE);
+    SetDotProduct(DotProductAVX, DotProductFloatAVX,
+                  &IntSimdMatrix::intSimdMatrixSSE);
 #endif
 #if defined(SSE4_1)
   } else if (sse_available_) {
     // SSE detected.
-    SetDotProduct(DotProductSSE, &IntSimdMatrix::intSimdMatrixSSE);
+    SetDotProduct(DotProductSSE, DotProductFloatSSE,
+                  &IntSimdMatrix::intSimdMatrixSSE);
+#endif
+#if defined(__ARM_NEON)
+  } else if (neon_available_) {
+    // NEON detected.
+    SetDotProduct(DotProductNEONOrNative, DotProductFloatNEON,
+                  &IntSimdMatrix::intSimdMatrixNEON);
 #endif
   }
 }
@@ -167,33 +209,43 @@ void SIMDDetect::Update() {
     // Automatic detection. Nothing to be done.
   } else if (!strcmp(dotproduct.string(), "generic")) {
     // Generic code selected by config variable.
-    SetDotProduct(DotProductGeneric);
+    SetDotProduct(DotProductGeneric, DotProductFloatGeneric);
     dotproduct_method = "generic";
   } else if (!strcmp(dotproduct.string(), "native")) {
     // Native optimized code selected by config variable.
-    SetDotProduct(DotProductNative);
+    SetDotProduct(DotProductNative, DotProductFloatNative);
     dotproduct_method = "native";
 #if defined(AVX2)
   } else if (!strcmp(dotproduct.string(), "avx2")) {
     // AVX2 selected by config variable.
-    SetDotProduct(DotProductAVX, &IntSimdMatrix::intSimdMatrixAVX2);
+    SetDotProduct(DotProductAVX, DotProductFloatAVX,
+                  &IntSimdMatrix::intSimdMatrixAVX2);
     dotproduct_method = "avx2";
 #endif
 #if defined(AVX)
   } else if (!strcmp(dotproduct.string(), "avx")) {
     // AVX selected by config variable.
-    SetDotProduct(DotProductAVX, &IntSimdMatrix::intSimdMatrixSSE);
+    SetDotProduct(DotProductAVX, DotProductFloatAVX,
+                  &IntSimdMatrix::intSimdMatrixSSE);
     dotproduct_method = "avx";
 #endif
 #if defined(SSE4_1)
   } else if (!strcmp(dotproduct.string(), "sse")) {
     // SSE selected by config variable.
-    SetDotProduct(DotProductSSE, &IntSimdMatrix::intSimdMatrixSSE);
+    SetDotProduct(DotProductSSE, DotProductFloatSSE,
+                  &IntSimdMatrix::intSimdMatrixSSE);
     dotproduct_method = "sse";
+#endif
+#if defined(__ARM_NEON)
+  } else if (!strcmp(dotproduct.string(), "neon")) {
+    // NEON selected by config variable.
+    SetDotProduct(DotProductNEONOrNative, DotProductFloatNEON,
+                  &IntSimdMatrix::intSimdMatrixNEON);
+    dotproduct_method = "neon";
 #endif
   } else if (!strcmp(dotproduct.string(), "std::inner_product")) {
     // std::inner_product selected by config variable.
-    SetDotProduct(DotProductStdInnerProduct);
+    SetDotProduct(DotProductStdInnerProduct, DotProductFloatStdInnerProduct);
     dotproduct_method = "std::inner_product";
   } else {
     // Unsupported value of config variable.
@@ -205,6 +257,9 @@ void SIMDDetect::Update() {
 #endif
 #if defined(SSE4_1)
             " sse"
+#endif
+#if defined(__ARM_NEON)
+            " neon"
 #endif
             " std::inner_product.\n");
   }
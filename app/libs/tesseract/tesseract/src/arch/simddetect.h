@@ -24,6 +24,9 @@ namespace tesseract {
 // Function pointer for best calculation of dot product.
 using DotProductFunction = double (*)(const double*, const double*, int);
 extern DotProductFunction DotProduct;
+// As DotProduct, but for float vectors.
+using DotProductFloatFunction = float (*)(const float*, const float*, int);
+extern DotProductFloatFunction DotProductFloat;
 
 // Architecture detector. Add code here to detect any other architectures for
 // SIMD-based faster dot product functions. Intended to be a single static
@@ -50,6 +53,10 @@ class SIMDDetect {
   static inline bool IsSSEAvailable() {
     return detector.sse_available_;
   }
+  // Returns true if NEON is available on this system.
+  static inline bool IsNEONAvailable() {
+    return detector.neon_available_;
+  }
 
   // Update settings after config variable was set.
   static TESS_API void Update();
@@ -68,6 +75,8 @@ class SIMDDetect {
   static TESS_API bool avx512BW_available_;
   // If true, then SSe4.1 has been detected.
   static TESS_API bool sse_available_;
+  // If true, then NEON has been detected.
+  static TESS_API bool neon_available_;
 };
 
 }  // namespace tesseract
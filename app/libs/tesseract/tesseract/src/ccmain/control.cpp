@@ -26,6 +26,8 @@
 #include <cstdio>                // for fclose, fopen, FILE
 #include <ctime>                 // for clock
 #include <cctype>
+#include <algorithm>             // for std::min
+#include <thread>                // for std::thread
 #include "callcpp.h"
 #include "control.h"
 #ifndef DISABLED_LEGACY_ENGINE
@@ -218,6 +220,23 @@ bool Tesseract::RecogAllWordsPassN(int pass_n, ETEXT_DESC* monitor,
   // (eg set_pass1 and set_pass2) and an intermediate adaption pass needs to be
   // added. The results will be significantly different with adaption on, and
   // deterioration will need investigation.
+  // With only LSTM there is no such state, so the network is run on batches
+  // of lines in parallel ahead of the loop, leaving just the decoding of each
+  // line to the loop. Each round gives every thread a single batch, so the
+  // progress is updated every few lines, and the monitor is also asked to
+  // cancel between batches within a round.
+  // Even on a single thread, running several lines through the network
+  // together makes better use of the weights.
+  int lstm_threads = 0;
+  if (tessedit_parallelize && pass_n == 1 && lstm_recognizer_ != nullptr &&
+      tessedit_ocr_engine_mode == OEM_LSTM_ONLY && sub_langs_.empty() &&
+      classify_debug_level == 0) {
+    lstm_threads = tessedit_parallelize > 1
+                       ? tessedit_parallelize
+                       : std::max(1U, std::thread::hardware_concurrency());
+  }
+  PointerVector<LSTMLineOutputs> lstm_lines;
+  int lstm_lines_end = 0;
   pr_it->restart_page();
   for (int w = 0; w < words->size(); ++w) {
     WordData* word = &(*words)[w];
@@ -247,6 +266,18 @@ bool Tesseract::RecogAllWordsPassN(int pass_n, ETEXT_DESC* monitor,
         return false;
       }
     }
+    if (lstm_threads > 0 && w == lstm_lines_end) {
+      lstm_lines.clear();
+      lstm_lines_end =
+          std::min(w + kLSTMLinesInBatch * lstm_threads, words->size());
+      if (!PrerecLSTMLinesPar(w, lstm_lines_end, lstm_threads, monitor, words,
+                              &lstm_lines)) {
+        for (; w < words->size(); ++w) {
+          (*words)[w].word->SetupFake(unicharset);
+        }
+        return false;
+      }
+    }
     if (word->word->tess_failed) {
       int s;
       for (s = 0; s < word->lang_words.size() &&
@@ -266,6 +297,7 @@ bool Tesseract::RecogAllWordsPassN(int pass_n, ETEXT_DESC* monitor,
     }
 
     classify_word_and_language(pass_n, pr_it, word);
+    word->lstm_line = nullptr;
     if (tessedit_dump_choices || debug_noise_removal) {
       tprintf("Pass%d: %s [%s]\n", pass_n,
               word->word->best_choice->unichar_string().string(),
@@ -342,7 +374,7 @@ bool Tesseract::recog_all_words(PAGE_RES* page_res,
     GenericVector<WordData> words;
     SetupAllWordsPassN(1, target_word_box, word_config, page_res, &words);
     #ifndef DISABLED_LEGACY_ENGINE
-    if (tessedit_parallelize) {
+    if (tessedit_parallelize && AnyTessLang()) {
       PrerecAllWordsPar(words);
     }
     #endif  // ndef DISABLED_LEGACY_ENGINE
@@ -1427,7 +1459,8 @@ void Tesseract::classify_word_pass1(const WordData& word_data,
       tessedit_ocr_engine_mode == OEM_TESSERACT_LSTM_COMBINED) {
 #endif  // def DISABLED_LEGACY_ENGINE
     if (!(*in_word)->odd_size || tessedit_ocr_engine_mode == OEM_LSTM_ONLY) {
-      LSTMRecognizeWord(*block, row, *in_word, out_words);
+      LSTMRecognizeWord(*block, row, *in_word, out_words,
+                        word_data.lstm_line);
       if (!out_words->empty())
         return;  // Successful lstm recognition.
     }
@@ -217,10 +217,11 @@ ImageData* Tesseract::GetRectImage(const TBOX& box, const BLOCK& block,
 }
 
 #ifndef ANDROID_BUILD
-// Recognizes a word or group of words, converting to WERD_RES in *words.
-// Analogous to classify_word_pass1, but can handle a group of words as well.
-void Tesseract::LSTMRecognizeWord(const BLOCK& block, ROW *row, WERD_RES *word,
-                                  PointerVector<WERD_RES>* words) {
+// Helper gets the image that LSTMRecognizeWord runs the network on, and the
+// box of it in line_box.
+ImageData* Tesseract::GetLSTMWordImage(const BLOCK& block, const ROW* row,
+                                       const WERD_RES* word,
+                                       TBOX* line_box) const {
   TBOX word_box = word->word->bounding_box();
   // Get the word image - no frills.
   if (tessedit_pageseg_mode == PSM_SINGLE_WORD ||
@@ -235,12 +236,29 @@ void Tesseract::LSTMRecognizeWord(const BLOCK& block, ROW *row, WERD_RES *word,
     if (baseline + row->x_height() + row->ascenders() > word_box.top())
       word_box.set_top(baseline + row->x_height() + row->ascenders());
   }
-  ImageData* im_data = GetRectImage(word_box, block, kImagePadding, &word_box);
-  if (im_data == nullptr) return;
-  lstm_recognizer_->RecognizeLine(*im_data, true, classify_debug_level > 0,
-                                  kWorstDictCertainty / kCertaintyScale,
-                                  word_box, words, lstm_choice_mode);
-  delete im_data;
+  return GetRectImage(word_box, block, kImagePadding, line_box);
+}
+
+// Recognizes a word or group of words, converting to WERD_RES in *words.
+// Analogous to classify_word_pass1, but can handle a group of words as well.
+void Tesseract::LSTMRecognizeWord(const BLOCK& block, ROW *row, WERD_RES *word,
+                                  PointerVector<WERD_RES>* words,
+                                  const LSTMLineOutputs* line) {
+  if (line != nullptr) {
+    if (!line->valid) return;
+    lstm_recognizer_->DecodeLine(line->outputs, line->scale_factor,
+                                 classify_debug_level > 0,
+                                 kWorstDictCertainty / kCertaintyScale,
+                                 line->line_box, words, lstm_choice_mode);
+  } else {
+    TBOX word_box;
+    ImageData* im_data = GetLSTMWordImage(block, row, word, &word_box);
+    if (im_data == nullptr) return;
+    lstm_recognizer_->RecognizeLine(*im_data, true, classify_debug_level > 0,
+                                    kWorstDictCertainty / kCertaintyScale,
+                                    word_box, words, lstm_choice_mode);
+    delete im_data;
+  }
   SearchWords(words);
 }
 
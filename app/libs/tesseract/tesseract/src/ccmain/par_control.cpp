@@ -18,6 +18,13 @@
 ///////////////////////////////////////////////////////////////////////
 
 #include "tesseractclass.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "imagedata.h"
+#include "lstmrecognizer.h"
+#include "ocrclass.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif  // _OPENMP
@@ -69,4 +76,79 @@ void Tesseract::PrerecAllWordsPar(const GenericVector<WordData>& words) {
   }
 }
 
+// The network is run with a NetworkScratch and TRand per thread, seeded the
+// same way as LSTMRecognizer::RecognizeLine does for each line, so the outputs
+// are the same as running the lines one by one. OpenMP is not used as it is
+// not available on all builds. Only the calling thread asks the monitor
+// whether to stop, the others see it through stopped.
+bool Tesseract::PrerecLSTMLinesPar(int start, int end, int num_threads,
+                                   ETEXT_DESC* monitor,
+                                   GenericVector<WordData>* words,
+                                   PointerVector<LSTMLineOutputs>* lines) {
+  // Get the images of all the lines that need recognizing.
+  std::vector<LSTMLineOutputs*> line_outputs;
+  std::vector<ImageData*> images;
+  for (int w = start; w < end; ++w) {
+    WordData* word = &(*words)[w];
+    if (word->word->done) continue;
+    lines->push_back(new LSTMLineOutputs);
+    word->lstm_line = lines->back();
+    ImageData* im_data = GetLSTMWordImage(*word->block, word->row, word->word,
+                                          &lines->back()->line_box);
+    if (im_data == nullptr) continue;
+    line_outputs.push_back(lines->back());
+    images.push_back(im_data);
+  }
+  if (images.empty()) return true;
+  // Put lines of similar width in the same batch, so the batch is not mostly
+  // padding. The network scales each line to a fixed height, so the width
+  // it sees depends on the aspect ratio of the line box.
+  std::vector<int> order(images.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    const TBOX& box_a = line_outputs[a]->line_box;
+    const TBOX& box_b = line_outputs[b]->line_box;
+    return static_cast<int64_t>(box_a.width()) * box_b.height() <
+           static_cast<int64_t>(box_b.width()) * box_a.height();
+  });
+  int num_batches = (order.size() + kLSTMLinesInBatch - 1) / kLSTMLinesInBatch;
+  std::atomic<int> next_batch(0);
+  std::atomic<bool> stopped(false);
+  auto run_batches = [&](bool check_monitor) {
+    NetworkScratch scratch;
+    scratch.set_int_mode(lstm_recognizer_->IsIntMode());
+    std::vector<TRand> randomizers(kLSTMLinesInBatch);
+    for (int b = next_batch++; b < num_batches; b = next_batch++) {
+      if (check_monitor && monitor != nullptr &&
+          (monitor->deadline_exceeded() ||
+           (monitor->cancel != nullptr &&
+            (*monitor->cancel)(monitor->cancel_this, words->size())))) {
+        stopped = true;
+      }
+      if (stopped) break;
+      std::vector<const ImageData*> batch_images;
+      std::vector<TRand*> batch_randomizers;
+      std::vector<LSTMLineOutputs*> batch_lines;
+      int batch_end = std::min((b + 1) * kLSTMLinesInBatch,
+                               static_cast<int>(order.size()));
+      for (int i = b * kLSTMLinesInBatch; i < batch_end; ++i) {
+        batch_images.push_back(images[order[i]]);
+        batch_randomizers.push_back(&randomizers[batch_images.size() - 1]);
+        batch_lines.push_back(line_outputs[order[i]]);
+      }
+      lstm_recognizer_->RecognizeLines(batch_images, batch_randomizers,
+                                       &scratch, batch_lines);
+    }
+  };
+  num_threads = std::min(num_threads, num_batches);
+  std::vector<std::thread> threads;
+  for (int t = 1; t < num_threads; ++t) {
+    threads.emplace_back(run_batches, false);
+  }
+  run_batches(true);
+  for (auto& thread : threads) thread.join();
+  for (auto* image : images) delete image;
+  return !stopped;
+}
+
 }  // namespace tesseract.
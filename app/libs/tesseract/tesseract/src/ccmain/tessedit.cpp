@@ -179,6 +179,8 @@ bool Tesseract::init_tesseract_lang_data(
       lstm_recognizer_ = new LSTMRecognizer;
       ASSERT_HOST(lstm_recognizer_->Load(
           this->params(), lstm_use_matrix ? language : nullptr, mgr));
+      // Int models are unaffected. Only training needs the doubles.
+      if (lstm_float_inference) lstm_recognizer_->ConvertToFloat();
     } else {
       tprintf("Error: LSTM requested, but not present!! Loading tesseract.\n");
       tessedit_ocr_engine_mode.set_value(OEM_TESSERACT_ONLY);
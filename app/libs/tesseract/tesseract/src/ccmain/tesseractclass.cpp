@@ -223,6 +223,9 @@ Tesseract::Tesseract()
                   this->params()),
       BOOL_MEMBER(lstm_use_matrix, 1,
                   "Use ratings matrix/beam search with lstm", this->params()),
+      BOOL_MEMBER(lstm_float_inference, true,
+                  "Run double precision lstm models in single precision",
+                  this->params()),
       STRING_MEMBER(outlines_odd, "%| ", "Non standard number of outlines",
                     this->params()),
       STRING_MEMBER(outlines_2, "ij!?%\":;", "Non standard number of outlines",
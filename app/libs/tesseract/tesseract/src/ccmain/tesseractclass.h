@@ -108,6 +108,7 @@ class DocumentData;
 class EquationDetect;
 class ImageData;
 class LSTMRecognizer;
+struct LSTMLineOutputs;
 class Tesseract;
 
 // A collection of various variables for statistics and debugging.
@@ -145,20 +146,26 @@ struct TesseractStats {
 // Struct to hold all the pointers to relevant data for processing a word.
 struct WordData {
   WordData()
-      : word(nullptr), row(nullptr), block(nullptr), prev_word(nullptr) {}
+      : word(nullptr), row(nullptr), block(nullptr), prev_word(nullptr),
+        lstm_line(nullptr) {}
   explicit WordData(const PAGE_RES_IT& page_res_it)
       : word(page_res_it.word()),
         row(page_res_it.row()->row),
         block(page_res_it.block()->block),
-        prev_word(nullptr) {}
+        prev_word(nullptr),
+        lstm_line(nullptr) {}
   WordData(BLOCK* block_in, ROW* row_in, WERD_RES* word_res)
-      : word(word_res), row(row_in), block(block_in), prev_word(nullptr) {}
+      : word(word_res), row(row_in), block(block_in), prev_word(nullptr),
+        lstm_line(nullptr) {}
 
   WERD_RES* word;
   ROW* row;
   BLOCK* block;
   WordData* prev_word;
   PointerVector<WERD_RES> lang_words;
+  // Network outputs computed ahead by PrerecLSTMLinesPar, if not nullptr.
+  // Not owned.
+  const LSTMLineOutputs* lstm_line;
 };
 
 // Definition of a Tesseract WordRecognizer. The WordData provides the context
@@ -331,6 +338,16 @@ class Tesseract : public Wordrec {
       Pix** music_mask_pix);
   // par_control.cpp
   void PrerecAllWordsPar(const GenericVector<WordData>& words);
+  // Runs the LSTM network on the words [start, end) on num_threads threads,
+  // putting the outputs in lines and pointing the lstm_line of each word at
+  // them, so LSTMRecognizeWord only has to decode them. Words that are
+  // already done are left alone. Returns false if the monitor timed out or
+  // cancelled between two batches, leaving the remaining lines without
+  // outputs.
+  bool PrerecLSTMLinesPar(int start, int end, int num_threads,
+                          ETEXT_DESC* monitor,
+                          GenericVector<WordData>* words,
+                          PointerVector<LSTMLineOutputs>* lines);
 
   //// linerec.cpp
   // Generates training data for training a line recognizer, eg LSTM.
@@ -360,10 +377,17 @@ class Tesseract : public Wordrec {
   // is also returned to enable calculation of output bounding boxes.
   ImageData* GetRectImage(const TBOX& box, const BLOCK& block, int padding,
                           TBOX* revised_box) const;
+  // Helper gets the image that LSTMRecognizeWord runs the network on, and
+  // the box of it in line_box.
+  ImageData* GetLSTMWordImage(const BLOCK& block, const ROW* row,
+                              const WERD_RES* word, TBOX* line_box) const;
   // Recognizes a word or group of words, converting to WERD_RES in *words.
   // Analogous to classify_word_pass1, but can handle a group of words as well.
+  // If line is not nullptr, it holds the outputs of the network on the word,
+  // which are decoded without running the network again.
   void LSTMRecognizeWord(const BLOCK& block, ROW* row, WERD_RES* word,
-                         PointerVector<WERD_RES>* words);
+                         PointerVector<WERD_RES>* words,
+                         const LSTMLineOutputs* line = nullptr);
   // Apply segmentation search to the given set of words, within the constraints
   // of the existing ratings matrix. If there is already a best_choice on a word
   // leaves it untouched and just sets the done/accepted etc flags.
@@ -897,6 +921,8 @@ class Tesseract : public Wordrec {
              "Run paragraph detection on the post-text-recognition "
              "(more accurate)");
   BOOL_VAR_H(lstm_use_matrix, 1, "Use ratings matrix/beam searct with lstm");
+  BOOL_VAR_H(lstm_float_inference, true,
+             "Run double precision lstm models in single precision");
   STRING_VAR_H(outlines_odd, "%| ", "Non standard number of outlines");
   STRING_VAR_H(outlines_2, "ij!?%\":;", "Non standard number of outlines");
   BOOL_VAR_H(docqual_excuse_outline_errs, false,
@@ -91,6 +91,8 @@ bool Serialize(FILE* fp, const uint32_t* data, size_t n) {
 TFile::TFile()
     : offset_(0),
       data_(nullptr),
+      external_data_(nullptr),
+      external_size_(0),
       data_is_owned_(false),
       is_writing_(false),
       swap_(false) {}
@@ -194,6 +196,7 @@ bool TFile::Skip(size_t count) {
 }
 
 bool TFile::Open(const STRING& filename, FileReader reader) {
+  external_data_ = nullptr;
   if (!data_is_owned_) {
     data_ = new GenericVector<char>;
     data_is_owned_ = true;
@@ -209,6 +212,7 @@ bool TFile::Open(const STRING& filename, FileReader reader) {
 
 bool TFile::Open(const char* data, int size) {
   offset_ = 0;
+  external_data_ = nullptr;
   if (!data_is_owned_) {
     data_ = new GenericVector<char>;
     data_is_owned_ = true;
@@ -220,8 +224,18 @@ bool TFile::Open(const char* data, int size) {
   return true;
 }
 
+bool TFile::OpenNoCopy(const char* data, int size) {
+  offset_ = 0;
+  external_data_ = data;
+  external_size_ = size;
+  is_writing_ = false;
+  swap_ = false;
+  return true;
+}
+
 bool TFile::Open(FILE* fp, int64_t end_offset) {
   offset_ = 0;
+  external_data_ = nullptr;
   long current_pos = ftell(fp);
   if (current_pos < 0) {
     // ftell failed.
@@ -245,12 +259,20 @@ bool TFile::Open(FILE* fp, int64_t end_offset) {
   return static_cast<int>(fread(&(*data_)[0], 1, size, fp)) == size;
 }
 
+const char* TFile::read_data() const {
+  return external_data_ != nullptr ? external_data_ : &(*data_)[0];
+}
+
+int TFile::read_size() const {
+  return external_data_ != nullptr ? external_size_ : data_->size();
+}
+
 char* TFile::FGets(char* buffer, int buffer_size) {
   ASSERT_HOST(!is_writing_);
   int size = 0;
-  while (size + 1 < buffer_size && offset_ < data_->size()) {
-    buffer[size++] = (*data_)[offset_++];
-    if ((*data_)[offset_ - 1] == '\n') break;
+  while (size + 1 < buffer_size && offset_ < read_size()) {
+    buffer[size++] = read_data()[offset_++];
+    if (read_data()[offset_ - 1] == '\n') break;
   }
   if (size < buffer_size) buffer[size] = '\0';
   return size > 0 ? buffer : nullptr;
@@ -274,15 +296,15 @@ int TFile::FRead(void* buffer, size_t size, int count) {
   size_t required_size;
   if (SIZE_MAX / size <= count) {
     // Avoid integer overflow.
-    required_size = data_->size() - offset_;
+    required_size = read_size() - offset_;
   } else {
     required_size = size * count;
-    if (data_->size() - offset_ < required_size) {
-      required_size = data_->size() - offset_;
+    if (read_size() - offset_ < required_size) {
+      required_size = read_size() - offset_;
     }
   }
   if (required_size > 0 && buffer != nullptr)
-    memcpy(buffer, &(*data_)[offset_], required_size);
+    memcpy(buffer, read_data() + offset_, required_size);
   offset_ += required_size;
   return required_size / size;
 }
@@ -294,6 +316,7 @@ void TFile::Rewind() {
 
 void TFile::OpenWrite(GenericVector<char>* data) {
   offset_ = 0;
+  external_data_ = nullptr;
   if (data != nullptr) {
     if (data_is_owned_) delete data_;
     data_ = data;
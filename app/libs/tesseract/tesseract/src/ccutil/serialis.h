@@ -84,6 +84,10 @@ class TFile {
   bool Open(const STRING& filename, FileReader reader);
   // From an existing memory buffer.
   bool Open(const char* data, int size);
+  // Reads an existing memory buffer in place instead of copying it. The
+  // buffer must stay valid and unchanged until the TFile is reopened or
+  // destroyed.
+  bool OpenNoCopy(const char* data, int size);
   // From an open file and an end offset.
   bool Open(FILE* fp, int64_t end_offset);
   // Sets the value of the swap flag, so that FReadEndian does the right thing.
@@ -145,10 +149,18 @@ class TFile {
   int FWrite(const void* buffer, size_t size, int count);
 
  private:
+  // Returns the bytes being read and their number.
+  const char* read_data() const;
+  int read_size() const;
+
   // The number of bytes used so far.
   int offset_;
   // The buffered data from the file.
   GenericVector<char>* data_;
+  // The buffer given to OpenNoCopy, which is read instead of data_.
+  const char* external_data_;
+  // The size of external_data_.
+  int external_size_;
   // True if the data_ pointer is owned by *this.
   bool data_is_owned_;
   // True if the TFile is open for writing.
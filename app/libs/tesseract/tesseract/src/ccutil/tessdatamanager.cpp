@@ -22,9 +22,17 @@
 
 #include "tessdatamanager.h"
 
+#include <cstdint>
 #include <cstdio>
 #include <string>
 
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined(HAVE_LIBARCHIVE)
 #include <archive.h>
 #include <archive_entry.h>
@@ -73,6 +81,7 @@ bool TessdataManager::LoadArchiveFile(const char *filename) {
           if (TessdataTypeFromFileName(component, &type)) {
             int64_t size = archive_entry_size(ae);
             if (size > 0) {
+              mapped_entries_[type] = nullptr;
               entries_[type].resize_no_init(size);
               if (archive_read_data(a, &entries_[type][0], size) == size) {
                 is_loaded_ = true;
@@ -94,12 +103,37 @@ bool TessdataManager::LoadArchiveFile(const char *filename) {
 }
 #endif
 
+bool TessdataManager::LoadMappedFile(const char *filename) {
+#if defined(_WIN32)
+  return false;
+#else
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  void *data = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size <= INT32_MAX) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (data == MAP_FAILED) return false;
+  size_t size = st.st_size;
+  Clear();
+  mapped_file_.reset(static_cast<const char *>(data), [size](const char *p) {
+    munmap(const_cast<char *>(p), size);
+  });
+  data_file_name_ = filename;
+  return LoadEntries(mapped_file_.get(), static_cast<int>(size), false);
+#endif
+}
+
 bool TessdataManager::Init(const char *data_file_name) {
   GenericVector<char> data;
   if (reader_ == nullptr) {
 #if defined(HAVE_LIBARCHIVE)
     if (LoadArchiveFile(data_file_name)) return true;
 #endif
+    if (LoadMappedFile(data_file_name)) return true;
     if (!LoadDataFromFile(data_file_name, &data)) return false;
   } else {
     if (!(*reader_)(data_file_name, &data)) return false;
@@ -113,8 +147,14 @@ bool TessdataManager::LoadMemBuffer(const char *name, const char *data,
   // TODO: This method supports only the proprietary file format.
   Clear();
   data_file_name_ = name;
+  return LoadEntries(data, size, true);
+}
+
+// Loads the entries from data, copying them into entries_ or, if copy is
+// false, only remembering where they are in data.
+bool TessdataManager::LoadEntries(const char *data, int size, bool copy) {
   TFile fp;
-  fp.Open(data, size);
+  fp.OpenNoCopy(data, size);
   uint32_t num_entries;
   if (!fp.DeSerialize(&num_entries)) return false;
   swap_ = num_entries > kMaxNumTessdataEntries;
@@ -130,11 +170,21 @@ bool TessdataManager::LoadMemBuffer(const char *name, const char *data,
       unsigned j = i + 1;
       while (j < num_entries && offset_table[j] == -1) ++j;
       if (j < num_entries) entry_size = offset_table[j] - offset_table[i];
-      entries_[i].resize_no_init(entry_size);
-      if (!fp.DeSerialize(&entries_[i][0], entry_size)) return false;
+      if (offset_table[i] > size || entry_size < 0 ||
+          entry_size > size - offset_table[i]) {
+        return false;
+      }
+      if (entry_size == 0) continue;
+      if (copy) {
+        entries_[i].resize_no_init(entry_size);
+        memcpy(&entries_[i][0], data + offset_table[i], entry_size);
+      } else {
+        mapped_entries_[i] = data + offset_table[i];
+        mapped_sizes_[i] = entry_size;
+      }
     }
   }
-  if (entries_[TESSDATA_VERSION].empty()) {
+  if (EntrySize(TESSDATA_VERSION) == 0) {
     SetVersionString("Pre-4.0.0");
   }
   is_loaded_ = true;
@@ -145,6 +195,7 @@ bool TessdataManager::LoadMemBuffer(const char *name, const char *data,
 void TessdataManager::OverwriteEntry(TessdataType type, const char *data,
                                      int size) {
   is_loaded_ = true;
+  mapped_entries_[type] = nullptr;
   entries_[type].resize_no_init(size);
   memcpy(&entries_[type][0], data, size);
 }
@@ -170,11 +221,11 @@ void TessdataManager::Serialize(GenericVector<char> *data) const {
   int64_t offset_table[TESSDATA_NUM_ENTRIES];
   int64_t offset = sizeof(int32_t) + sizeof(offset_table);
   for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
-    if (entries_[i].empty()) {
+    if (EntrySize(i) == 0) {
       offset_table[i] = -1;
     } else {
       offset_table[i] = offset;
-      offset += entries_[i].size();
+      offset += EntrySize(i);
     }
   }
   data->init_to_size(offset, 0);
@@ -183,9 +234,9 @@ void TessdataManager::Serialize(GenericVector<char> *data) const {
   fp.OpenWrite(data);
   fp.Serialize(&num_entries);
   fp.Serialize(&offset_table[0], countof(offset_table));
-  for (const auto& entry : entries_) {
-    if (!entry.empty()) {
-      fp.Serialize(&entry[0], entry.size());
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    if (EntrySize(i) > 0) {
+      fp.Serialize(EntryData(i), EntrySize(i));
     }
   }
 }
@@ -195,18 +246,31 @@ void TessdataManager::Clear() {
   for (auto& entry : entries_) {
     entry.clear();
   }
+  for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
+    mapped_entries_[i] = nullptr;
+    mapped_sizes_[i] = 0;
+  }
+  mapped_file_.reset();
   is_loaded_ = false;
 }
 
+// Copies a mapped entry into entries_, so that it can be modified.
+void TessdataManager::CopyMappedEntry(int type) {
+  if (mapped_entries_[type] == nullptr) return;
+  entries_[type].resize_no_init(mapped_sizes_[type]);
+  memcpy(&entries_[type][0], mapped_entries_[type], mapped_sizes_[type]);
+  mapped_entries_[type] = nullptr;
+}
+
 // Prints a directory of contents.
 void TessdataManager::Directory() const {
   tprintf("Version string:%s\n", VersionString().c_str());
   int offset = TESSDATA_NUM_ENTRIES * sizeof(int64_t);
   for (unsigned i = 0; i < TESSDATA_NUM_ENTRIES; ++i) {
-    if (!entries_[i].empty()) {
+    if (EntrySize(i) > 0) {
       tprintf("%d:%s:size=%d, offset=%d\n", i, kTessdataFileSuffixes[i],
-              entries_[i].size(), offset);
-      offset += entries_[i].size();
+              EntrySize(i), offset);
+      offset += EntrySize(i);
     }
   }
 }
@@ -223,20 +287,21 @@ bool TessdataManager::GetComponent(TessdataType type, TFile *fp) {
 // loaded.
 bool TessdataManager::GetComponent(TessdataType type, TFile *fp) const {
   ASSERT_HOST(is_loaded_);
-  if (entries_[type].empty()) return false;
-  fp->Open(&entries_[type][0], entries_[type].size());
+  if (EntrySize(type) == 0) return false;
+  fp->OpenNoCopy(EntryData(type), EntrySize(type));
   fp->set_swap(swap_);
   return true;
 }
 
 // Returns the current version string.
 std::string TessdataManager::VersionString() const {
-  return std::string(&entries_[TESSDATA_VERSION][0],
-                     entries_[TESSDATA_VERSION].size());
+  return std::string(EntryData(TESSDATA_VERSION),
+                     EntrySize(TESSDATA_VERSION));
 }
 
 // Sets the version string to the given v_str.
 void TessdataManager::SetVersionString(const std::string &v_str) {
+  mapped_entries_[TESSDATA_VERSION] = nullptr;
   entries_[TESSDATA_VERSION].resize_no_init(v_str.size());
   memcpy(&entries_[TESSDATA_VERSION][0], v_str.data(), v_str.size());
 }
@@ -253,6 +318,7 @@ bool TessdataManager::CombineDataFiles(
     FILE *fp = fopen(filename.string(), "rb");
     if (fp != nullptr) {
       fclose(fp);
+      mapped_entries_[type] = nullptr;
       if (!LoadDataFromFile(filename, &entries_[type])) {
         tprintf("Load of file %s failed!\n", filename.string());
         return false;
@@ -281,6 +347,7 @@ bool TessdataManager::OverwriteComponents(
   for (int i = 0; i < num_new_components; ++i) {
     TessdataType type;
     if (TessdataTypeFromFileName(component_filenames[i], &type)) {
+      mapped_entries_[type] = nullptr;
       if (!LoadDataFromFile(component_filenames[i], &entries_[type])) {
         tprintf("Failed to read component file:%s\n", component_filenames[i]);
         return false;
@@ -296,7 +363,8 @@ bool TessdataManager::ExtractToFile(const char *filename) {
   TessdataType type = TESSDATA_NUM_ENTRIES;
   ASSERT_HOST(
       tesseract::TessdataManager::TessdataTypeFromFileName(filename, &type));
-  if (entries_[type].empty()) return false;
+  if (EntrySize(type) == 0) return false;
+  CopyMappedEntry(type);
   return SaveDataToFile(entries_[type], filename);
 }
 
@@ -20,6 +20,8 @@
 #ifndef TESSERACT_CCUTIL_TESSDATAMANAGER_H_
 #define TESSERACT_CCUTIL_TESSDATAMANAGER_H_
 
+#include <memory>
+
 #include "genericvector.h"
 
 static const char kTrainedDataSuffix[] = "traineddata";
@@ -137,7 +139,9 @@ class TessdataManager {
   // until it needs it.
   void LoadFileLater(const char *data_file_name);
   /**
-   * Opens and reads the given data file right now.
+   * Opens and reads the given data file right now. Without a reader the file
+   * is memory-mapped where possible, so the components are read from the page
+   * cache and not copied onto the heap.
    * @return true on success.
    */
   bool Init(const char *data_file_name);
@@ -159,9 +163,11 @@ class TessdataManager {
 
   // Returns true if the component requested is present.
   bool IsComponentAvailable(TessdataType type) const {
-    return !entries_[type].empty();
+    return EntrySize(type) > 0;
   }
-  // Opens the given TFile pointer to the given component type.
+  // Opens the given TFile pointer to the given component type. The TFile reads
+  // the component in place, so it must not be used after *this is cleared,
+  // reloaded or destroyed, or after the component is overwritten.
   // Returns false in case of failure.
   bool GetComponent(TessdataType type, TFile *fp);
   // As non-const version except it can't load the component if not already
@@ -175,12 +181,12 @@ class TessdataManager {
 
   // Returns true if the base Tesseract components are present.
   bool IsBaseAvailable() const {
-    return !entries_[TESSDATA_UNICHARSET].empty() &&
-           !entries_[TESSDATA_INTTEMP].empty();
+    return EntrySize(TESSDATA_UNICHARSET) > 0 &&
+           EntrySize(TESSDATA_INTTEMP) > 0;
   }
 
   // Returns true if the LSTM components are present.
-  bool IsLSTMAvailable() const { return !entries_[TESSDATA_LSTM].empty(); }
+  bool IsLSTMAvailable() const { return EntrySize(TESSDATA_LSTM) > 0; }
 
   // Return the name of the underlying data file.
   const STRING &GetDataFileName() const { return data_file_name_; }
@@ -218,6 +224,25 @@ class TessdataManager {
 
   // Use libarchive.
   bool LoadArchiveFile(const char *filename);
+  // Memory-maps the given file and loads from the mapping without copying it.
+  // Returns false if the file could not be mapped or loaded.
+  bool LoadMappedFile(const char *filename);
+  // Loads the entries from data, copying them into entries_ or, if copy is
+  // false, only remembering where they are in data.
+  bool LoadEntries(const char *data, int size, bool copy);
+
+  // Returns the size of the given entry.
+  int EntrySize(int type) const {
+    return mapped_entries_[type] != nullptr ? mapped_sizes_[type]
+                                            : entries_[type].size();
+  }
+  // Returns the data of the given entry.
+  const char *EntryData(int type) const {
+    return mapped_entries_[type] != nullptr ? mapped_entries_[type]
+                                            : &entries_[type][0];
+  }
+  // Copies a mapped entry into entries_, so that it can be modified.
+  void CopyMappedEntry(int type);
 
   /**
    * Fills type with TessdataType of the tessdata component represented by the
@@ -245,6 +270,13 @@ class TessdataManager {
   bool swap_;
   // Contents of each element of the traineddata file.
   GenericVector<char> entries_[TESSDATA_NUM_ENTRIES];
+  // The memory-mapped data file, shared by copies of *this.
+  std::shared_ptr<const char> mapped_file_;
+  // Elements of the traineddata file that are read from mapped_file_ and are
+  // not in entries_, nullptr for the others.
+  const char *mapped_entries_[TESSDATA_NUM_ENTRIES] = {};
+  // Sizes of the mapped_entries_.
+  int mapped_sizes_[TESSDATA_NUM_ENTRIES] = {};
 };
 
 }  // namespace tesseract
@@ -21,8 +21,10 @@
 #ifdef _OPENMP
 #include <omp.h>
 #endif
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 #include "functions.h"
 #include "networkscratch.h"
@@ -33,6 +35,8 @@ const int kNumThreads = 4;
 #else
 const int kNumThreads = 1;
 #endif
+// Number of timesteps that go through the weights together in Forward.
+const int kStepsPerGroup = 8;
 
 namespace tesseract {
 
@@ -97,6 +101,11 @@ void FullyConnected::ConvertToInt() {
   weights_.ConvertToInt();
 }
 
+// Converts a double network to single precision for inference.
+void FullyConnected::ConvertToFloat() {
+  weights_.ConvertToFloat();
+}
+
 // Provides debug output on the weights.
 void FullyConnected::DebugWeights() {
   weights_.Debug2D(name_.string());
@@ -125,34 +134,60 @@ void FullyConnected::Forward(bool debug, const NetworkIO& input,
   else
     output->Resize(input, no_);
   SetupForward(input, input_transpose);
+  // The timesteps are independent, so they are done in groups, with each
+  // row of the weights applied to the whole group at once.
+  const int kNumBuffers = kNumThreads * kStepsPerGroup;
   GenericVector<NetworkScratch::FloatVec> temp_lines;
-  temp_lines.init_to_size(kNumThreads, NetworkScratch::FloatVec());
+  temp_lines.init_to_size(kNumBuffers, NetworkScratch::FloatVec());
   GenericVector<NetworkScratch::FloatVec> curr_input;
-  curr_input.init_to_size(kNumThreads, NetworkScratch::FloatVec());
-  for (int i = 0; i < kNumThreads; ++i) {
+  curr_input.init_to_size(kNumBuffers, NetworkScratch::FloatVec());
+  for (int i = 0; i < kNumBuffers; ++i) {
     temp_lines[i].Init(no_, scratch);
     curr_input[i].Init(ni_, scratch);
   }
+  int num_groups = (width + kStepsPerGroup - 1) / kStepsPerGroup;
 #ifdef _OPENMP
 #pragma omp parallel for num_threads(kNumThreads)
-  for (int t = 0; t < width; ++t) {
+  for (int g = 0; g < num_groups; ++g) {
     // Thread-local pointer to temporary storage.
     int thread_id = omp_get_thread_num();
 #else
-  for (int t = 0; t < width; ++t) {
+  for (int g = 0; g < num_groups; ++g) {
     // Thread-local pointer to temporary storage.
     int thread_id = 0;
 #endif
-    double* temp_line = temp_lines[thread_id];
+    int start_t = g * kStepsPerGroup;
+    int num_steps = std::min(kStepsPerGroup, width - start_t);
+    double* step_outputs[kStepsPerGroup];
+    for (int s = 0; s < num_steps; ++s) {
+      step_outputs[s] = temp_lines[thread_id * kStepsPerGroup + s];
+    }
     if (input.int_mode()) {
-      ForwardTimeStep(input.i(t), t, temp_line);
+      const int8_t* step_inputs[kStepsPerGroup];
+      for (int s = 0; s < num_steps; ++s) step_inputs[s] = input.i(start_t + s);
+      weights_.MatrixDotVectors(num_steps, step_inputs, step_outputs);
+    } else if (weights_.is_float_mode()) {
+      const float* step_inputs[kStepsPerGroup];
+      for (int s = 0; s < num_steps; ++s) step_inputs[s] = input.f(start_t + s);
+      weights_.MatrixDotVectors(num_steps, step_inputs, step_outputs);
     } else {
-      input.ReadTimeStep(t, curr_input[thread_id]);
-      ForwardTimeStep(curr_input[thread_id], t, temp_line);
+      double* step_inputs[kStepsPerGroup];
+      for (int s = 0; s < num_steps; ++s) {
+        step_inputs[s] = curr_input[thread_id * kStepsPerGroup + s];
+        input.ReadTimeStep(start_t + s, step_inputs[s]);
+        // input is copied to source_ line-by-line for cache coherency.
+        if (IsTraining() && external_source_ == nullptr)
+          source_t_.WriteStrided(start_t + s, step_inputs[s]);
+      }
+      weights_.MatrixDotVectors(num_steps, step_inputs, step_outputs);
     }
-    output->WriteTimeStep(t, temp_line);
-    if (IsTraining() && type_ != NT_SOFTMAX) {
-      acts_.CopyTimeStepFrom(t, *output, t);
+    for (int s = 0; s < num_steps; ++s) {
+      int t = start_t + s;
+      ForwardTimeStep(t, step_outputs[s]);
+      output->WriteTimeStep(t, step_outputs[s]);
+      if (IsTraining() && type_ != NT_SOFTMAX) {
+        acts_.CopyTimeStepFrom(t, *output, t);
+      }
     }
   }
   // Zero all the elements that are in the padding around images that allows
@@ -172,9 +207,9 @@ void FullyConnected::Forward(bool debug, const NetworkIO& input,
 // Components of Forward so FullyConnected can be reused inside LSTM.
 void FullyConnected::SetupForward(const NetworkIO& input,
                                   const TransposedArray* input_transpose) {
-  // Softmax output is always float, so save the input type.
-  int_mode_ = input.int_mode();
   if (IsTraining()) {
+    // Softmax output is always float, so save the input type.
+    int_mode_ = input.int_mode();
     acts_.Resize(input, no_);
     // Source_ is a transposed copy of input. It isn't needed if provided.
     external_source_ = input_transpose;
@@ -209,6 +244,12 @@ void FullyConnected::ForwardTimeStep(const double* d_input,
   ForwardTimeStep(t, output_line);
 }
 
+void FullyConnected::ForwardTimeStep(const float* f_input,
+                                     int t, double* output_line) {
+  weights_.MatrixDotVector(f_input, output_line);
+  ForwardTimeStep(t, output_line);
+}
+
 void FullyConnected::ForwardTimeStep(const int8_t* i_input,
                                      int t, double* output_line) {
   // input is copied to source_ line-by-line for cache coherency.
@@ -74,6 +74,8 @@ class FullyConnected : public Network {
 
   // Converts a float network to an int network.
   void ConvertToInt() override;
+  // Converts a double network to single precision for inference.
+  void ConvertToFloat() override;
 
   // Provides debug output on the weights.
   void DebugWeights() override;
@@ -93,6 +95,7 @@ class FullyConnected : public Network {
                     const TransposedArray* input_transpose);
   void ForwardTimeStep(int t, double* output_line);
   void ForwardTimeStep(const double* d_input, int t, double* output_line);
+  void ForwardTimeStep(const float* f_input, int t, double* output_line);
   void ForwardTimeStep(const int8_t* i_input, int t, double* output_line);
 
   // Runs backward propagation of errors on the deltas line.
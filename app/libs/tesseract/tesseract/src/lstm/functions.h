@@ -172,6 +172,48 @@ inline void FuncMultiply(const double* u, const double* v, int n, double* out) {
     out[i] = f(u[i]) * v[i];
   }
 }
+// Runs the forward step of n 1-d LSTM cells, given the pre-activations of
+// their CI, GI, GF1 and GO gates, each of size n, one after the other in
+// gates. Updates state, clipped to +/-state_clip, and puts the cell outputs
+// in output. Gives the same results as applying the activations to each gate
+// and then updating the state, but in a single pass with no branches other
+// than the loop, so that compilers can if-convert it.
+inline void LSTMCellForward(int n, double state_clip, const double* gates,
+                            double* state, double* output) {
+  const double* ci_in = gates;
+  const double* gi_in = gates + n;
+  const double* gf_in = gates + 2 * n;
+  const double* go_in = gates + 3 * n;
+  // As Tanh/Logistic: the table value for a non-negative arg, interpolated,
+  // and 1 beyond the end of the table.
+  auto table_value = [](const double* table, double x) {
+    x *= kScaleFactor;
+    int index = static_cast<int>(x);
+    int i0 = index < kTableSize - 1 ? index : kTableSize - 2;
+    double value = table[i0] + (table[i0 + 1] - table[i0]) * (x - i0);
+    return index < kTableSize - 1 ? value : 1.0;
+  };
+  auto tanh_value = [&](double x) {
+    double y = table_value(&TanhTable[0], x < 0.0 ? -x : x);
+    return x < 0.0 ? -y : y;
+  };
+  auto logistic_value = [&](double x) {
+    double y = table_value(&LogisticTable[0], x < 0.0 ? -x : x);
+    return x < 0.0 ? 1.0 - y : y;
+  };
+  for (int i = 0; i < n; ++i) {
+    double ci = tanh_value(ci_in[i]);
+    double gi = logistic_value(gi_in[i]);
+    double gf = logistic_value(gf_in[i]);
+    double go = logistic_value(go_in[i]);
+    double s = state[i] * gf;
+    s += ci * gi;
+    s = ClipToRange(s, -state_clip, state_clip);
+    state[i] = s;
+    output[i] = tanh_value(s) * go;
+  }
+}
+
 // Applies the Softmax function in-place to inout, of size n.
 template <typename T>
 inline void SoftmaxInPlace(int n, T* inout) {
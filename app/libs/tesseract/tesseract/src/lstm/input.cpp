@@ -110,6 +110,27 @@ Pix* Input::PrepareLSTMInputs(const ImageData& image_data,
 /* static */
 void Input::PreparePixInput(const StaticShape& shape, const Pix* pix,
                             TRand* randomizer, NetworkIO* input) {
+  PreparePixInputs(shape, std::vector<const Pix*>(1, pix),
+                   std::vector<TRand*>(1, randomizer), input);
+}
+
+// As PreparePixInput, but for a batch of images, each with its own randomizer.
+void Input::PreparePixInputs(const StaticShape& shape,
+                             const std::vector<const Pix*>& pixes,
+                             const std::vector<TRand*>& randomizers,
+                             NetworkIO* input) {
+  std::vector<const Pix*> normed_pixes;
+  for (const Pix* pix : pixes)
+    normed_pixes.push_back(NormalizePix(shape, pix));
+  input->FromPixes(shape, normed_pixes, randomizers);
+  for (const Pix* pix : normed_pixes) {
+    Pix* var_pix = const_cast<Pix*>(pix);
+    pixDestroy(&var_pix);
+  }
+}
+
+// Helper converts the given pix to the depth and height for the shape.
+Pix* Input::NormalizePix(const StaticShape& shape, const Pix* pix) {
   bool color = shape.depth() == 3;
   Pix* var_pix = const_cast<Pix*>(pix);
   int depth = pixGetDepth(var_pix);
@@ -139,8 +160,7 @@ void Input::PreparePixInput(const StaticShape& shape, const Pix* pix,
     pixDestroy(&normed_pix);
     normed_pix = scaled_pix;
   }
-  input->FromPix(shape, normed_pix, randomizer);
-  pixDestroy(&normed_pix);
+  return normed_pix;
 }
 
 }  // namespace tesseract.
@@ -90,11 +90,19 @@ class Input : public Network {
   // NOTE: It isn't safe for multiple threads to call this on the same pix.
   static void PreparePixInput(const StaticShape& shape, const Pix* pix,
                               TRand* randomizer, NetworkIO* input);
+  // As PreparePixInput, but for a batch of images, each with its own
+  // randomizer.
+  static void PreparePixInputs(const StaticShape& shape,
+                               const std::vector<const Pix*>& pixes,
+                               const std::vector<TRand*>& randomizers,
+                               NetworkIO* input);
 
  private:
   void DebugWeights() override {
     tprintf("Must override Network::DebugWeights for type %d\n", type_);
   }
+  // Helper converts the given pix to the depth and height for the shape.
+  static Pix* NormalizePix(const StaticShape& shape, const Pix* pix);
 
   // Input shape determines how images are dealt with.
   StaticShape shape_;
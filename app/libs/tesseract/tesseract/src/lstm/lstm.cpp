@@ -21,8 +21,10 @@
 #ifdef _OPENMP
 #include <omp.h>
 #endif
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <vector>
 
 #if !defined(__GNUC__) && defined(_MSC_VER)
 #include <intrin.h>     // _BitScanReverse
@@ -68,6 +70,8 @@ namespace tesseract {
 // Max absolute value of state_. It is reasonably high to enable the state
 // to count things.
 const double kStateClip = 100.0;
+// Number of rows of the input that ForwardRows runs in step.
+const int kRowsInStep = 8;
 // Max absolute value of gate_errors (the gradients).
 const double kErrClip = 1.0f;
 
@@ -181,6 +185,8 @@ int LSTM::RemapOutputs(int old_no, const std::vector<int>& code_map) {
 
 // Converts a float network to an int network.
 void LSTM::ConvertToInt() {
+  // Packed gates are already in their final, inference only, form.
+  if (IsPacked()) return;
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) continue;
     gate_weights_[w].ConvertToInt();
@@ -188,10 +194,46 @@ void LSTM::ConvertToInt() {
   if (softmax_ != nullptr) {
     softmax_->ConvertToInt();
   }
+  PackGates();
+}
+
+// Converts a double network to single precision for inference.
+void LSTM::ConvertToFloat() {
+  if (IsPacked()) return;
+  for (int w = 0; w < WT_COUNT; ++w) {
+    if (w == GFS && !Is2D()) continue;
+    gate_weights_[w].ConvertToFloat();
+  }
+  if (softmax_ != nullptr) {
+    softmax_->ConvertToFloat();
+  }
+  PackGates();
+}
+
+// Sets packed_gates_ from the 1-d gate weights, if ForwardRows will use them.
+// Int and float weights are only used for inference, so are never changed.
+void LSTM::PackGates() {
+  if (Is2D() || softmax_ != nullptr) return;
+  if (!gate_weights_[CI].is_int_mode() && !gate_weights_[CI].is_float_mode())
+    return;
+  const WeightMatrix* gates[] = {&gate_weights_[CI], &gate_weights_[GI],
+                                 &gate_weights_[GF1], &gate_weights_[GO]};
+  packed_gates_.StackRows(gates, 4);
+  // Only ForwardRows is left to use the separate gates, so they are freed,
+  // including any cached int copies that are now unused.
+  bool int_mode = gate_weights_[CI].is_int_mode();
+  for (int w = CI; w <= GO; ++w) gate_weights_[w].FreeWeights();
+  if (int_mode) WeightMatrix::DeleteUnusedIntWeights();
 }
 
 // Sets up the network for training using the given weight_range.
 void LSTM::DebugWeights() {
+  if (IsPacked()) {
+    STRING msg = name_;
+    msg += " Packed gate weights";
+    packed_gates_.Debug2D(msg.string());
+    return;
+  }
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) continue;
     STRING msg = name_;
@@ -209,7 +251,14 @@ bool LSTM::Serialize(TFile* fp) const {
   if (!fp->Serialize(&na_)) return false;
   for (int w = 0; w < WT_COUNT; ++w) {
     if (w == GFS && !Is2D()) continue;
-    if (!gate_weights_[w].Serialize(IsTraining(), fp)) return false;
+    if (IsPacked()) {
+      // Rebuild the gate from its rows of the packed gates.
+      WeightMatrix gate;
+      packed_gates_.ExtractRows(w * ns_, ns_, &gate);
+      if (!gate.Serialize(IsTraining(), fp)) return false;
+    } else if (!gate_weights_[w].Serialize(IsTraining(), fp)) {
+      return false;
+    }
   }
   if (softmax_ != nullptr && !softmax_->Serialize(fp)) return false;
   return true;
@@ -242,6 +291,7 @@ bool LSTM::DeSerialize(TFile* fp) {
   } else {
     softmax_ = nullptr;
   }
+  PackGates();
   return true;
 }
 
@@ -250,15 +300,39 @@ bool LSTM::DeSerialize(TFile* fp) {
 void LSTM::Forward(bool debug, const NetworkIO& input,
                    const TransposedArray* input_transpose,
                    NetworkScratch* scratch, NetworkIO* output) {
-  input_map_ = input.stride_map();
-  input_width_ = input.Width();
+  const StrideMap& input_map = input.stride_map();
+  if (IsTraining()) {
+    input_map_ = input_map;
+    input_width_ = input.Width();
+  }
   if (softmax_ != nullptr)
     output->ResizeFloat(input, no_);
   else if (type_ == NT_LSTM_SUMMARY)
     output->ResizeXTo1(input, no_);
   else
     output->Resize(input, no_);
-  ResizeForward(input);
+  // Packed gates are for inference only, and ForwardRows is all that can use
+  // them.
+  if (IsPacked() || (!IsTraining() && !Is2D() && softmax_ == nullptr)) {
+    ForwardRows(input, scratch, output);
+    if (debug) DisplayForward(*output);
+    return;
+  }
+  // Without training, the padded input and the 2-d forget gate choices are
+  // not needed after the forward pass, so they are taken from the scratch
+  // space, and this layer can run on several threads at once.
+  NetworkScratch::IO scratch_source;
+  GENERIC_2D_ARRAY<int8_t> scratch_which_fg;
+  NetworkIO* source = &source_;
+  GENERIC_2D_ARRAY<int8_t>* which_fg = &which_fg_;
+  if (IsTraining()) {
+    ResizeForward(input);
+  } else {
+    scratch_source.Resize(input, gate_weights_[CI].RoundInputs(na_), scratch);
+    source = scratch_source;
+    if (Is2D()) scratch_which_fg.ResizeNoInit(input.Width(), ns_);
+    which_fg = &scratch_which_fg;
+  }
   // Temporary storage of forward computation for each gate.
   NetworkScratch::FloatVec temp_lines[WT_COUNT];
   for (auto & temp_line : temp_lines) temp_line.Init(ns_, scratch);
@@ -271,7 +345,7 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
   // Rotating buffers of width buf_width allow storage of the state and output
   // for the other dimension, used only when working in true 2D mode. The width
   // is enough to hold an entire strip of the major direction.
-  int buf_width = Is2D() ? input_map_.Size(FD_WIDTH) : 1;
+  int buf_width = Is2D() ? input_map.Size(FD_WIDTH) : 1;
   GenericVector<NetworkScratch::FloatVec> states, outputs;
   if (Is2D()) {
     states.init_to_size(buf_width, NetworkScratch::FloatVec());
@@ -283,20 +357,24 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
       ZeroVector<double>(ns_, outputs[i]);
     }
   }
+  // In float mode the weights take the float source directly.
+  bool float_mode = gate_weights_[CI].is_float_mode();
   // Used only if a softmax LSTM.
   NetworkScratch::FloatVec softmax_output;
-  NetworkScratch::IO int_output;
+  NetworkScratch::IO int_output, float_output;
   if (softmax_ != nullptr) {
     softmax_output.Init(no_, scratch);
     ZeroVector<double>(no_, softmax_output);
     int rounded_softmax_inputs = gate_weights_[CI].RoundInputs(ns_);
     if (input.int_mode())
       int_output.Resize2d(true, 1, rounded_softmax_inputs, scratch);
+    else if (float_mode)
+      float_output.Resize2d(false, 1, ns_, scratch);
     softmax_->SetupForward(input, nullptr);
   }
   NetworkScratch::FloatVec curr_input;
   curr_input.Init(na_, scratch);
-  StrideMap::Index src_index(input_map_);
+  StrideMap::Index src_index(input_map);
   // Used only by NT_LSTM_SUMMARY.
   StrideMap::Index dest_index(output->stride_map());
   do {
@@ -310,46 +388,54 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
     // Index of the 2-D revolving buffers (outputs, states).
     int mod_t = Modulo(t, buf_width);      // Current timestep.
     // Setup the padded input in source.
-    source_.CopyTimeStepGeneral(t, 0, ni_, input, t, 0);
+    source->CopyTimeStepGeneral(t, 0, ni_, input, t, 0);
     if (softmax_ != nullptr) {
-      source_.WriteTimeStepPart(t, ni_, nf_, softmax_output);
+      source->WriteTimeStepPart(t, ni_, nf_, softmax_output);
     }
-    source_.WriteTimeStepPart(t, ni_ + nf_, ns_, curr_output);
+    source->WriteTimeStepPart(t, ni_ + nf_, ns_, curr_output);
     if (Is2D())
-      source_.WriteTimeStepPart(t, ni_ + nf_ + ns_, ns_, outputs[mod_t]);
-    if (!source_.int_mode()) source_.ReadTimeStep(t, curr_input);
+      source->WriteTimeStepPart(t, ni_ + nf_ + ns_, ns_, outputs[mod_t]);
+    if (!source->int_mode() && !float_mode) source->ReadTimeStep(t, curr_input);
     // Matrix multiply the inputs with the source.
     PARALLEL_IF_OPENMP(GFS)
     // It looks inefficient to create the threads on each t iteration, but the
     // alternative of putting the parallel outside the t loop, a single around
     // the t-loop and then tasks in place of the sections is a *lot* slower.
     // Cell inputs.
-    if (source_.int_mode())
-      gate_weights_[CI].MatrixDotVector(source_.i(t), temp_lines[CI]);
+    if (source->int_mode())
+      gate_weights_[CI].MatrixDotVector(source->i(t), temp_lines[CI]);
+    else if (float_mode)
+      gate_weights_[CI].MatrixDotVector(source->f(t), temp_lines[CI]);
     else
       gate_weights_[CI].MatrixDotVector(curr_input, temp_lines[CI]);
     FuncInplace<GFunc>(ns_, temp_lines[CI]);
 
     SECTION_IF_OPENMP
     // Input Gates.
-    if (source_.int_mode())
-      gate_weights_[GI].MatrixDotVector(source_.i(t), temp_lines[GI]);
+    if (source->int_mode())
+      gate_weights_[GI].MatrixDotVector(source->i(t), temp_lines[GI]);
+    else if (float_mode)
+      gate_weights_[GI].MatrixDotVector(source->f(t), temp_lines[GI]);
     else
       gate_weights_[GI].MatrixDotVector(curr_input, temp_lines[GI]);
     FuncInplace<FFunc>(ns_, temp_lines[GI]);
 
     SECTION_IF_OPENMP
     // 1-D forget gates.
-    if (source_.int_mode())
-      gate_weights_[GF1].MatrixDotVector(source_.i(t), temp_lines[GF1]);
+    if (source->int_mode())
+      gate_weights_[GF1].MatrixDotVector(source->i(t), temp_lines[GF1]);
+    else if (float_mode)
+      gate_weights_[GF1].MatrixDotVector(source->f(t), temp_lines[GF1]);
     else
       gate_weights_[GF1].MatrixDotVector(curr_input, temp_lines[GF1]);
     FuncInplace<FFunc>(ns_, temp_lines[GF1]);
 
     // 2-D forget gates.
     if (Is2D()) {
-      if (source_.int_mode())
-        gate_weights_[GFS].MatrixDotVector(source_.i(t), temp_lines[GFS]);
+      if (source->int_mode())
+        gate_weights_[GFS].MatrixDotVector(source->i(t), temp_lines[GFS]);
+      else if (float_mode)
+        gate_weights_[GFS].MatrixDotVector(source->f(t), temp_lines[GFS]);
       else
         gate_weights_[GFS].MatrixDotVector(curr_input, temp_lines[GFS]);
       FuncInplace<FFunc>(ns_, temp_lines[GFS]);
@@ -357,8 +443,10 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
 
     SECTION_IF_OPENMP
     // Output gates.
-    if (source_.int_mode())
-      gate_weights_[GO].MatrixDotVector(source_.i(t), temp_lines[GO]);
+    if (source->int_mode())
+      gate_weights_[GO].MatrixDotVector(source->i(t), temp_lines[GO]);
+    else if (float_mode)
+      gate_weights_[GO].MatrixDotVector(source->f(t), temp_lines[GO]);
     else
       gate_weights_[GO].MatrixDotVector(curr_input, temp_lines[GO]);
     FuncInplace<FFunc>(ns_, temp_lines[GO]);
@@ -368,7 +456,7 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
     MultiplyVectorsInPlace(ns_, temp_lines[GF1], curr_state);
     if (Is2D()) {
       // Max-pool the forget gates (in 2-d) instead of blindly adding.
-      int8_t* which_fg_col = which_fg_[t];
+      int8_t* which_fg_col = (*which_fg)[t];
       memset(which_fg_col, 1, ns_ * sizeof(which_fg_col[0]));
       if (valid_2d) {
         const double* stepped_state = states[mod_t];
@@ -397,6 +485,9 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
       if (input.int_mode()) {
         int_output->WriteTimeStepPart(0, 0, ns_, curr_output);
         softmax_->ForwardTimeStep(int_output->i(0), t, softmax_output);
+      } else if (float_mode) {
+        float_output->WriteTimeStepPart(0, 0, ns_, curr_output);
+        softmax_->ForwardTimeStep(float_output->f(0), t, softmax_output);
       } else {
         softmax_->ForwardTimeStep(curr_output, t, softmax_output);
       }
@@ -427,7 +518,7 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
   } while (src_index.Increment());
 #if DEBUG_DETAIL > 0
   tprintf("Source:%s\n", name_.string());
-  source_.Print(10);
+  source->Print(10);
   tprintf("State:%s\n", name_.string());
   state_.Print(10);
   tprintf("Output:%s\n", name_.string());
@@ -436,6 +527,123 @@ void LSTM::Forward(bool debug, const NetworkIO& input,
   if (debug) DisplayForward(*output);
 }
 
+// Forward for a 1-d lstm without softmax that is not training, running groups
+// of rows in step. The computation for each row is the same as in Forward.
+void LSTM::ForwardRows(const NetworkIO& input, NetworkScratch* scratch,
+                       NetworkIO* output) {
+  const StrideMap& input_map = input.stride_map();
+  bool packed = IsPacked();
+  const WeightMatrix& first_gate = packed ? packed_gates_ : gate_weights_[CI];
+  NetworkScratch::IO source;
+  source.Resize(input, first_gate.RoundInputs(na_), scratch);
+  bool int_mode = source->int_mode();
+  // In float mode the weights take the float source directly.
+  bool float_mode = first_gate.is_float_mode();
+  // Find the start, length and output position of each row.
+  std::vector<int> row_starts, row_lengths, row_outputs;
+  for (int b = 0; b < input_map.Size(FD_BATCH); ++b) {
+    StrideMap::Index batch_index(input_map, b, 0, 0);
+    int height = batch_index.MaxIndexOfDim(FD_HEIGHT) + 1;
+    int width = batch_index.MaxIndexOfDim(FD_WIDTH) + 1;
+    for (int y = 0; y < height; ++y) {
+      row_starts.push_back(StrideMap::Index(input_map, b, y, 0).t());
+      row_lengths.push_back(width);
+      // NT_LSTM_SUMMARY only outputs the end of each row.
+      row_outputs.push_back(StrideMap::Index(output->stride_map(), b, y, 0).t());
+    }
+  }
+  int num_rows = row_starts.size();
+  int group_size = std::min(kRowsInStep, num_rows);
+  // Per row state, output, and the values of the CI, GI, GF1 and GO gates
+  // one after the other, as LSTMCellForward expects them, for the current
+  // timestep.
+  GenericVector<NetworkScratch::FloatVec> states, outputs, curr_inputs;
+  GenericVector<NetworkScratch::FloatVec> gate_values;
+  states.init_to_size(group_size, NetworkScratch::FloatVec());
+  outputs.init_to_size(group_size, NetworkScratch::FloatVec());
+  curr_inputs.init_to_size(group_size, NetworkScratch::FloatVec());
+  gate_values.init_to_size(group_size, NetworkScratch::FloatVec());
+  for (int r = 0; r < group_size; ++r) {
+    states[r].Init(ns_, scratch);
+    outputs[r].Init(ns_, scratch);
+    if (!int_mode && !float_mode) curr_inputs[r].Init(na_, scratch);
+    gate_values[r].Init(4 * ns_, scratch);
+  }
+  // The rows that are running in the current timestep, and their inputs and
+  // gate values, as passed to MatrixDotVectors.
+  std::vector<int> rows(group_size);
+  std::vector<const int8_t*> int_inputs(group_size);
+  std::vector<const float*> float_inputs(group_size);
+  std::vector<const double*> double_inputs(group_size);
+  std::vector<double*> gate_lines(group_size);
+  // Multiplies the inputs of the running rows by weights into gate_lines.
+  auto multiply = [&](const WeightMatrix& weights, int num_running) {
+    if (int_mode) {
+      weights.MatrixDotVectors(num_running, &int_inputs[0], &gate_lines[0]);
+    } else if (float_mode) {
+      weights.MatrixDotVectors(num_running, &float_inputs[0], &gate_lines[0]);
+    } else {
+      weights.MatrixDotVectors(num_running, &double_inputs[0], &gate_lines[0]);
+    }
+  };
+  for (int first = 0; first < num_rows; first += group_size) {
+    int end = std::min(first + group_size, num_rows);
+    int max_length = 0;
+    for (int r = first; r < end; ++r) {
+      ZeroVector<double>(ns_, states[r - first]);
+      ZeroVector<double>(ns_, outputs[r - first]);
+      max_length = std::max(max_length, row_lengths[r]);
+    }
+    for (int x = 0; x < max_length; ++x) {
+      // Setup the padded input in source for each running row.
+      int num_running = 0;
+      for (int r = first; r < end; ++r) {
+        if (x >= row_lengths[r]) continue;
+        int slot = r - first;
+        int t = row_starts[r] + x;
+        source->CopyTimeStepGeneral(t, 0, ni_, input, t, 0);
+        source->WriteTimeStepPart(t, ni_, ns_, outputs[slot]);
+        if (int_mode) {
+          int_inputs[num_running] = source->i(t);
+        } else if (float_mode) {
+          float_inputs[num_running] = source->f(t);
+        } else {
+          source->ReadTimeStep(t, curr_inputs[slot]);
+          double_inputs[num_running] = curr_inputs[slot];
+        }
+        rows[num_running++] = r;
+      }
+      // Matrix multiply the inputs with the source, for all the gates and
+      // rows at once if the gates are packed.
+      if (packed) {
+        for (int i = 0; i < num_running; ++i) {
+          gate_lines[i] = gate_values[rows[i] - first];
+        }
+        multiply(packed_gates_, num_running);
+      } else {
+        const WeightType kGates[] = {CI, GI, GF1, GO};
+        for (int g = 0; g < 4; ++g) {
+          for (int i = 0; i < num_running; ++i) {
+            gate_lines[i] = gate_values[rows[i] - first] + g * ns_;
+          }
+          multiply(gate_weights_[kGates[g]], num_running);
+        }
+      }
+      for (int i = 0; i < num_running; ++i) {
+        int r = rows[i];
+        int slot = r - first;
+        LSTMCellForward(ns_, kStateClip, gate_values[slot], states[slot],
+                        outputs[slot]);
+        if (type_ != NT_LSTM_SUMMARY) {
+          output->WriteTimeStep(row_starts[r] + x, outputs[slot]);
+        } else if (x + 1 == row_lengths[r]) {
+          output->WriteTimeStep(row_outputs[r], outputs[slot]);
+        }
+      }
+    }
+  }
+}
+
 // Runs backward propagation of errors on the deltas line.
 // See NetworkCpp for a detailed discussion of the arguments.
 bool LSTM::Backward(bool debug, const NetworkIO& fwd_deltas,
@@ -82,6 +82,8 @@ class LSTM : public Network {
 
   // Converts a float network to an int network.
   void ConvertToInt() override;
+  // Converts a double network to single precision for inference.
+  void ConvertToFloat() override;
 
   // Provides debug output on the weights.
   void DebugWeights() override;
@@ -123,6 +125,15 @@ class LSTM : public Network {
  private:
   // Resizes forward data to cope with an input image of the given width.
   void ResizeForward(const NetworkIO& input);
+  // Forward for a 1-d lstm without softmax that is not training. Each row of
+  // the input is a separate sequence, so groups of rows are run in step, and
+  // each timestep of the group goes through the weights together.
+  void ForwardRows(const NetworkIO& input, NetworkScratch* scratch,
+                   NetworkIO* output);
+  // Moves the 1-d gate weights into packed_gates_ if this is a 1-d lstm
+  // without softmax whose weights can no longer be trained.
+  void PackGates();
+  bool IsPacked() const { return packed_gates_.NumOutputs() > 0; }
 
  private:
   // Size of padded input to weight matrices = ni_ + no_ for 1-D operation
@@ -139,8 +150,12 @@ class LSTM : public Network {
   // Flag indicating 2-D operation.
   bool is_2d_;
 
-  // Gate weight arrays of size [na + 1, no].
+  // Gate weight arrays of size [na + 1, no]. CI to GO are empty once packed.
   WeightMatrix gate_weights_[WT_COUNT];
+  // The CI, GI, GF1 and GO weights stacked into one matrix, so ForwardRows
+  // can compute all the gates with one product. Only set by PackGates, after
+  // which it replaces the separate gates.
+  WeightMatrix packed_gates_;
   // Used only if this is a softmax LSTM.
   FullyConnected* softmax_;
   // Input padded with previous output of size [width, na].
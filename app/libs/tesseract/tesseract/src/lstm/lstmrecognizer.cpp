@@ -45,6 +45,9 @@ namespace tesseract {
 const double kDictRatio = 2.25;
 // Default certainty offset to give the dictionary a chance.
 const double kCertOffset = -0.085;
+// Lines with a predicted polarity (see LinePolarity) above this are taken to
+// be dark text on a light background, so inverting them is not tried.
+const float kMaxInvertPolarity = 0.8f;
 
 LSTMRecognizer::LSTMRecognizer()
     : network_(nullptr),
@@ -187,6 +190,16 @@ void LSTMRecognizer::RecognizeLine(const ImageData& image_data, bool invert,
   if (!RecognizeLine(image_data, invert, debug, false, false, &scale_factor,
                      &inputs, &outputs))
     return;
+  DecodeLine(outputs, scale_factor, debug, worst_dict_cert, line_box, words,
+             lstm_choice_mode);
+}
+
+// Decodes the outputs of the network on the line into words.
+void LSTMRecognizer::DecodeLine(const NetworkIO& outputs, float scale_factor,
+                                bool debug, double worst_dict_cert,
+                                const TBOX& line_box,
+                                PointerVector<WERD_RES>* words,
+                                int lstm_choice_mode) {
   if (search_ == nullptr) {
     search_ =
         new RecodeBeamSearch(recoder_, null_char_, SimpleTextOutput(), dict_);
@@ -222,19 +235,72 @@ void LSTMRecognizer::OutputStats(const NetworkIO& outputs, float* min_output,
   }
 }
 
+// Predicts the polarity of a line image from its grey levels.
+/* static */
+float LSTMRecognizer::LinePolarity(Pix* pix) {
+  // Fraction of the pixels at each end that is ignored as noise.
+  const double kExtremeFraction = 0.05;
+  // Least difference between the dark and light levels, as a fraction of
+  // the full range, for the polarity to be predicted.
+  const double kMinContrast = 0.125;
+  int depth = pixGetDepth(pix);
+  Pix* grey = nullptr;
+  if (depth == 32) {
+    grey = pixConvertRGBToLuminance(pix);
+  } else if (depth == 1 || depth == 8) {
+    grey = pixClone(pix);
+  }
+  if (grey == nullptr) return -1.0f;
+  NUMA* histogram = pixGetGrayHistogram(grey, 1);
+  // Binary images have 1 for black, so they are reversed to run from dark to
+  // light like the grey levels, unless the histogram came from a colormap.
+  bool reverse = pixGetDepth(grey) == 1 && pixGetColormap(grey) == nullptr;
+  pixDestroy(&grey);
+  if (histogram == nullptr) return -1.0f;
+  int num_levels = numaGetCount(histogram);
+  l_float32 total;
+  numaGetSum(histogram, &total);
+  // Finds the darkest, median and lightest levels.
+  int levels[3] = {-1, -1, -1};
+  const double kFractions[3] = {kExtremeFraction, 0.5, 1.0 - kExtremeFraction};
+  double count = 0.0;
+  for (int i = 0, l = 0; i < num_levels && l < 3; ++i) {
+    l_float32 value;
+    numaGetFValue(histogram, reverse ? num_levels - 1 - i : i, &value);
+    count += value;
+    while (l < 3 && count > kFractions[l] * total) levels[l++] = i;
+  }
+  numaDestroy(&histogram);
+  int range = levels[2] - levels[0];
+  if (levels[2] < 0 || range < kMinContrast * (num_levels - 1)) return -1.0f;
+  return static_cast<float>(levels[1] - levels[0]) / range;
+}
+
 // Recognizes the image_data, returning the labels,
 // scores, and corresponding pairs of start, end x-coords in coords.
 bool LSTMRecognizer::RecognizeLine(const ImageData& image_data, bool invert,
                                    bool debug, bool re_invert, bool upside_down,
                                    float* scale_factor, NetworkIO* inputs,
                                    NetworkIO* outputs) {
+  return ForwardLine(image_data, invert, debug, re_invert, upside_down,
+                     &scratch_space_, &randomizer_, scale_factor, inputs,
+                     outputs);
+}
+
+// Recognizes the image_data with the given scratch space and randomizer.
+bool LSTMRecognizer::ForwardLine(const ImageData& image_data, bool invert,
+                                 bool debug, bool re_invert, bool upside_down,
+                                 NetworkScratch* scratch, TRand* randomizer,
+                                 float* scale_factor, NetworkIO* inputs,
+                                 NetworkIO* outputs) {
   // Maximum width of image to train on.
   const int kMaxImageWidth = 2560;
+  scratch->set_randomizer(randomizer);
   // This ensures consistent recognition results.
-  SetRandomSeed();
+  SetRandomSeed(randomizer);
   int min_width = network_->XScaleFactor();
   Pix* pix = Input::PrepareLSTMInputs(image_data, network_, min_width,
-                                      &randomizer_, scale_factor);
+                                      randomizer, scale_factor);
   if (pix == nullptr) {
     tprintf("Line cannot be recognized!!\n");
     return false;
@@ -249,22 +315,21 @@ bool LSTMRecognizer::RecognizeLine(const ImageData& image_data, bool invert,
   // Reduction factor from image to coords.
   *scale_factor = min_width / *scale_factor;
   inputs->set_int_mode(IsIntMode());
-  SetRandomSeed();
-  Input::PreparePixInput(network_->InputShape(), pix, &randomizer_, inputs);
-  network_->Forward(debug, *inputs, nullptr, &scratch_space_, outputs);
+  SetRandomSeed(randomizer);
+  Input::PreparePixInput(network_->InputShape(), pix, randomizer, inputs);
+  network_->Forward(debug, *inputs, nullptr, scratch, outputs);
   // Check for auto inversion.
   float pos_min, pos_mean, pos_sd;
   OutputStats(*outputs, &pos_min, &pos_mean, &pos_sd);
-  if (invert && pos_min < 0.5) {
+  if (invert && pos_min < 0.5 && LinePolarity(pix) < kMaxInvertPolarity) {
     // Run again inverted and see if it is any better.
     NetworkIO inv_inputs, inv_outputs;
     inv_inputs.set_int_mode(IsIntMode());
-    SetRandomSeed();
+    SetRandomSeed(randomizer);
     pixInvert(pix, pix);
-    Input::PreparePixInput(network_->InputShape(), pix, &randomizer_,
+    Input::PreparePixInput(network_->InputShape(), pix, randomizer,
                            &inv_inputs);
-    network_->Forward(debug, inv_inputs, nullptr, &scratch_space_,
-                      &inv_outputs);
+    network_->Forward(debug, inv_inputs, nullptr, scratch, &inv_outputs);
     float inv_min, inv_mean, inv_sd;
     OutputStats(inv_outputs, &inv_min, &inv_mean, &inv_sd);
     if (inv_min > pos_min && inv_mean > pos_mean && inv_sd < pos_sd) {
@@ -275,11 +340,13 @@ bool LSTMRecognizer::RecognizeLine(const ImageData& image_data, bool invert,
       }
       *outputs = inv_outputs;
       *inputs = inv_inputs;
-    } else if (re_invert) {
+    } else if (re_invert && network_->IsTraining()) {
       // Inverting was not an improvement, so undo and run again, so the
-      // outputs match the best forward result.
-      SetRandomSeed();
-      network_->Forward(debug, *inputs, nullptr, &scratch_space_, outputs);
+      // outputs match the best forward result. Only needed in training, where
+      // the network keeps the state of its last forward pass for backprop;
+      // otherwise outputs and inputs still hold the original results.
+      SetRandomSeed(randomizer);
+      network_->Forward(debug, *inputs, nullptr, scratch, outputs);
     }
   }
   pixDestroy(&pix);
@@ -292,6 +359,91 @@ bool LSTMRecognizer::RecognizeLine(const ImageData& image_data, bool invert,
   return true;
 }
 
+// Runs the network on several line images at once, as a single batch, and
+// fills in lines with the same results that ForwardLine gives for each image.
+void LSTMRecognizer::RecognizeLines(
+    const std::vector<const ImageData*>& images,
+    const std::vector<TRand*>& randomizers, NetworkScratch* scratch,
+    const std::vector<LSTMLineOutputs*>& lines) {
+  int min_width = network_->XScaleFactor();
+  // The lines that can be recognized, and their prepared images.
+  std::vector<int> batch_lines;
+  std::vector<Pix*> pixes;
+  for (size_t i = 0; i < images.size(); ++i) {
+    SetRandomSeed(randomizers[i]);
+    float scale_factor;
+    Pix* pix = Input::PrepareLSTMInputs(*images[i], network_, min_width,
+                                        randomizers[i], &scale_factor);
+    lines[i]->valid = pix != nullptr;
+    if (pix == nullptr) {
+      tprintf("Line cannot be recognized!!\n");
+      continue;
+    }
+    // Reduction factor from image to coords.
+    lines[i]->scale_factor = min_width / scale_factor;
+    batch_lines.push_back(i);
+    pixes.push_back(pix);
+  }
+  // Runs the forward pass on the pixes of the given members of batch_lines,
+  // and returns the outputs of each in its own NetworkIO.
+  auto forward_batch = [&](const std::vector<int>& members,
+                           std::vector<NetworkIO>* outputs) {
+    std::vector<const Pix*> batch_pixes;
+    std::vector<TRand*> batch_randomizers;
+    for (int m : members) {
+      batch_pixes.push_back(pixes[m]);
+      batch_randomizers.push_back(randomizers[batch_lines[m]]);
+      SetRandomSeed(batch_randomizers.back());
+    }
+    NetworkIO inputs, batch_outputs;
+    inputs.set_int_mode(IsIntMode());
+    Input::PreparePixInputs(network_->InputShape(), batch_pixes,
+                            batch_randomizers, &inputs);
+    scratch->set_randomizers(batch_randomizers);
+    network_->Forward(false, inputs, nullptr, scratch, &batch_outputs);
+    outputs->resize(members.size());
+    for (size_t b = 0; b < members.size(); ++b) {
+      (*outputs)[b].CopyBatch(batch_outputs, b);
+    }
+  };
+  std::vector<int> members(batch_lines.size());
+  for (size_t m = 0; m < members.size(); ++m) members[m] = m;
+  std::vector<NetworkIO> outputs;
+  if (!members.empty()) forward_batch(members, &outputs);
+  // Check for auto inversion, running the lines that may be inverted again as
+  // another batch.
+  std::vector<int> inv_members;
+  std::vector<float> pos_stats;
+  for (int m : members) {
+    float pos_min, pos_mean, pos_sd;
+    OutputStats(outputs[m], &pos_min, &pos_mean, &pos_sd);
+    if (pos_min < 0.5 && LinePolarity(pixes[m]) < kMaxInvertPolarity) {
+      inv_members.push_back(m);
+      pos_stats.push_back(pos_min);
+      pos_stats.push_back(pos_mean);
+      pos_stats.push_back(pos_sd);
+      pixInvert(pixes[m], pixes[m]);
+    }
+  }
+  if (!inv_members.empty()) {
+    std::vector<NetworkIO> inv_outputs;
+    forward_batch(inv_members, &inv_outputs);
+    for (size_t i = 0; i < inv_members.size(); ++i) {
+      float inv_min, inv_mean, inv_sd;
+      OutputStats(inv_outputs[i], &inv_min, &inv_mean, &inv_sd);
+      if (inv_min > pos_stats[3 * i] && inv_mean > pos_stats[3 * i + 1] &&
+          inv_sd < pos_stats[3 * i + 2]) {
+        // Inverted did better. Use inverted data.
+        outputs[inv_members[i]] = inv_outputs[i];
+      }
+    }
+  }
+  for (int m : members) {
+    lines[batch_lines[m]]->outputs = outputs[m];
+    pixDestroy(&pixes[m]);
+  }
+}
+
 // Converts an array of labels to utf-8, whether or not the labels are
 // augmented with character boundaries.
 STRING LSTMRecognizer::DecodeLabels(const GenericVector<int>& labels) {
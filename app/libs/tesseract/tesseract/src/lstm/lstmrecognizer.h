@@ -27,10 +27,13 @@
 #include "networkscratch.h"
 #include "params.h"
 #include "recodebeam.h"
+#include "rect.h"
 #include "series.h"
 #include "strngs.h"
 #include "unicharcompress.h"
 
+#include <vector>
+
 class BLOB_CHOICE_IT;
 struct Pix;
 class ROW_RES;
@@ -49,6 +52,23 @@ enum TrainingFlags {
   TF_COMPRESS_UNICHARSET = 64,
 };
 
+// Number of lines that Tesseract::PrerecLSTMLinesPar runs through the network
+// together on one thread.
+const int kLSTMLinesInBatch = 4;
+
+// The outputs of the network on a line image, as made by ForwardLine, with
+// what DecodeLine needs to turn them into words.
+struct LSTMLineOutputs {
+  LSTMLineOutputs() : valid(false), scale_factor(0.0f) {}
+
+  // False if there was no image or the network could not be run on it.
+  bool valid;
+  float scale_factor;
+  // Box of the line image, used to position the words.
+  TBOX line_box;
+  NetworkIO outputs;
+};
+
 // Top-level line recognizer class for LSTM-based networks.
 // Note that a sub-class, LSTMTrainer is used for training.
 class LSTMRecognizer {
@@ -127,6 +147,11 @@ class LSTMRecognizer {
       training_flags_ |= TF_INT_MODE;
     }
   }
+  // Converts a double network to single precision for faster inference. Int
+  // networks are left as they are. The network cannot be trained afterwards.
+  void ConvertToFloat() {
+    if (!IsIntMode()) network_->ConvertToFloat();
+  }
 
   // Provides access to the UNICHARSET that this classifier works with.
   const UNICHARSET& GetUnicharset() const { return ccutil_.unicharset; }
@@ -176,10 +201,22 @@ class LSTMRecognizer {
   void RecognizeLine(const ImageData& image_data, bool invert, bool debug,
                      double worst_dict_cert, const TBOX& line_box,
                      PointerVector<WERD_RES>* words, int lstm_choice_mode = 0);
+  // The second half of the above: decodes the outputs of the network on the
+  // line into words.
+  void DecodeLine(const NetworkIO& outputs, float scale_factor, bool debug,
+                  double worst_dict_cert, const TBOX& line_box,
+                  PointerVector<WERD_RES>* words, int lstm_choice_mode = 0);
 
   // Helper computes min and mean best results in the output.
   void OutputStats(const NetworkIO& outputs, float* min_output,
                    float* mean_output, float* sd);
+  // Predicts the polarity of a line image from its grey levels, before it is
+  // run through the network. Returns the position of the median level between
+  // the darkest and lightest levels, which is near 1 for dark text on a light
+  // background, as the background covers most of a line, and near 0 for light
+  // text on a dark background. Returns -1 if the pix isn't grey or binary, or
+  // has too little contrast to tell.
+  static float LinePolarity(Pix* pix);
   // Recognizes the image_data, returning the labels,
   // scores, and corresponding pairs of start, end x-coords in coords.
   // Returned in scale_factor is the reduction factor
@@ -192,6 +229,23 @@ class LSTMRecognizer {
   bool RecognizeLine(const ImageData& image_data, bool invert, bool debug,
                      bool re_invert, bool upside_down, float* scale_factor,
                      NetworkIO* inputs, NetworkIO* outputs);
+  // As above, but with the given scratch space and randomizer in place of the
+  // members. Without debug and training, nothing else in the recognizer or
+  // the network is modified, so several lines can be recognized at once on
+  // different threads, each with its own scratch and randomizer.
+  bool ForwardLine(const ImageData& image_data, bool invert, bool debug,
+                   bool re_invert, bool upside_down, NetworkScratch* scratch,
+                   TRand* randomizer, float* scale_factor, NetworkIO* inputs,
+                   NetworkIO* outputs);
+  // Runs the network on several line images at once, as a single batch, and
+  // fills in lines with the same results that ForwardLine gives for each
+  // image on its own, with invert set and no debug, re_invert or upside_down.
+  // Each image has its own randomizer. The batch is most efficient if the
+  // images have similar widths.
+  void RecognizeLines(const std::vector<const ImageData*>& images,
+                      const std::vector<TRand*>& randomizers,
+                      NetworkScratch* scratch,
+                      const std::vector<LSTMLineOutputs*>& lines);
 
   // Converts an array of labels to utf-8, whether or not the labels are
   // augmented with character boundaries.
@@ -212,9 +266,12 @@ class LSTMRecognizer {
  protected:
   // Sets the random seed from the sample_iteration_;
   void SetRandomSeed() {
+    SetRandomSeed(&randomizer_);
+  }
+  void SetRandomSeed(TRand* randomizer) const {
     int64_t seed = static_cast<int64_t>(sample_iteration_) * 0x10000001;
-    randomizer_.set_seed(seed);
-    randomizer_.IntRand();
+    randomizer->set_seed(seed);
+    randomizer->IntRand();
   }
 
   // Displays the labels and cuts at the corresponding xcoords.
@@ -38,8 +38,14 @@ void Maxpool::Forward(bool debug, const NetworkIO& input,
                       const TransposedArray* input_transpose,
                       NetworkScratch* scratch, NetworkIO* output) {
   output->ResizeScaled(input, x_scale_, y_scale_, no_);
-  maxes_.ResizeNoInit(output->Width(), ni_);
-  back_map_ = input.stride_map();
+  // The positions of the maxes are only kept for Backward.
+  GenericVector<int> max_positions;
+  if (IsTraining()) {
+    maxes_.ResizeNoInit(output->Width(), ni_);
+    back_map_ = input.stride_map();
+  } else {
+    max_positions.init_to_size(ni_, 0);
+  }
 
   StrideMap::Index dest_index(output->stride_map());
   do {
@@ -49,7 +55,7 @@ void Maxpool::Forward(bool debug, const NetworkIO& input,
                                dest_index.index(FD_WIDTH) * x_scale_);
     // Find the max input out of x_scale_ groups of y_scale_ inputs.
     // Do it independently for each input dimension.
-    int* max_line = maxes_[out_t];
+    int* max_line = IsTraining() ? maxes_[out_t] : &max_positions[0];
     int in_t = src_index.t();
     output->CopyTimeStepFrom(out_t, input, in_t);
     for (int i = 0; i < ni_; ++i) {
@@ -188,6 +188,8 @@ class Network {
 
   // Converts a float network to an int network.
   virtual void ConvertToInt() {}
+  // Converts a double network to single precision for inference only.
+  virtual void ConvertToFloat() {}
 
   // Provides a pointer to a TRand for any networks that care to use it.
   // Note that randomizer is a borrowed pointer that should outlive the network
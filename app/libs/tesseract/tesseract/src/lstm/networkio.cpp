@@ -170,6 +170,13 @@ void NetworkIO::FromPix(const StaticShape& shape, const Pix* pix,
 void NetworkIO::FromPixes(const StaticShape& shape,
                           const std::vector<const Pix*>& pixes,
                           TRand* randomizer) {
+  FromPixes(shape, pixes, std::vector<TRand*>(pixes.size(), randomizer));
+}
+
+// As above, but with a separate randomizer for each image.
+void NetworkIO::FromPixes(const StaticShape& shape,
+                          const std::vector<const Pix*>& pixes,
+                          const std::vector<TRand*>& randomizers) {
   int target_height = shape.height();
   int target_width = shape.width();
   std::vector<std::pair<int, int>> h_w_pairs;
@@ -191,9 +198,9 @@ void NetworkIO::FromPixes(const StaticShape& shape,
     float contrast = (white - black) / 2.0f;
     if (contrast <= 0.0f) contrast = 1.0f;
     if (shape.height() == 1) {
-      Copy1DGreyImage(b, pix, black, contrast, randomizer);
+      Copy1DGreyImage(b, pix, black, contrast, randomizers[b]);
     } else {
-      Copy2DImage(b, pix, black, contrast, randomizer);
+      Copy2DImage(b, pix, black, contrast, randomizers[b]);
     }
   }
 }
@@ -213,8 +220,11 @@ void NetworkIO::Copy2DImage(int batch, Pix* pix, float black, float contrast,
   StrideMap::Index index(stride_map_);
   index.AddOffset(batch, FD_BATCH);
   int t = index.t();
-  int target_height = stride_map_.Size(FD_HEIGHT);
-  int target_width = stride_map_.Size(FD_WIDTH);
+  // Only the size of this image in the batch is filled. The rest is padding
+  // that stays zero.
+  int target_height = index.MaxIndexOfDim(FD_HEIGHT) + 1;
+  int target_width = index.MaxIndexOfDim(FD_WIDTH) + 1;
+  int row_padding = stride_map_.Size(FD_WIDTH) - target_width;
   int num_features = NumFeatures();
   bool color = num_features == 3;
   if (width > target_width) width = target_width;
@@ -236,6 +246,7 @@ void NetworkIO::Copy2DImage(int batch, Pix* pix, float black, float contrast,
       }
     }
     for (; x < target_width; ++x) Randomize(t++, 0, num_features, randomizer);
+    t += row_padding;
   }
 }
 
@@ -252,7 +263,7 @@ void NetworkIO::Copy1DGreyImage(int batch, Pix* pix, float black,
   StrideMap::Index index(stride_map_);
   index.AddOffset(batch, FD_BATCH);
   int t = index.t();
-  int target_width = stride_map_.Size(FD_WIDTH);
+  int target_width = index.MaxIndexOfDim(FD_WIDTH) + 1;
   if (width > target_width) width = target_width;
   int x;
   for (x = 0; x < width; ++x, ++t) {
@@ -960,6 +971,22 @@ void NetworkIO::CopyUnpacking(const NetworkIO& src, int feature_offset,
   }
 }
 
+// Fills *this with the image at the given batch index of src, as a batch of
+// one. Resizes *this to match.
+void NetworkIO::CopyBatch(const NetworkIO& src, int batch) {
+  StrideMap::Index src_index(src.stride_map_, batch, 0, 0);
+  int height = src_index.MaxIndexOfDim(FD_HEIGHT) + 1;
+  int width = src_index.MaxIndexOfDim(FD_WIDTH) + 1;
+  StrideMap stride_map;
+  stride_map.SetStride({std::make_pair(height, width)});
+  ResizeToMap(src.int_mode_, stride_map, src.NumFeatures());
+  int t = 0;
+  for (int y = 0; y < height; ++y) {
+    StrideMap::Index row(src.stride_map_, batch, y, 0);
+    for (int x = 0; x < width; ++x) CopyTimeStepFrom(t++, src, row.t() + x);
+  }
+}
+
 // Transposes the float part of *this into dest.
 void NetworkIO::Transpose(TransposedArray* dest) const {
   int width = Width();
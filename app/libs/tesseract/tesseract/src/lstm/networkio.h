@@ -75,6 +75,10 @@ class NetworkIO {
   // truncated or padded with noise to match.
   void FromPixes(const StaticShape& shape, const std::vector<const Pix*>& pixes,
                  TRand* randomizer);
+  // As above, but with a separate randomizer for each image, so the noise in
+  // each does not depend on the others in the batch.
+  void FromPixes(const StaticShape& shape, const std::vector<const Pix*>& pixes,
+                 const std::vector<TRand*>& randomizers);
   // Copies the given pix to *this at the given batch index, stretching and
   // clipping the pixel values so that [black, black + 2*contrast] maps to the
   // dynamic range of *this, ie [-1,1] for a float and (-127,127) for int.
@@ -246,6 +250,9 @@ class NetworkIO {
   // feature_offset, and picking num_features. Resizes *this to match.
   void CopyUnpacking(const NetworkIO& src, int feature_offset,
                      int num_features);
+  // Fills *this with the image at the given batch index of src, as a batch of
+  // one. Resizes *this to match.
+  void CopyBatch(const NetworkIO& src, int batch);
   // Transposes the float part of *this into dest.
   void Transpose(TransposedArray* dest) const;
 
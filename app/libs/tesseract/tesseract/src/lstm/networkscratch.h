@@ -19,6 +19,7 @@
 #ifndef TESSERACT_LSTM_NETWORKSCRATCH_H_
 #define TESSERACT_LSTM_NETWORKSCRATCH_H_
 
+#include <vector>
 #include "genericvector.h"
 #include "matrix.h"
 #include "networkio.h"
@@ -26,6 +27,8 @@
 
 namespace tesseract {
 
+class TRand;
+
 // Generic scratch space for network layers. Provides NetworkIO that can store
 // a complete set (over time) of intermediates, and GenericVector<float>
 // scratch space that auto-frees after use. The aim here is to provide a set
@@ -45,6 +48,22 @@ class NetworkScratch {
     int_mode_ = int_mode;
   }
 
+  // Random number generators for the padding of the inputs, one for each
+  // image of a batch, or a single one for all of them. If set, they are used
+  // instead of the one of the network, so that a network that is not training
+  // can run on several threads at once, each with its own NetworkScratch.
+  TRand* randomizer(int batch) const {
+    if (randomizers_.empty()) return nullptr;
+    return randomizers_[static_cast<size_t>(batch) < randomizers_.size()
+                            ? batch : 0];
+  }
+  void set_randomizer(TRand* randomizer) {
+    randomizers_.assign(1, randomizer);
+  }
+  void set_randomizers(const std::vector<TRand*>& randomizers) {
+    randomizers_ = randomizers;
+  }
+
   // Class that acts like a NetworkIO (by having an implicit cast operator),
   // yet actually holds a pointer to NetworkIOs in the source NetworkScratch,
   // and knows how to unstack the borrowed pointers on destruction.
@@ -242,6 +261,8 @@ class NetworkScratch {
  private:
   // If true, the network weights are int8_t, if false, float.
   bool int_mode_;
+  // Borrowed pointers, override the randomizer of the network if not empty.
+  std::vector<TRand*> randomizers_;
   // Stacks of NetworkIO and GenericVector<float>. Once allocated, they are not
   // deleted until the NetworkScratch is deleted.
   Stack<NetworkIO> int_stack_;
@@ -70,6 +70,12 @@ void Plumbing::ConvertToInt() {
     stack_[i]->ConvertToInt();
 }
 
+// Converts a double network to single precision for inference.
+void Plumbing::ConvertToFloat() {
+  for (int i = 0; i < stack_.size(); ++i)
+    stack_[i]->ConvertToFloat();
+}
+
 // Provides a pointer to a TRand for any networks that care to use it.
 // Note that randomizer is a borrowed pointer that should outlive the network
 // and should not be deleted by any of the networks.
@@ -63,6 +63,8 @@ class Plumbing : public Network {
 
   // Converts a float network to an int network.
   void ConvertToInt() override;
+  // Converts a double network to single precision for inference.
+  void ConvertToFloat() override;
 
   // Provides a pointer to a TRand for any networks that care to use it.
   // Note that randomizer is a borrowed pointer that should outlive the network
@@ -126,6 +126,8 @@ void StrideMap::Index::SetTFromIndices() {
 void StrideMap::SetStride(const std::vector<std::pair<int, int>>& h_w_pairs) {
   int max_height = 0;
   int max_width = 0;
+  heights_.clear();
+  widths_.clear();
   for (const std::pair<int, int>& hw : h_w_pairs) {
     int height = hw.first;
     int width = hw.second;
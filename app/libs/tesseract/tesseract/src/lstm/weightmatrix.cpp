@@ -18,8 +18,11 @@
 #include "weightmatrix.h"
 
 #include <cassert>              // for assert
+#include <cstdio>               // for snprintf
+#include <cstring>              // for memcmp
 #include "intsimdmatrix.h"
-#include "simddetect.h"         // for DotProduct
+#include "object_cache.h"
+#include "simddetect.h"         // for DotProduct, DotProductFloat
 #include "statistc.h"
 #include "tprintf.h"
 
@@ -123,19 +126,21 @@ int WeightMatrix::RemapOutputs(const std::vector<int>& code_map) {
 // Store a multiplicative scale factor (as a double) that will reproduce
 // the original value, subject to rounding errors.
 void WeightMatrix::ConvertToInt() {
-  wi_.ResizeNoInit(wf_.dim1(), wf_.dim2());
-  scales_.init_to_size(wi_.dim1(), 0.0);
-  int dim2 = wi_.dim2();
-  for (int t = 0; t < wi_.dim1(); ++t) {
+  auto* weights = new IntWeights;
+  GENERIC_2D_ARRAY<int8_t>& wi = weights->wi;
+  wi.ResizeNoInit(wf_.dim1(), wf_.dim2());
+  weights->scales.init_to_size(wi.dim1(), 0.0);
+  int dim2 = wi.dim2();
+  for (int t = 0; t < wi.dim1(); ++t) {
     double* f_line = wf_[t];
-    int8_t* i_line = wi_[t];
+    int8_t* i_line = wi[t];
     double max_abs = 0.0;
     for (int f = 0; f < dim2; ++f) {
       double abs_val = fabs(f_line[f]);
       if (abs_val > max_abs) max_abs = abs_val;
     }
     double scale = max_abs / INT8_MAX;
-    scales_[t] = scale;
+    weights->scales[t] = scale;
     if (scale == 0.0) scale = 1.0;
     for (int f = 0; f < dim2; ++f) {
       i_line[f] = IntCastRounded(f_line[f] / scale);
@@ -144,15 +149,200 @@ void WeightMatrix::ConvertToInt() {
   wf_.Resize(1, 1, 0.0);
   int_mode_ = true;
   if (IntSimdMatrix::intSimdMatrix) {
-    IntSimdMatrix::intSimdMatrix->Init(wi_, shaped_w_);
+    IntSimdMatrix::intSimdMatrix->Init(wi, weights->shaped_w);
   }
+  int_weights_.reset(weights);
+}
+
+// Converts a double network to single precision for inference only.
+void WeightMatrix::ConvertToFloat() {
+  if (int_mode_ || float_mode_) return;
+  wf32_.ResizeNoInit(wf_.dim1(), wf_.dim2());
+  for (int i = 0; i < wf_.dim1(); ++i) {
+    for (int j = 0; j < wf_.dim2(); ++j) {
+      wf32_[i][j] = static_cast<float>(wf_[i][j]);
+    }
+  }
+  // Resize keeps the memory for reuse, so shrink with a copy to free it.
+  wf_.ResizeWithCopy(0, 0);
+  float_mode_ = true;
+}
+
+// Copies the rows of src to dest, starting at *row, and advances *row.
+template <typename T>
+static void CopyRows(const GENERIC_2D_ARRAY<T>& src, GENERIC_2D_ARRAY<T>* dest,
+                     int* row) {
+  for (int i = 0; i < src.dim1(); ++i, ++*row) {
+    memcpy((*dest)[*row], src[i], src.dim2() * sizeof(T));
+  }
+}
+
+// Sets *this to the rows of the given matrices, one after the other.
+void WeightMatrix::StackRows(const WeightMatrix* const* matrices,
+                             int num_matrices) {
+  const WeightMatrix& first = *matrices[0];
+  int_mode_ = first.int_mode_;
+  float_mode_ = first.float_mode_;
+  // Only kept so that ExtractRows gives back the same serialized mode.
+  use_adam_ = first.use_adam_;
+  int num_rows = 0;
+  for (int m = 0; m < num_matrices; ++m) {
+    ASSERT_HOST(matrices[m]->int_mode_ == int_mode_ &&
+                matrices[m]->float_mode_ == float_mode_);
+    num_rows += matrices[m]->NumOutputs();
+  }
+  int row = 0;
+  if (int_mode_) {
+    auto* weights = new IntWeights;
+    weights->wi.ResizeNoInit(num_rows, first.int_weights_->wi.dim2());
+    for (int m = 0; m < num_matrices; ++m) {
+      const IntWeights& src = *matrices[m]->int_weights_;
+      CopyRows(src.wi, &weights->wi, &row);
+      for (int i = 0; i < src.scales.size(); ++i) {
+        weights->scales.push_back(src.scales[i]);
+      }
+    }
+    ShareIntWeights(weights);
+  } else if (float_mode_) {
+    wf32_.ResizeNoInit(num_rows, first.wf32_.dim2());
+    for (int m = 0; m < num_matrices; ++m) {
+      CopyRows(matrices[m]->wf32_, &wf32_, &row);
+    }
+  } else {
+    wf_.ResizeNoInit(num_rows, first.wf_.dim2());
+    for (int m = 0; m < num_matrices; ++m) {
+      CopyRows(matrices[m]->wf_, &wf_, &row);
+    }
+  }
+}
+
+// Sets dest to num_rows rows of src, starting at first_row.
+template <typename T>
+static void ExtractArrayRows(const GENERIC_2D_ARRAY<T>& src, int first_row,
+                             int num_rows, GENERIC_2D_ARRAY<T>* dest) {
+  dest->ResizeNoInit(num_rows, src.dim2());
+  for (int i = 0; i < num_rows; ++i) {
+    memcpy((*dest)[i], src[first_row + i], src.dim2() * sizeof(T));
+  }
+}
+
+// Sets dest to num_rows rows of *this, starting at first_row.
+void WeightMatrix::ExtractRows(int first_row, int num_rows,
+                               WeightMatrix* dest) const {
+  dest->int_mode_ = int_mode_;
+  dest->float_mode_ = float_mode_;
+  dest->use_adam_ = use_adam_;
+  if (int_mode_) {
+    auto* weights = new IntWeights;
+    ExtractArrayRows(int_weights_->wi, first_row, num_rows, &weights->wi);
+    for (int i = 0; i < num_rows; ++i) {
+      weights->scales.push_back(int_weights_->scales[first_row + i]);
+    }
+    dest->ShareIntWeights(weights);
+  } else if (float_mode_) {
+    ExtractArrayRows(wf32_, first_row, num_rows, &dest->wf32_);
+  } else {
+    ExtractArrayRows(wf_, first_row, num_rows, &dest->wf_);
+  }
+}
+
+// Frees the weights, leaving an empty matrix.
+void WeightMatrix::FreeWeights() {
+  int_weights_.reset();
+  // Resize keeps the memory for reuse, so shrink with a copy to free it.
+  wf_.ResizeWithCopy(0, 0);
+  wf32_.ResizeWithCopy(0, 0);
+  int_mode_ = false;
+  float_mode_ = false;
+}
+
+// The int weights of all loaded int mode matrices, keyed by their content.
+// It is never destroyed, as a static Tesseract instance (eg in main()) is
+// constructed before the cache, so would otherwise free its weights into a
+// cache that has already been destroyed at exit.
+static ObjectCache<IntWeights>& IntWeightsCache() {
+  static ObjectCache<IntWeights>* cache = new ObjectCache<IntWeights>;
+  return *cache;
+}
+
+// Hashes the given bytes into hash (FNV-1a).
+static void HashBytes(const void* data, size_t size, uint64_t* hash) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < size; ++i) {
+    *hash = (*hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+}
+
+static bool SameIntWeights(const IntWeights& a, const IntWeights& b) {
+  if (a.wi.dim1() != b.wi.dim1() || a.wi.dim2() != b.wi.dim2() ||
+      a.scales.size() != b.scales.size()) {
+    return false;
+  }
+  for (int i = 0; i < a.wi.dim1(); ++i) {
+    if (memcmp(a.wi[i], b.wi[i], a.wi.dim2()) != 0) return false;
+  }
+  for (int i = 0; i < a.scales.size(); ++i) {
+    if (a.scales[i] != b.scales[i]) return false;
+  }
+  return true;
+}
+
+// Completes a newly cached IntWeights on first use.
+class IntWeightsLoader {
+ public:
+  explicit IntWeightsLoader(IntWeights* weights) : weights_(weights) {}
+  IntWeights* Load() {
+    if (IntSimdMatrix::intSimdMatrix) {
+      IntSimdMatrix::intSimdMatrix->Init(weights_->wi, weights_->shaped_w);
+    }
+    return weights_;
+  }
+
+ private:
+  IntWeights* weights_;
+};
+
+void WeightMatrix::ShareIntWeights(IntWeights* weights) {
+  const GENERIC_2D_ARRAY<int8_t>& wi = weights->wi;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (int i = 0; i < wi.dim1(); ++i) HashBytes(wi[i], wi.dim2(), &hash);
+  if (!weights->scales.empty()) {
+    HashBytes(&weights->scales[0], weights->scales.size() * sizeof(double),
+              &hash);
+  }
+  // shaped_w depends on the SIMD implementation, which can be changed at
+  // runtime, so that is part of the key as well.
+  char id[96];
+  snprintf(id, sizeof(id), "%dx%d:%016llx:%p", wi.dim1(), wi.dim2(),
+           static_cast<unsigned long long>(hash),
+           static_cast<const void*>(IntSimdMatrix::intSimdMatrix));
+  IntWeightsLoader loader(weights);
+  IntWeights* shared = IntWeightsCache().Get(
+      id, NewTessCallback(&loader, &IntWeightsLoader::Load));
+  if (shared != weights && !SameIntWeights(*shared, *weights)) {
+    // A hash collision. Keep a private copy.
+    IntWeightsCache().Free(shared);
+    IntWeightsLoader(weights).Load();
+    int_weights_.reset(weights);
+    return;
+  }
+  if (shared != weights) delete weights;
+  int_weights_.reset(shared, [](IntWeights* unused) {
+    IntWeightsCache().Free(unused);
+  });
+}
+
+/* static */
+void WeightMatrix::DeleteUnusedIntWeights() {
+  IntWeightsCache().DeleteUnusedObjects();
 }
 
 // Allocates any needed memory for running Backward, and zeroes the deltas,
 // thus eliminating any existing momentum.
 void WeightMatrix::InitBackward() {
-  int no = int_mode_ ? wi_.dim1() : wf_.dim1();
-  int ni = int_mode_ ? wi_.dim2() : wf_.dim2();
+  assert(!float_mode_);
+  int no = int_mode_ ? int_weights_->wi.dim1() : wf_.dim1();
+  int ni = int_mode_ ? int_weights_->wi.dim2() : wf_.dim2();
   dw_.Resize(no, ni, 0.0);
   updates_.Resize(no, ni, 0.0);
   wf_t_.Transpose(wf_);
@@ -176,8 +366,13 @@ bool WeightMatrix::Serialize(bool training, TFile* fp) const {
       (int_mode_ ? kInt8Flag : 0) | (use_adam_ ? kAdamFlag : 0) | kDoubleFlag;
   if (!fp->Serialize(&mode)) return false;
   if (int_mode_) {
-    if (!wi_.Serialize(fp)) return false;
-    if (!scales_.Serialize(fp)) return false;
+    if (!int_weights_->wi.Serialize(fp)) return false;
+    if (!int_weights_->scales.Serialize(fp)) return false;
+  } else if (float_mode_) {
+    // The file format only has double weights.
+    GENERIC_2D_ARRAY<double> wd;
+    FloatToDouble(wf32_, &wd);
+    if (!wd.Serialize(fp)) return false;
   } else {
     if (!wf_.Serialize(fp)) return false;
     if (training && !updates_.Serialize(fp)) return false;
@@ -192,14 +387,16 @@ bool WeightMatrix::DeSerialize(bool training, TFile* fp) {
   uint8_t mode;
   if (!fp->DeSerialize(&mode)) return false;
   int_mode_ = (mode & kInt8Flag) != 0;
+  float_mode_ = false;
   use_adam_ = (mode & kAdamFlag) != 0;
   if ((mode & kDoubleFlag) == 0) return DeSerializeOld(training, fp);
   if (int_mode_) {
-    if (!wi_.DeSerialize(fp)) return false;
-    if (!scales_.DeSerialize(fp)) return false;
-    if (IntSimdMatrix::intSimdMatrix) {
-      IntSimdMatrix::intSimdMatrix->Init(wi_, shaped_w_);
+    auto* weights = new IntWeights;
+    if (!weights->wi.DeSerialize(fp) || !weights->scales.DeSerialize(fp)) {
+      delete weights;
+      return false;
     }
+    ShareIntWeights(weights);
   } else {
     if (!wf_.DeSerialize(fp)) return false;
     if (training) {
@@ -216,11 +413,17 @@ bool WeightMatrix::DeSerialize(bool training, TFile* fp) {
 bool WeightMatrix::DeSerializeOld(bool training, TFile* fp) {
   GENERIC_2D_ARRAY<float> float_array;
   if (int_mode_) {
-    if (!wi_.DeSerialize(fp)) return false;
+    auto* weights = new IntWeights;
     GenericVector<float> old_scales;
-    if (!old_scales.DeSerialize(fp)) return false;
-    scales_.resize_no_init(old_scales.size());
-    for (int i = 0; i < old_scales.size(); ++i) scales_[i] = old_scales[i];
+    if (!weights->wi.DeSerialize(fp) || !old_scales.DeSerialize(fp)) {
+      delete weights;
+      return false;
+    }
+    weights->scales.resize_no_init(old_scales.size());
+    for (int i = 0; i < old_scales.size(); ++i) {
+      weights->scales[i] = old_scales[i];
+    }
+    ShareIntWeights(weights);
   } else {
     if (!float_array.DeSerialize(fp)) return false;
     FloatToDouble(float_array, &wf_);
@@ -241,17 +444,77 @@ bool WeightMatrix::DeSerializeOld(bool training, TFile* fp) {
 // implement the bias, but it doesn't actually have it.
 // Asserts that the call matches what we have.
 void WeightMatrix::MatrixDotVector(const double* u, double* v) const {
-  assert(!int_mode_);
+  assert(!int_mode_ && !float_mode_);
   MatrixDotVectorInternal(wf_, true, false, u, v);
 }
 
 void WeightMatrix::MatrixDotVector(const int8_t* u, double* v) const {
   assert(int_mode_);
+  const IntWeights& weights = *int_weights_;
   if (IntSimdMatrix::intSimdMatrix) {
     IntSimdMatrix::intSimdMatrix->matrixDotVectorFunction(
-      wi_.dim1(), wi_.dim2(), &shaped_w_[0], &scales_[0], u, v);
+      weights.wi.dim1(), weights.wi.dim2(), &weights.shaped_w[0],
+      &weights.scales[0], u, v);
+  } else {
+    IntSimdMatrix::MatrixDotVector(weights.wi, weights.scales, u, v);
+  }
+}
+
+void WeightMatrix::MatrixDotVector(const float* u, double* v) const {
+  assert(float_mode_);
+  int num_results = wf32_.dim1();
+  int extent = wf32_.dim2() - 1;
+  for (int i = 0; i < num_results; ++i) {
+    const float* wi = wf32_[i];
+    float total = DotProductFloat(wi, u, extent);
+    v[i] = total + wi[extent];  // Add the bias value.
+  }
+}
+
+// As MatrixDotVector, but for num_vectors inputs at once.
+void WeightMatrix::MatrixDotVectors(int num_vectors, const double* const* u,
+                                    double* const* v) const {
+  assert(!int_mode_ && !float_mode_);
+  int num_results = wf_.dim1();
+  int extent = wf_.dim2() - 1;
+  for (int i = 0; i < num_results; ++i) {
+    const double* wi = wf_[i];
+    for (int k = 0; k < num_vectors; ++k) {
+      double total = DotProduct(wi, u[k], extent);
+      v[k][i] = total + wi[extent];  // Add the bias value.
+    }
+  }
+}
+
+void WeightMatrix::MatrixDotVectors(int num_vectors, const int8_t* const* u,
+                                    double* const* v) const {
+  assert(int_mode_);
+  const IntWeights& weights = *int_weights_;
+  if (IntSimdMatrix::intSimdMatrix) {
+    // The SIMD kernels take a vector at a time, but the shaped weights stay
+    // in the cache from one to the next.
+    for (int k = 0; k < num_vectors; ++k) {
+      IntSimdMatrix::intSimdMatrix->matrixDotVectorFunction(
+          weights.wi.dim1(), weights.wi.dim2(), &weights.shaped_w[0],
+          &weights.scales[0], u[k], v[k]);
+    }
   } else {
-    IntSimdMatrix::MatrixDotVector(wi_, scales_, u, v);
+    IntSimdMatrix::MatrixDotVectors(weights.wi, weights.scales, num_vectors,
+                                    u, v);
+  }
+}
+
+void WeightMatrix::MatrixDotVectors(int num_vectors, const float* const* u,
+                                    double* const* v) const {
+  assert(float_mode_);
+  int num_results = wf32_.dim1();
+  int extent = wf32_.dim2() - 1;
+  for (int i = 0; i < num_results; ++i) {
+    const float* wi = wf32_[i];
+    for (int k = 0; k < num_vectors; ++k) {
+      float total = DotProductFloat(wi, u[k], extent);
+      v[k][i] = total + wi[extent];  // Add the bias value.
+    }
   }
 }
 
@@ -377,9 +640,10 @@ static void HistogramWeight(double weight, STATS* histogram) {
 void WeightMatrix::Debug2D(const char* msg) {
   STATS histogram(0, kHistogramBuckets);
   if (int_mode_) {
-    for (int i = 0; i < wi_.dim1(); ++i) {
-      for (int j = 0; j < wi_.dim2(); ++j) {
-        HistogramWeight(wi_[i][j] * scales_[i], &histogram);
+    const IntWeights& weights = *int_weights_;
+    for (int i = 0; i < weights.wi.dim1(); ++i) {
+      for (int j = 0; j < weights.wi.dim2(); ++j) {
+        HistogramWeight(weights.wi[i][j] * weights.scales[i], &histogram);
       }
     }
   } else {
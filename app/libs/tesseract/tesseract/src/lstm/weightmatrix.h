@@ -59,12 +59,23 @@ class TransposedArray : public GENERIC_2D_ARRAY<double> {
   }
 };  // class TransposedArray
 
+// The read-only int8 weights of a WeightMatrix in int mode, shared through
+// a global cache by identical matrices in several Tesseract instances.
+struct IntWeights {
+  GENERIC_2D_ARRAY<int8_t> wi;
+  // A factor per output to restore the row product with a vector to the
+  // correct range.
+  GenericVector<double> scales;
+  // wi reorganized in whatever way suits the IntSimdMatrix implementation.
+  std::vector<int8_t> shaped_w;
+};
+
 // Generic weight matrix for network layers. Can store the matrix as either
 // an array of floats or int8_t. Provides functions to compute the forward and
 // backward steps with the matrix and updates to the weights.
 class WeightMatrix {
  public:
-  WeightMatrix() : int_mode_(false), use_adam_(false) {}
+  WeightMatrix() : int_mode_(false), float_mode_(false), use_adam_(false) {}
   // Sets up the network for training. Initializes weights using weights of
   // scale `range` picked according to the random number generator `randomizer`.
   // Note the order is outputs, inputs, as this is the order of indices to
@@ -87,6 +98,21 @@ class WeightMatrix {
   // Store a multiplicative scale factor (as a float) that will reproduce
   // the original value, subject to rounding errors.
   void ConvertToInt();
+  // Converts a double network to single precision for inference only,
+  // halving the size of the weights. An int network is left unchanged.
+  // Training needs the double weights, so it is not possible afterwards.
+  void ConvertToFloat();
+  // Sets *this to the rows of the given matrices, one after the other, so a
+  // single MatrixDotVector gives the outputs of all of them. The matrices must
+  // have the same number of inputs and be in the same mode. For inference
+  // only, as the result cannot be trained.
+  void StackRows(const WeightMatrix* const* matrices, int num_matrices);
+  // Sets dest to num_rows rows of *this, starting at first_row, in the same
+  // mode. The reverse of StackRows.
+  void ExtractRows(int first_row, int num_rows, WeightMatrix* dest) const;
+  // Frees the weights, leaving an empty matrix, eg once StackRows has copied
+  // them into another matrix.
+  void FreeWeights();
   // Returns the size rounded up to an internal factor used by the SIMD
   // implementation for its input.
   int RoundInputs(int size) const {
@@ -98,7 +124,13 @@ class WeightMatrix {
   bool is_int_mode() const {
     return int_mode_;
   }
-  int NumOutputs() const { return int_mode_ ? wi_.dim1() : wf_.dim1(); }
+  bool is_float_mode() const {
+    return float_mode_;
+  }
+  int NumOutputs() const {
+    if (int_mode_) return int_weights_->wi.dim1();
+    return float_mode_ ? wf32_.dim1() : wf_.dim1();
+  }
   // Provides one set of weights. Only used by peep weight maxpool.
   const double* GetWeights(int index) const { return wf_[index]; }
   // Provides access to the deltas (dw_).
@@ -123,6 +155,16 @@ class WeightMatrix {
   // Asserts that the call matches what we have.
   void MatrixDotVector(const double* u, double* v) const;
   void MatrixDotVector(const int8_t* u, double* v) const;
+  void MatrixDotVector(const float* u, double* v) const;
+  // As MatrixDotVector, but for num_vectors inputs u[k] giving v[k], so that
+  // each row of weights is loaded once for all of them. The results are the
+  // same as from MatrixDotVector on each input.
+  void MatrixDotVectors(int num_vectors, const double* const* u,
+                        double* const* v) const;
+  void MatrixDotVectors(int num_vectors, const int8_t* const* u,
+                        double* const* v) const;
+  void MatrixDotVectors(int num_vectors, const float* const* u,
+                        double* const* v) const;
   // MatrixDotVector for peep weights, MultiplyAccumulate adds the
   // component-wise products of *this[0] and v to inout.
   void MultiplyAccumulate(const double* v, double* inout);
@@ -156,28 +198,35 @@ class WeightMatrix {
   static void FloatToDouble(const GENERIC_2D_ARRAY<float>& wf,
                             GENERIC_2D_ARRAY<double>* wd);
 
+  // Frees the shared int weights that are no longer used by any WeightMatrix.
+  static void DeleteUnusedIntWeights();
+
  private:
+  // Replaces int_weights_ with the cached copy of weights if an identical
+  // matrix has been loaded before, otherwise adds weights to the cache.
+  // Takes ownership of weights.
+  void ShareIntWeights(IntWeights* weights);
+
   // Choice between float and 8 bit int implementations.
   GENERIC_2D_ARRAY<double> wf_;
-  GENERIC_2D_ARRAY<int8_t> wi_;
+  // Read-only and possibly shared with other instances. Only set in int mode.
+  std::shared_ptr<const IntWeights> int_weights_;
   // Transposed copy of wf_, used only for Backward, and set with each Update.
   TransposedArray wf_t_;
-  // Which of wf_ and wi_ are we actually using.
+  // Single precision copy of wf_, which replaces it in float mode.
+  GENERIC_2D_ARRAY<float> wf32_;
+  // Which of wf_, wf32_ and int_weights_ are we actually using.
   bool int_mode_;
+  bool float_mode_;
   // True if we are running adam in this weight matrix.
   bool use_adam_;
-  // If we are using wi_, then scales_ is a factor to restore the row product
-  // with a vector to the correct range.
-  GenericVector<double> scales_;
   // Weight deltas. dw_ is the new delta, and updates_ the momentum-decaying
-  // amount to be added to wf_/wi_.
+  // amount to be added to wf_.
   GENERIC_2D_ARRAY<double> dw_;
   GENERIC_2D_ARRAY<double> updates_;
   // Iff use_adam_, the sum of squares of dw_. The number of samples is
   // given to Update(). Serialized iff use_adam_.
   GENERIC_2D_ARRAY<double> dw_sq_sum_;
-  // The weights matrix reorganized in whatever way suits this instance.
-  std::vector<int8_t> shaped_w_;
 };
 
 }  // namespace tesseract.
@@ -126,5 +126,20 @@ TEST_F(IntSimdMatrixTest, AVX2) {
 #endif
 }
 
+// Tests that the NEON implementation gets the same result as the vanilla.
+TEST_F(IntSimdMatrixTest, NEON) {
+#if defined(__ARM_NEON)
+  if (SIMDDetect::IsNEONAvailable()) {
+    tprintf("NEON found! Continuing...");
+  } else {
+    tprintf("No NEON found! Not tested!");
+    return;
+  }
+  ExpectEqualResults(IntSimdMatrix::intSimdMatrixNEON);
+#else
+  tprintf("NEON unsupported! Not tested!");
+#endif
+}
+
 }  // namespace
 }  // namespace tesseract
@@ -0,0 +1,70 @@
+///////////////////////////////////////////////////////////////////////
+// File:        lstmrecognizer_test.cc
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "lstmrecognizer.h"
+#include "allheaders.h"
+#include "include_gunit.h"
+
+namespace tesseract {
+namespace {
+
+class LSTMRecognizerTest : public ::testing::Test {
+ protected:
+  // Makes an 8 bit line image of dark "characters" on a light background,
+  // with the given grey levels.
+  static Pix* MakeLine(int dark, int light) {
+    Pix* pix = pixCreate(200, 30, 8);
+    pixSetAllArbitrary(pix, light);
+    for (int x = 10; x < 190; x += 15) {
+      Box* box = boxCreate(x, 8, 4, 16);
+      pixSetInRectArbitrary(pix, box, dark);
+      boxDestroy(&box);
+    }
+    return pix;
+  }
+};
+
+// Tests that the polarity of dark on light and light on dark lines is
+// predicted in each of the depths that the recognizer may be given.
+TEST_F(LSTMRecognizerTest, LinePolarity) {
+  Pix* pix = MakeLine(20, 230);
+  EXPECT_GT(LSTMRecognizer::LinePolarity(pix), 0.8f);
+  Pix* color_pix = pixConvert8To32(pix);
+  EXPECT_GT(LSTMRecognizer::LinePolarity(color_pix), 0.8f);
+  pixDestroy(&color_pix);
+  Pix* binary_pix = pixThresholdToBinary(pix, 128);
+  EXPECT_GT(LSTMRecognizer::LinePolarity(binary_pix), 0.8f);
+  pixInvert(binary_pix, binary_pix);
+  EXPECT_LT(LSTMRecognizer::LinePolarity(binary_pix), 0.2f);
+  pixDestroy(&binary_pix);
+  pixInvert(pix, pix);
+  EXPECT_LT(LSTMRecognizer::LinePolarity(pix), 0.2f);
+  pixDestroy(&pix);
+  // A low contrast line still has a clear polarity.
+  pix = MakeLine(110, 150);
+  EXPECT_GT(LSTMRecognizer::LinePolarity(pix), 0.8f);
+  pixDestroy(&pix);
+}
+
+// Tests that lines without enough contrast have no predicted polarity.
+TEST_F(LSTMRecognizerTest, LinePolarityFlat) {
+  Pix* pix = MakeLine(128, 140);
+  EXPECT_EQ(-1.0f, LSTMRecognizer::LinePolarity(pix));
+  pixDestroy(&pix);
+  pix = pixCreate(200, 30, 1);
+  EXPECT_EQ(-1.0f, LSTMRecognizer::LinePolarity(pix));
+  pixDestroy(&pix);
+}
+
+}  // namespace
+}  // namespace tesseract
@@ -168,4 +168,24 @@ TEST_F(StridemapTest, Scaling) {
   EXPECT_EQ(pos, values_x_to_1.size());
 }
 
+TEST_F(StridemapTest, Reuse) {
+  // This test verifies that setting the stride again replaces the batch,
+  // as when a NetworkIO is reused for another line.
+  StrideMap stride_map;
+  stride_map.SetStride({{3, 4}, {4, 5}});
+  EXPECT_EQ(2, stride_map.Size(FD_BATCH));
+  stride_map.SetStride({{2, 3}});
+  EXPECT_EQ(1, stride_map.Size(FD_BATCH));
+  EXPECT_EQ(2, stride_map.Size(FD_HEIGHT));
+  EXPECT_EQ(3, stride_map.Size(FD_WIDTH));
+  EXPECT_EQ(6, stride_map.Width());
+  StrideMap::Index index(stride_map);
+  int pos = 0;
+  do {
+    EXPECT_EQ(pos++, index.t());
+    EXPECT_EQ(0, index.index(FD_BATCH));
+  } while (index.Increment());
+  EXPECT_EQ(6, pos);
+}
+
 }  // namespace
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////
+// File:        tessdatamanager_test.cc
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "tessdatamanager.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "genericvector.h"
+#include "include_gunit.h"
+#include "serialis.h"
+
+namespace tesseract {
+namespace {
+
+const char kUnicharset[] = "unicharset contents";
+const char kLstm[] = "lstm contents";
+
+class TessdataManagerTest : public ::testing::Test {
+ protected:
+  // Writes a traineddata file with a unicharset and an lstm component and
+  // returns its name.
+  std::string WriteTrainedData() {
+    TessdataManager mgr;
+    mgr.OverwriteEntry(TESSDATA_UNICHARSET, kUnicharset, strlen(kUnicharset));
+    mgr.OverwriteEntry(TESSDATA_LSTM, kLstm, strlen(kLstm));
+    std::string filename =
+        file::JoinPath(FLAGS_test_tmpdir, "tessdatamanager.traineddata");
+    EXPECT_TRUE(mgr.SaveFile(filename.c_str(), nullptr));
+    return filename;
+  }
+  static std::string Component(TessdataManager* mgr, TessdataType type) {
+    TFile fp;
+    if (!mgr->GetComponent(type, &fp)) return "";
+    char buffer[64];
+    int size = fp.FRead(buffer, 1, sizeof(buffer));
+    return std::string(buffer, size);
+  }
+};
+
+// Tests that a traineddata file that is read in place gives the same
+// components as one that is copied into memory.
+TEST_F(TessdataManagerTest, InitMatchesLoadMemBuffer) {
+  std::string filename = WriteTrainedData();
+  TessdataManager mapped;
+  ASSERT_TRUE(mapped.Init(filename.c_str()));
+  GenericVector<char> data;
+  ASSERT_TRUE(LoadDataFromFile(filename.c_str(), &data));
+  TessdataManager copied;
+  ASSERT_TRUE(copied.LoadMemBuffer(filename.c_str(), &data[0], data.size()));
+
+  EXPECT_TRUE(mapped.IsLSTMAvailable());
+  EXPECT_FALSE(mapped.IsComponentAvailable(TESSDATA_INTTEMP));
+  EXPECT_EQ(kUnicharset, Component(&mapped, TESSDATA_UNICHARSET));
+  EXPECT_EQ(kLstm, Component(&mapped, TESSDATA_LSTM));
+  EXPECT_EQ(copied.VersionString(), mapped.VersionString());
+  GenericVector<char> mapped_data, copied_data;
+  mapped.Serialize(&mapped_data);
+  copied.Serialize(&copied_data);
+  ASSERT_EQ(copied_data.size(), mapped_data.size());
+  EXPECT_EQ(0, memcmp(&copied_data[0], &mapped_data[0], copied_data.size()));
+  EXPECT_EQ(0, memcmp(&data[0], &mapped_data[0], data.size()));
+}
+
+// Tests that copies and modifications of a mapped traineddata file are
+// independent of the original.
+TEST_F(TessdataManagerTest, CopyAndOverwrite) {
+  std::string filename = WriteTrainedData();
+  TessdataManager copy;
+  {
+    TessdataManager mgr;
+    ASSERT_TRUE(mgr.Init(filename.c_str()));
+    copy = mgr;
+    const char kNewLstm[] = "new lstm";
+    mgr.OverwriteEntry(TESSDATA_LSTM, kNewLstm, strlen(kNewLstm));
+    EXPECT_EQ(kNewLstm, Component(&mgr, TESSDATA_LSTM));
+    EXPECT_EQ(kUnicharset, Component(&mgr, TESSDATA_UNICHARSET));
+  }
+  EXPECT_EQ(kLstm, Component(&copy, TESSDATA_LSTM));
+  EXPECT_EQ(kUnicharset, Component(&copy, TESSDATA_UNICHARSET));
+}
+
+}  // namespace
+}  // namespace tesseract
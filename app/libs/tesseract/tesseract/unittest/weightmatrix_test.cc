@@ -0,0 +1,222 @@
+///////////////////////////////////////////////////////////////////////
+// File:        weightmatrix_test.cc
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+// http://www.apache.org/licenses/LICENSE-2.0
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+///////////////////////////////////////////////////////////////////////
+
+#include "weightmatrix.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "genericvector.h"
+#include "helpers.h"
+#include "include_gunit.h"
+#include "serialis.h"
+
+namespace tesseract {
+namespace {
+
+const int kNumOutputs = 37;
+const int kNumInputs = 50;
+
+class WeightMatrixTest : public ::testing::Test {
+ protected:
+  // Makes an int mode matrix with random weights and serializes it to data.
+  void MakeIntMatrix(WeightMatrix* matrix, GenericVector<char>* data) {
+    matrix->InitWeightsFloat(kNumOutputs, kNumInputs + 1, false, 0.5f,
+                             &random_);
+    matrix->ConvertToInt();
+    TFile fp;
+    fp.OpenWrite(data);
+    ASSERT_TRUE(matrix->Serialize(false, &fp));
+  }
+  static void DeSerialize(const GenericVector<char>& data,
+                          WeightMatrix* matrix) {
+    TFile fp;
+    fp.Open(&data[0], data.size());
+    ASSERT_TRUE(matrix->DeSerialize(false, &fp));
+  }
+  std::vector<double> Multiply(const WeightMatrix& matrix) {
+    std::vector<int8_t> u(matrix.RoundInputs(kNumInputs), 0);
+    for (int i = 0; i < kNumInputs; ++i) {
+      u[i] = static_cast<int8_t>(IntCastRounded(i * 5.3) % INT8_MAX);
+    }
+    std::vector<double> v(kNumOutputs);
+    matrix.MatrixDotVector(u.data(), v.data());
+    return v;
+  }
+
+  TRand random_;
+};
+
+// Matrices that are loaded from the same data share their weights, but
+// must still behave exactly like the matrix they were saved from.
+TEST_F(WeightMatrixTest, SharedIntWeights) {
+  WeightMatrix original;
+  GenericVector<char> data;
+  MakeIntMatrix(&original, &data);
+  std::vector<double> expected = Multiply(original);
+  {
+    WeightMatrix first, second;
+    DeSerialize(data, &first);
+    DeSerialize(data, &second);
+    EXPECT_EQ(kNumOutputs, second.NumOutputs());
+    EXPECT_EQ(expected, Multiply(first));
+    EXPECT_EQ(expected, Multiply(second));
+    // Saving a shared matrix writes the original data.
+    GenericVector<char> saved;
+    TFile fp;
+    fp.OpenWrite(&saved);
+    ASSERT_TRUE(second.Serialize(false, &fp));
+    ASSERT_EQ(data.size(), saved.size());
+    EXPECT_EQ(0, memcmp(&data[0], &saved[0], data.size()));
+  }
+  WeightMatrix::DeleteUnusedIntWeights();
+  WeightMatrix reloaded;
+  DeSerialize(data, &reloaded);
+  EXPECT_EQ(expected, Multiply(reloaded));
+}
+
+// Different matrices of the same size must not be shared.
+TEST_F(WeightMatrixTest, DifferentWeights) {
+  WeightMatrix a, b;
+  GenericVector<char> data_a, data_b;
+  MakeIntMatrix(&a, &data_a);
+  MakeIntMatrix(&b, &data_b);
+  WeightMatrix loaded_a, loaded_b;
+  DeSerialize(data_a, &loaded_a);
+  DeSerialize(data_b, &loaded_b);
+  EXPECT_EQ(Multiply(a), Multiply(loaded_a));
+  EXPECT_EQ(Multiply(b), Multiply(loaded_b));
+  EXPECT_NE(Multiply(loaded_a), Multiply(loaded_b));
+}
+
+// Multiplying several vectors at once must give the same results as
+// multiplying each on its own.
+TEST_F(WeightMatrixTest, MatrixDotVectors) {
+  const int kNumVectors = 5;
+  WeightMatrix float_matrix, int_matrix;
+  float_matrix.InitWeightsFloat(kNumOutputs, kNumInputs + 1, false, 0.5f,
+                                &random_);
+  GenericVector<char> data;
+  MakeIntMatrix(&int_matrix, &data);
+  std::vector<std::vector<double>> float_inputs, outputs, int_outputs;
+  std::vector<std::vector<int8_t>> int_inputs;
+  for (int k = 0; k < kNumVectors; ++k) {
+    float_inputs.emplace_back(kNumInputs);
+    for (double& u : float_inputs.back()) u = random_.SignedRand(1.0);
+    int_inputs.emplace_back(int_matrix.RoundInputs(kNumInputs), 0);
+    for (int i = 0; i < kNumInputs; ++i) {
+      int_inputs.back()[i] = static_cast<int8_t>(random_.IntRand() % INT8_MAX);
+    }
+    outputs.emplace_back(kNumOutputs);
+    int_outputs.emplace_back(kNumOutputs);
+  }
+  std::vector<const double*> float_u;
+  std::vector<const int8_t*> int_u;
+  std::vector<double*> v, int_v;
+  for (int k = 0; k < kNumVectors; ++k) {
+    float_u.push_back(float_inputs[k].data());
+    int_u.push_back(int_inputs[k].data());
+    v.push_back(outputs[k].data());
+    int_v.push_back(int_outputs[k].data());
+  }
+  float_matrix.MatrixDotVectors(kNumVectors, float_u.data(), v.data());
+  int_matrix.MatrixDotVectors(kNumVectors, int_u.data(), int_v.data());
+  for (int k = 0; k < kNumVectors; ++k) {
+    std::vector<double> expected(kNumOutputs);
+    float_matrix.MatrixDotVector(float_inputs[k].data(), expected.data());
+    EXPECT_EQ(expected, outputs[k]);
+    int_matrix.MatrixDotVector(int_inputs[k].data(), expected.data());
+    EXPECT_EQ(expected, int_outputs[k]);
+  }
+}
+
+// A matrix converted to float mode must give nearly the same results as the
+// double matrix, for single and multiple vectors, and still save as double.
+TEST_F(WeightMatrixTest, FloatMode) {
+  WeightMatrix matrix;
+  matrix.InitWeightsFloat(kNumOutputs, kNumInputs + 1, false, 0.5f, &random_);
+  std::vector<double> double_input(kNumInputs);
+  std::vector<float> float_input(kNumInputs);
+  for (int i = 0; i < kNumInputs; ++i) {
+    double_input[i] = random_.SignedRand(1.0);
+    float_input[i] = static_cast<float>(double_input[i]);
+  }
+  std::vector<double> expected(kNumOutputs), v(kNumOutputs);
+  matrix.MatrixDotVector(double_input.data(), expected.data());
+  matrix.ConvertToFloat();
+  EXPECT_TRUE(matrix.is_float_mode());
+  EXPECT_EQ(kNumOutputs, matrix.NumOutputs());
+  matrix.MatrixDotVector(float_input.data(), v.data());
+  for (int i = 0; i < kNumOutputs; ++i) EXPECT_NEAR(expected[i], v[i], 1e-4);
+  const float* u = float_input.data();
+  double* results = v.data();
+  matrix.MatrixDotVectors(1, &u, &results);
+  for (int i = 0; i < kNumOutputs; ++i) EXPECT_NEAR(expected[i], v[i], 1e-4);
+  GenericVector<char> data;
+  TFile fp;
+  fp.OpenWrite(&data);
+  ASSERT_TRUE(matrix.Serialize(false, &fp));
+  WeightMatrix loaded;
+  DeSerialize(data, &loaded);
+  EXPECT_FALSE(loaded.is_float_mode());
+  loaded.MatrixDotVector(double_input.data(), v.data());
+  for (int i = 0; i < kNumOutputs; ++i) EXPECT_NEAR(expected[i], v[i], 1e-4);
+}
+
+// A matrix made by stacking the rows of others must give their outputs one
+// after the other.
+TEST_F(WeightMatrixTest, StackRows) {
+  WeightMatrix a, b;
+  GenericVector<char> data_a, data_b;
+  MakeIntMatrix(&a, &data_a);
+  MakeIntMatrix(&b, &data_b);
+  const WeightMatrix* matrices[] = {&a, &b};
+  WeightMatrix stacked;
+  stacked.StackRows(matrices, 2);
+  EXPECT_TRUE(stacked.is_int_mode());
+  ASSERT_EQ(2 * kNumOutputs, stacked.NumOutputs());
+  std::vector<int8_t> u(stacked.RoundInputs(kNumInputs), 0);
+  for (int i = 0; i < kNumInputs; ++i) {
+    u[i] = static_cast<int8_t>(random_.IntRand() % INT8_MAX);
+  }
+  std::vector<double> expected(2 * kNumOutputs), v(2 * kNumOutputs);
+  a.MatrixDotVector(u.data(), expected.data());
+  b.MatrixDotVector(u.data(), expected.data() + kNumOutputs);
+  stacked.MatrixDotVector(u.data(), v.data());
+  EXPECT_EQ(expected, v);
+  // ExtractRows must give back the second matrix.
+  WeightMatrix extracted;
+  stacked.ExtractRows(kNumOutputs, kNumOutputs, &extracted);
+  EXPECT_TRUE(extracted.is_int_mode());
+  ASSERT_EQ(kNumOutputs, extracted.NumOutputs());
+  extracted.MatrixDotVector(u.data(), v.data());
+  EXPECT_TRUE(std::equal(v.begin(), v.begin() + kNumOutputs,
+                         expected.begin() + kNumOutputs));
+
+  WeightMatrix c, d;
+  c.InitWeightsFloat(kNumOutputs, kNumInputs + 1, false, 0.5f, &random_);
+  d.InitWeightsFloat(kNumOutputs, kNumInputs + 1, false, 0.5f, &random_);
+  c.ConvertToFloat();
+  d.ConvertToFloat();
+  const WeightMatrix* float_matrices[] = {&c, &d};
+  stacked.StackRows(float_matrices, 2);
+  EXPECT_TRUE(stacked.is_float_mode());
+  std::vector<float> float_u(kNumInputs);
+  for (float& value : float_u) value = random_.SignedRand(1.0);
+  c.MatrixDotVector(float_u.data(), expected.data());
+  d.MatrixDotVector(float_u.data(), expected.data() + kNumOutputs);
+  stacked.MatrixDotVector(float_u.data(), v.data());
+  EXPECT_EQ(expected, v);
+}
+
+}  // namespace
+}  // namespace tesseract
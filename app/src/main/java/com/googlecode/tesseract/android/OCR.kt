@@ -310,28 +310,53 @@ class OCR(application: Application) : AndroidViewModel(application) {
 
 }
 
-fun initTessApi(context: Context, lang: String, crashLogger: CrashLogger, onProgress: (TessBaseAPI.ProgressValues) -> Unit): TessBaseAPI? {
-    val mTess = TessBaseAPI(onProgress)
+private const val CHAR_BLACKLIST = "ﬀﬁﬂﬃﬄﬅﬆ"
+
+/**
+ * Looks up the training data and runs [init] on it. If [init] fails the language
+ * is assumed to be broken and is installed again.
+ */
+private fun <T : Any> initOcrEngine(context: Context, lang: String, crashLogger: CrashLogger, init: (tessDir: String) -> T?): T? {
     val tessDir = AppStorage.getTrainingDataDir(context)?.path ?: return null
     with(crashLogger) {
         setString(
-                tag = "page seg mode",
+                tag = "ocr engine mode",
                 value = "OEM_LSTM_ONLY"
         )
         setString("ocr language", lang)
     }
-    val result = mTess.init(tessDir, lang, OEM_LSTM_ONLY)
-    if (!result) {
+    val engine = init(tessDir)
+    if (engine == null) {
         crashLogger.logMessage("init failed. deleting $lang")
         deleteLanguage(lang, context)
         OcrLanguage(lang).installLanguage(context)
         return null
     }
     crashLogger.logMessage("init succeeded")
-    mTess.setVariable(TessBaseAPI.VAR_CHAR_BLACKLIST, "ﬀﬁﬂﬃﬄﬅﬆ")
-    return mTess
+    return engine
 }
 
+fun initTessApi(context: Context, lang: String, crashLogger: CrashLogger, onProgress: (TessBaseAPI.ProgressValues) -> Unit): TessBaseAPI? =
+        initOcrEngine(context, lang, crashLogger) { tessDir ->
+            val mTess = TessBaseAPI(onProgress)
+            if (mTess.init(tessDir, lang, OEM_LSTM_ONLY)) {
+                mTess.setVariable(TessBaseAPI.VAR_CHAR_BLACKLIST, CHAR_BLACKLIST)
+                // a single page at a time, so its lines can use all cores
+                mTess.setVariable(TessBaseAPI.VAR_PARALLELIZE, "1")
+                mTess
+            } else {
+                mTess.end()
+                null
+            }
+        }
+
+fun initOcrSessionPool(context: Context, lang: String, crashLogger: CrashLogger, size: Int, onProgress: OcrSessionPool.ProgressNotifier?): OcrSessionPool? =
+        initOcrEngine(context, lang, crashLogger) { tessDir ->
+            OcrSessionPool.create(tessDir, lang, OEM_LSTM_ONLY, size, onProgress)?.apply {
+                setVariable(TessBaseAPI.VAR_CHAR_BLACKLIST, CHAR_BLACKLIST)
+            }
+        }
+
 public fun TessBaseAPI.use(block: (TessBaseAPI) -> Unit) {
     block(this)
     this.end()
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2012,2013 Renard Wellnitz.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+
+package com.googlecode.tesseract.android;
+
+import android.graphics.Rect;
+
+import androidx.annotation.Nullable;
+import androidx.annotation.WorkerThread;
+
+import com.googlecode.leptonica.android.Pix;
+import com.googlecode.tesseract.android.TessBaseAPI.OcrEngineMode;
+import com.googlecode.tesseract.android.TessBaseAPI.PageSegMode;
+
+import java.io.Closeable;
+import java.io.File;
+
+/**
+ * A fixed number of Tesseract instances that share one language and engine mode.
+ * Pages added to the pool are recognized in parallel by the next idle instance,
+ * so the traineddata is loaded once per instance instead of once per page.
+ */
+public class OcrSessionPool implements Closeable {
+    static {
+        System.loadLibrary("lept");
+        System.loadLibrary("tess");
+        nativeClassInit(PageResult.class);
+    }
+
+    /**
+     * Recognition results of a single page.
+     */
+    public static class PageResult {
+        public String hocrText;
+        public String htmlText;
+        public String utf8Text;
+        public int meanConfidence;
+    }
+
+    /**
+     * Receives the progress of the pages in the pool. It is called on the
+     * thread of the instance that recognizes the page, so several pages may
+     * report their progress at the same time.
+     */
+    public interface ProgressNotifier {
+        void onProgressValues(int pageId, TessBaseAPI.ProgressValues progressValues);
+    }
+
+    /** Pointer to the native pool. */
+    private long mNativePool;
+
+    @Nullable
+    private final ProgressNotifier mProgressNotifier;
+
+    private OcrSessionPool(@Nullable ProgressNotifier progressNotifier) {
+        mProgressNotifier = progressNotifier;
+    }
+
+    /**
+     * Initializes up to {@code size} Tesseract instances with the same
+     * traineddata.
+     *
+     * @param datapath the parent directory of tessdata ending in a forward slash
+     * @param language an ISO 639-3 string representing the language(s)
+     * @param ocrEngineMode the OCR engine mode to be set
+     * @param size the maximum number of pages that are recognized at the same time
+     * @param progressNotifier receives the progress of every page, may be {@code null}
+     * @return the pool or {@code null} if not even one instance could be initialized
+     */
+    @Nullable
+    public static OcrSessionPool create(String datapath, String language,
+            @OcrEngineMode int ocrEngineMode, int size,
+            @Nullable ProgressNotifier progressNotifier) {
+        if (datapath == null)
+            throw new IllegalArgumentException("Data path must not be null!");
+        if (!datapath.endsWith(File.separator))
+            datapath += File.separator;
+
+        OcrSessionPool pool = new OcrSessionPool(progressNotifier);
+        pool.mNativePool = nativeConstruct(progressNotifier != null ? pool : null,
+                datapath, language, ocrEngineMode, Math.max(1, size));
+        if (pool.mNativePool == 0) {
+            return null;
+        }
+        return pool;
+    }
+
+    /**
+     * Sets the value of an internal "parameter" on all instances. Must be called
+     * before the first page is added.
+     *
+     * @return {@code false} if the variable couldn't be set on every instance
+     */
+    public boolean setVariable(String var, String value) {
+        if (mNativePool == 0)
+            throw new IllegalStateException();
+
+        return nativeSetVariable(mNativePool, var, value);
+    }
+
+    /**
+     * Queues a page for recognition. The pool keeps its own reference to the
+     * pix, so the caller may recycle it right away.
+     *
+     * @param sparseTextFallback recognize the page again with
+     *                           {@link PageSegMode#PSM_SPARSE_TEXT} if no text was found
+     * @return the id to pass to {@link #getResult(int)} and {@link #cancel(int)}
+     */
+    public int addPage(Pix pix, @PageSegMode.Mode int pageSegMode, boolean sparseTextFallback) {
+        if (mNativePool == 0)
+            throw new IllegalStateException();
+
+        return nativeAddPage(mNativePool, pix.getNativePix(), pageSegMode, sparseTextFallback);
+    }
+
+    /**
+     * Waits for a page to be recognized. The result can only be taken once.
+     *
+     * @return the result or {@code null} if the page was cancelled or the pool
+     *         was closed before the page was recognized
+     */
+    @WorkerThread
+    @Nullable
+    public PageResult getResult(int pageId) {
+        if (mNativePool == 0)
+            throw new IllegalStateException();
+
+        PageResult result = new PageResult();
+        return nativeGetResult(mNativePool, pageId, result) ? result : null;
+    }
+
+    /**
+     * Stops the recognition of a page as soon as possible. Its result will be
+     * {@code null}.
+     */
+    public void cancel(int pageId) {
+        if (mNativePool == 0)
+            throw new IllegalStateException();
+
+        nativeCancelPage(mNativePool, pageId);
+    }
+
+    /**
+     * Cancels all pages that are still queued or being recognized and frees the
+     * Tesseract instances. Threads waiting in {@link #getResult(int)} return
+     * {@code null} for those pages.
+     */
+    @Override
+    public void close() {
+        if (mNativePool != 0) {
+            nativeDestroy(mNativePool);
+            mNativePool = 0;
+        }
+    }
+
+    /**
+     * Called from native code on the thread that recognizes the page. The
+     * bounds are converted the same way as in {@link TessBaseAPI}.
+     */
+    private void onProgressValues(int pageId, int percent, int left, int right, int top,
+            int bottom, int textLeft, int textRight, int textTop, int textBottom) {
+        if (mProgressNotifier != null) {
+            Rect wordRect = new Rect(left + textLeft, textBottom - top, right + textLeft,
+                    textBottom - bottom);
+            Rect textRect = new Rect(textLeft, textTop, textRight, textBottom);
+            mProgressNotifier.onProgressValues(pageId,
+                    new TessBaseAPI.ProgressValues(percent, wordRect, textRect));
+        }
+    }
+
+    private static native void nativeClassInit(Class<PageResult> resultClass);
+
+    private static native long nativeConstruct(OcrSessionPool callbackObject, String dataPath,
+            String language, int ocrEngineMode, int size);
+
+    private static native boolean nativeSetVariable(long nativePool, String var, String value);
+
+    private static native int nativeAddPage(long nativePool, long nativePix, int pageSegMode, boolean sparseTextFallback);
+
+    private static native boolean nativeGetResult(long nativePool, int pageId, PageResult result);
+
+    private static native void nativeCancelPage(long nativePool, int pageId);
+
+    private static native void nativeDestroy(long nativePool);
+}
@@ -25,11 +25,11 @@ import androidx.annotation.WorkerThread;
 
 import com.googlecode.leptonica.android.Pix;
 import com.googlecode.leptonica.android.Pixa;
-import com.googlecode.leptonica.android.ReadFile;
 
 import java.io.Closeable;
 import java.io.File;
 import java.io.IOException;
+import java.nio.ByteBuffer;
 import java.lang.annotation.Retention;
 
 import static java.lang.annotation.RetentionPolicy.SOURCE;
@@ -118,6 +118,12 @@ public class TessBaseAPI implements Closeable {
     /** Save blob choices allowing us to get alternative results. */
     public static final String VAR_SAVE_BLOB_CHOICES = "save_blob_choices";
 
+    /**
+     * Number of threads to recognize the lines of a page with, or 1 to use all
+     * cores. Only used in {@link #OEM_LSTM_ONLY} mode with a single language.
+     */
+    public static final String VAR_PARALLELIZE = "tessedit_parallelize";
+
     /** String value used to assign a boolean variable to true. */
     public static final String VAR_TRUE = "T";
 
@@ -492,23 +498,26 @@ public class TessBaseAPI implements Closeable {
      * SetImage clears all recognition results, and sets the rectangle to the
      * full image, so it may be followed immediately by a GetUTF8Text, and it
      * will automatically perform recognition.
+     * <p>
+     * Only ARGB_8888 bitmaps are supported. The bitmap is locked just while its
+     * pixels are copied.
      *
      * @param bmp bitmap representation of the image
+     * @throws IllegalArgumentException if the bitmap is not ARGB_8888
      */
     @WorkerThread
     public void setImage(Bitmap bmp) {
         if (mRecycled)
             throw new IllegalStateException();
 
-        Pix image = ReadFile.readBitmap(bmp);
+        if (bmp.getConfig() != Bitmap.Config.ARGB_8888) {
+            throw new IllegalArgumentException("Unsupported bitmap config " + bmp.getConfig()
+                    + ", only ARGB_8888 is supported");
+        }
 
-        if (image == null) {
+        if (!nativeSetImageBitmap(mNativeData, bmp)) {
             throw new RuntimeException("Failed to read bitmap");
         }
-
-        nativeSetImagePix(mNativeData, image.getNativePix());
-        
-        image.recycle();
     }
 
     /**
@@ -547,6 +556,31 @@ public class TessBaseAPI implements Closeable {
         nativeSetImageBytes(mNativeData, imagedata, width, height, bpp, bpl);
     }
 
+    /**
+     * Provides an image for Tesseract to recognize, read directly from a
+     * direct buffer, e.g. the plane of a camera frame. Tesseract copies the
+     * image during this call, so the buffer may be reused or released as soon
+     * as the call returns. SetImage clears all recognition results, and sets
+     * the rectangle to the full image.
+     *
+     * @param imagedata direct buffer holding the image, starting at position 0
+     * @param width image width
+     * @param height image height
+     * @param bpp bytes per pixel
+     * @param bpl bytes per line
+     */
+    @WorkerThread
+    public void setImage(ByteBuffer imagedata, int width, int height, int bpp, int bpl) {
+        if (mRecycled)
+            throw new IllegalStateException();
+        if (!imagedata.isDirect())
+            throw new IllegalArgumentException("imagedata must be a direct buffer");
+
+        if (!nativeSetImageBuffer(mNativeData, imagedata, width, height, bpp, bpl)) {
+            throw new IllegalArgumentException("Failed to read image buffer");
+        }
+    }
+
     /**
      * The recognized text is returned as a String which is coded as UTF8.
      * This is a blocking operation that will not work with {@link #stop()}.
@@ -924,6 +958,11 @@ public class TessBaseAPI implements Closeable {
     private native void nativeSetImageBytes(
             long mNativeData,   byte[] imagedata, int width, int height, int bpp, int bpl);
 
+    private native boolean nativeSetImageBuffer(
+            long mNativeData, ByteBuffer imagedata, int width, int height, int bpp, int bpl);
+
+    private native boolean nativeSetImageBitmap(long mNativeData, Bitmap bitmap);
+
     private native void nativeSetImagePix(long mNativeData, long nativePix);
 
     private native void nativeSetRectangle(long mNativeData, int left, int top, int width, int height);
@@ -18,6 +18,8 @@ package com.renard.ocr.cropimage.image_processing;
 
 import com.googlecode.leptonica.android.Pix;
 
+import java.nio.ByteBuffer;
+
 /**
  * @author renard
  */
@@ -30,9 +32,28 @@ public class Blur {
         return nativeBlurDetect(pixs.getNativePix());
     }
 
+    /**
+     * Fast blur estimate of a camera preview frame, e.g. the Y plane of a YUV_420_888 image.
+     * It takes a few milliseconds, so it can run for every preview frame.
+     *
+     * @param luma      direct buffer holding 8 bit luma values
+     * @param rowStride distance between the starts of two rows in bytes
+     */
+    public static PreviewBlurResult blurDetectPreview(ByteBuffer luma, int width, int height, int rowStride) {
+        if (luma == null || !luma.isDirect()) {
+            throw new IllegalArgumentException("Luma must be a direct buffer");
+        }
+        if (width < 16 || height < 16 || rowStride < width || luma.capacity() < (height - 1) * rowStride + width) {
+            throw new IllegalArgumentException("Invalid luma dimensions");
+        }
+        return nativeBlurDetectPreview(luma, width, height, rowStride);
+    }
+
 
     // ***************
     // * NATIVE CODE *
     // ***************
     private static native BlurDetectionResult nativeBlurDetect(long pix);
+
+    private static native PreviewBlurResult nativeBlurDetectPreview(ByteBuffer luma, int width, int height, int rowStride);
 }
@@ -26,6 +26,16 @@ public class BlurDetectionResult {
 
     public enum Blurriness {
         NOT_BLURRED, MEDIUM_BLUR, STRONG_BLUR;
+
+        static Blurriness fromBlurValue(double blurValue) {
+            if (blurValue < 0.5) {
+                return NOT_BLURRED;
+            } else if (blurValue < 0.67) {
+                return MEDIUM_BLUR;
+            } else {
+                return STRONG_BLUR;
+            }
+        }
     }
 
     private boolean mDestroyed;
@@ -64,13 +74,7 @@ public class BlurDetectionResult {
 
     public Blurriness getBlurriness() {
         checkDestroyed();
-        if (mBlurValue < 0.5) {
-            return Blurriness.NOT_BLURRED;
-        } else if (mBlurValue < 0.67) {
-            return Blurriness.MEDIUM_BLUR;
-        } else {
-            return Blurriness.STRONG_BLUR;
-        }
+        return Blurriness.fromBlurValue(mBlurValue);
     }
 
     public void destroy() {
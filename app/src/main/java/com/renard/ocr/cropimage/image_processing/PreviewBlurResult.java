@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 Renard Wellnitz.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may not
+ * use this file except in compliance with the License. You may obtain a copy of
+ * the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ * License for the specific language governing permissions and limitations under
+ * the License.
+ */
+package com.renard.ocr.cropimage.image_processing;
+
+import android.graphics.Rect;
+
+import com.renard.ocr.cropimage.image_processing.BlurDetectionResult.Blurriness;
+
+/**
+ * Blur estimate of a camera preview frame. Unlike {@link BlurDetectionResult} it holds no
+ * native resources.
+ */
+public class PreviewBlurResult {
+
+    private final double mBlurValue;
+    private final Rect mMostBlurredRegion;
+
+    public PreviewBlurResult(double blurValue, int x, int y, int w, int h) {
+        mBlurValue = blurValue;
+        mMostBlurredRegion = new Rect(x, y, x + w, y + h);
+    }
+
+    /**
+     * Value indicating overall blurriness in the same range as
+     * {@link BlurDetectionResult#getBlurValue()}. 0->sharp, 1->very blurred.
+     */
+    public double getBlurValue() {
+        return mBlurValue;
+    }
+
+    public Blurriness getBlurriness() {
+        return Blurriness.fromBlurValue(mBlurValue);
+    }
+
+    /**
+     * Bounds of the most blurred tile in coordinates of the luma plane.
+     */
+    public Rect getMostBlurredRegion() {
+        return mMostBlurredRegion;
+    }
+}
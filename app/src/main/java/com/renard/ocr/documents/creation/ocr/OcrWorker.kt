@@ -20,8 +20,9 @@ import com.googlecode.leptonica.android.Pix
 import com.googlecode.leptonica.android.ReadFile
 import com.googlecode.leptonica.android.WriteFile
 import com.googlecode.tesseract.android.NativeBinding
+import com.googlecode.tesseract.android.OcrSessionPool
 import com.googlecode.tesseract.android.TessBaseAPI
-import com.googlecode.tesseract.android.initTessApi
+import com.googlecode.tesseract.android.initOcrSessionPool
 import com.renard.ocr.R
 import com.renard.ocr.applicationInstance
 import com.renard.ocr.documents.creation.DocumentStore
@@ -104,14 +105,20 @@ class OcrWorker(context: Context, parameters: WorkerParameters) :
     private suspend fun scanUris(uris: List<Uri>, inputLang: String, parentIdParam: Int): ScanPdfResult {
         var parentId = parentIdParam
         var progress = ProgressData(pageCount = getPageCount(applicationContext, uris))
+        // progress is also updated from the threads of the session pool
+        val progressLock = Any()
+        // the page whose preview is shown, only its progress is reported
+        var previewPageId = -1
         val accuracy = mutableListOf<Int>()
 
         NativeBinding().use { binding ->
             binding.setProgressCallBack(object : NativeBinding.ProgressCallBack {
 
                 override fun onProgressImage(nativePix: Long) {
-                    progress = sendProgressImage(nativePix, progress)
-                    setProgressAsync(progress.asWorkData())
+                    synchronized(progressLock) {
+                        progress = sendProgressImage(nativePix, progress)
+                        setProgressAsync(progress.asWorkData())
+                    }
                 }
 
                 override fun onProgressText(message: Int) {}
@@ -120,27 +127,57 @@ class OcrWorker(context: Context, parameters: WorkerParameters) :
 
             })
 
-            initTessApi(applicationContext, inputLang, applicationInstance.crashLogger) {
-                progress = progress.copy(percent = it.percent, pageBounds = it.currentRect, lineBounds = it.currentWordRect)
-                setProgressAsync(progress.asWorkData())
-            }?.use { tess ->
-                for (uri in uris) {
-                    pages(uri).forEach {
-                        progress = ProgressData(currentPage = progress.currentPage + 1, pageCount = progress.pageCount)
-                        setForeground(createForegroundInfo(uri, parentId, progress.currentPage, progress.pageCount))
-                        Pix(binding.convertBookPage(it))
-                                .use { pixText ->
-                                    it.recycle()
-                                    progress = sendProgressImage(pixText.nativePix, progress)
-                                    setProgress(progress.asWorkData())
-                                    val scan = ocr(tess, pixText)
-                                    accuracy.add(scan.accuracy)
-                                    val documentUri = saveDocument(scan, inputLang, pixText, parentId)
-                                    if (parentId == -1 && documentUri != null) {
-                                        parentId = DocumentStore.getDocumentId(documentUri)
-                                    }
-                                }
+            val onPageProgress = OcrSessionPool.ProgressNotifier { pageId, values ->
+                synchronized(progressLock) {
+                    if (pageId == previewPageId) {
+                        progress = progress.copy(percent = values.percent, pageBounds = values.currentRect, lineBounds = values.currentWordRect)
+                        setProgressAsync(progress.asWorkData())
+                    }
+                }
+            }
+            initOcrSessionPool(applicationContext, inputLang, applicationInstance.crashLogger, ocrSessionCount(), onPageProgress)?.use { pool ->
+                // Pages are queued while the next one is being prepared. Their results
+                // are taken in order so that documents are saved in page order.
+                val pending = ArrayDeque<PendingPage>()
+                try {
+                    fun savePendingPage() {
+                        val page = pending.removeFirst()
+                        page.pixText.use { pixText ->
+                            val scan = ocrResult(pool.getResult(page.pageId))
+                                    ?: return@use
+                            accuracy.add(scan.accuracy)
+                            val documentUri = saveDocument(scan, inputLang, pixText, parentId)
+                            if (parentId == -1 && documentUri != null) {
+                                parentId = DocumentStore.getDocumentId(documentUri)
+                            }
+                        }
+                    }
+                    for (uri in uris) {
+                        pages(uri).forEach {
+                            synchronized(progressLock) {
+                                previewPageId = -1
+                                progress = ProgressData(currentPage = progress.currentPage + 1, pageCount = progress.pageCount)
+                            }
+                            setForeground(createForegroundInfo(uri, parentId, progress.currentPage, progress.pageCount))
+                            val pixText = Pix(binding.convertBookPage(it))
+                            it.recycle()
+                            val pageId = pool.addPage(pixText, TessBaseAPI.PageSegMode.PSM_AUTO, true)
+                            pending.addLast(PendingPage(pageId, pixText))
+                            synchronized(progressLock) {
+                                progress = sendProgressImage(pixText.nativePix, progress)
+                                previewPageId = pageId
+                                setProgressAsync(progress.asWorkData())
+                            }
+                            if (pending.size > ocrSessionCount()) {
+                                savePendingPage()
+                            }
+                        }
+                    }
+                    while (pending.isNotEmpty()) {
+                        savePendingPage()
                     }
+                } finally {
+                    pending.forEach { it.pixText.recycle() }
                 }
                 return if (accuracy.isEmpty()) {
                     ScanPdfResult.Failure
@@ -192,27 +229,15 @@ class OcrWorker(context: Context, parameters: WorkerParameters) :
     }
 
 
-    private fun ocr(tess: TessBaseAPI, pixText: Pix): ScanPageResult {
-        tess.pageSegMode = TessBaseAPI.PageSegMode.PSM_AUTO
-        tess.setImage(pixText)
-        var hocrText = tess.getHOCRText(0)
-        var accuracy = tess.meanConfidence()
-        val utf8Text = tess.utF8Text
-        if (utf8Text.isEmpty()) {
-            applicationInstance.crashLogger.logMessage("No words found. Looking for sparse text.")
-            tess.pageSegMode = TessBaseAPI.PageSegMode.PSM_SPARSE_TEXT
-            tess.setImage(pixText)
-            hocrText = tess.getHOCRText(0)
-            accuracy = tess.meanConfidence()
-        }
-
-        val htmlText = tess.htmlText
-        if (accuracy == 95) {
-            accuracy = 0
-        }
-        return ScanPageResult(htmlText, hocrText, accuracy)
+    private fun ocrResult(result: OcrSessionPool.PageResult?): ScanPageResult? {
+        result ?: return null
+        val accuracy = if (result.meanConfidence == 95) 0 else result.meanConfidence
+        return ScanPageResult(result.htmlText, result.hocrText, accuracy)
     }
 
+    private fun ocrSessionCount() =
+            (Runtime.getRuntime().availableProcessors() - 1).coerceIn(1, MAX_OCR_SESSIONS)
+
     private fun createForegroundInfo(pdfFileUri: Uri, parentId: Int, currentPage: Int, pageCount: Int): ForegroundInfo {
         return createForegroundInfo(pdfFileUri, parentId) {
             it.setProgress(pageCount, currentPage, false)
@@ -271,6 +296,8 @@ class OcrWorker(context: Context, parameters: WorkerParameters) :
 
     private data class ScanPageResult(val htmlText: String, val hocrText: String, val accuracy: Int)
 
+    private class PendingPage(val pageId: Int, val pixText: Pix)
+
     data class ProgressData(
             val currentPage: Int = 0,
             val pageCount: Int = 0,
@@ -329,6 +356,12 @@ class OcrWorker(context: Context, parameters: WorkerParameters) :
         const val KEY_INPUT_PARENT_ID = "KEY_INPUT_PARENT_ID"
         const val KEY_OUTPUT_ACCURACY = "KEY_OUTPUT_ACCURACY"
         const val KEY_OUTPUT_DOCUMENT_ID = "KEY_OUTPUT_DOCUMENT_ID"
+
+        /**
+         * Every session holds its own copy of the recognition models, so the pool
+         * stays small even on devices with many cores.
+         */
+        private const val MAX_OCR_SESSIONS = 3
     }
 }
 
@@ -31,6 +31,14 @@ public class Hocr2Pdf {
     }
 
     public void hocr2pdf(String[] images, String[] hocr, String pdfFileName, boolean sloppy, boolean overlayImage) {
+        hocr2pdf(images, hocr, pdfFileName, sloppy, overlayImage, false);
+    }
+
+    /**
+     * @param mrc if set, overlaid images are split into a black and white text mask and a
+     *            downsampled background, which makes the pdf much smaller
+     */
+    public void hocr2pdf(String[] images, String[] hocr, String pdfFileName, boolean sloppy, boolean overlayImage, boolean mrc) {
         byte[][] hocrBytes = new byte[hocr.length][];
         for (int i = 0; i < hocr.length; i++) {
             try {
@@ -40,7 +48,7 @@ public class Hocr2Pdf {
             }
 
         }
-        nativeHocr2pdf(images, hocrBytes, pdfFileName, sloppy, overlayImage);
+        nativeHocr2pdf(images, hocrBytes, pdfFileName, sloppy, overlayImage, mrc);
     }
 
     /**
@@ -53,5 +61,5 @@ public class Hocr2Pdf {
         }
     }
 
-    private native void nativeHocr2pdf(String[] images, byte[][] hocr, String pdfFileName, boolean sloppy, boolean overlayImage);
+    private native void nativeHocr2pdf(String[] images, byte[][] hocr, String pdfFileName, boolean sloppy, boolean overlayImage, boolean mrc);
 }